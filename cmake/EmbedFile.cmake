@@ -0,0 +1,15 @@
+# Writes a C++ source file that defines a byte array holding the contents of
+# a file, and its size.
+#
+# Usage: cmake -DINPUT=<file> -DOUTPUT=<source> -DSYMBOL=<name>
+#              -P EmbedFile.cmake
+file(READ ${INPUT} bytes HEX)
+string(LENGTH "${bytes}" digits)
+math(EXPR size "${digits} / 2")
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${bytes}")
+file(
+  WRITE ${OUTPUT}
+  "// Generated from ${INPUT}, do not edit.\n"
+  "#include <cstddef>\n\n"
+  "extern const unsigned char ${SYMBOL}[] = {${bytes}};\n"
+  "extern const std::size_t ${SYMBOL}Size = ${size};\n")
@@ -1,7 +1,14 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 /*
  * These are defined for each TIP program in the compiled code.
@@ -10,6 +17,720 @@ int64_t _tip_main();
 extern int64_t _tip_num_inputs;
 extern int64_t _tip_input_array[];
 
+/*
+ * Output is formatted by hand into a large buffer that is written to stdout
+ * when it fills up, at exit, and before anything else is printed, so that the
+ * output of the program stays in order.  When stdout is a terminal the buffer
+ * is written after each value instead.
+ *
+ * The "Program output: " prefix is left out in raw mode, which is selected by
+ * compiling this file with TIP_RTLIB_RAW_OUTPUT or by setting the
+ * TIP_RAW_OUTPUT environment variable to anything but 0.
+ */
+#define TIP_OUTPUT_BUFFER_SIZE (1 << 20)
+
+static char _tip_output_buffer[TIP_OUTPUT_BUFFER_SIZE];
+static size_t _tip_output_length = 0;
+
+// Set up on the first output: 1 if set up, 2 if raw as well
+static int _tip_output_mode = 0;
+static int _tip_output_interactive = 0;
+
+static const char _tip_output_prefix[] = "Program output: ";
+
+// The decimal digits of 0 to 99, two characters each
+static const char _tip_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+void _tip_flush() {
+  if (_tip_output_length > 0) {
+    fwrite(_tip_output_buffer, 1, _tip_output_length, stdout);
+    _tip_output_length = 0;
+  }
+  fflush(stdout);
+}
+
+static void _tip_output_setup() {
+  int raw = 0;
+#ifdef TIP_RTLIB_RAW_OUTPUT
+  raw = 1;
+#endif
+  const char *env = getenv("TIP_RAW_OUTPUT");
+  if (env != NULL) {
+    raw = strcmp(env, "0") != 0;
+  }
+  _tip_output_interactive = isatty(fileno(stdout));
+  _tip_output_mode = raw ? 2 : 1;
+  atexit(_tip_flush);
+}
+
+// Writes the digits of x, from right to left, ending just before end
+static char *_tip_format(uint64_t x, char *end) {
+  while (x >= 100) {
+    const char *pair = &_tip_digit_pairs[(x % 100) * 2];
+    x /= 100;
+    *--end = pair[1];
+    *--end = pair[0];
+  }
+  if (x >= 10) {
+    *--end = _tip_digit_pairs[x * 2 + 1];
+    *--end = _tip_digit_pairs[x * 2];
+  } else {
+    *--end = (char)('0' + x);
+  }
+  return end;
+}
+
+/*
+ * In batch mode input values are read without a prompt, from a large buffer
+ * over stdin or from a memory-mapped file.  It is selected by setting the
+ * TIP_INPUT_FILE environment variable to the file, or to - for stdin, or by
+ * compiling this file with TIP_RTLIB_BATCH_INPUT, which reads stdin.
+ *
+ * Values are optionally signed decimal integers.  Characters that cannot
+ * start one separate them, and input is 0 once they run out.  Digits are
+ * converted eight at a time where the target is little-endian.
+ */
+#define TIP_INPUT_BUFFER_SIZE (1 << 20)
+
+// Set up on the first input: 1 if interactive, 2 if batch
+static int _tip_input_mode = 0;
+
+static char *_tip_input_buffer;
+static const char *_tip_input_next;
+static const char *_tip_input_end;
+
+// Whether more input can be read into the buffer
+static int _tip_input_stream = 0;
+
+static void _tip_input_setup() {
+  const char *file = getenv("TIP_INPUT_FILE");
+#ifdef TIP_RTLIB_BATCH_INPUT
+  if (file == NULL) {
+    file = "-";
+  }
+#endif
+  if (file == NULL) {
+    _tip_input_mode = 1;
+    return;
+  }
+
+  _tip_input_mode = 2;
+  if (strcmp(file, "-") == 0) {
+    _tip_input_buffer = malloc(TIP_INPUT_BUFFER_SIZE);
+    _tip_input_next = _tip_input_end = _tip_input_buffer;
+    _tip_input_stream = 1;
+    return;
+  }
+
+  int fd = open(file, O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) != 0) {
+    _tip_flush();
+    printf("Error: cannot read input file %s\n", file);
+    exit(-1);
+  }
+  _tip_input_next = _tip_input_end = NULL;
+  if (info.st_size > 0) {
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      _tip_flush();
+      printf("Error: cannot read input file %s\n", file);
+      exit(-1);
+    }
+    _tip_input_next = data;
+    _tip_input_end = _tip_input_next + info.st_size;
+  }
+  close(fd);
+}
+
+/*
+ * Keeps what is left of the stdin buffer and reads more after it.  Returns
+ * whether there is at least one character to read.
+ */
+static int _tip_input_fill() {
+  if (_tip_input_stream) {
+    size_t left = _tip_input_end - _tip_input_next;
+    memmove(_tip_input_buffer, _tip_input_next, left);
+    size_t count = fread(_tip_input_buffer + left, 1,
+                         TIP_INPUT_BUFFER_SIZE - left, stdin);
+    if (count == 0) {
+      _tip_input_stream = 0;
+    }
+    _tip_input_next = _tip_input_buffer;
+    _tip_input_end = _tip_input_buffer + left + count;
+  }
+  return _tip_input_next < _tip_input_end;
+}
+
+static int _tip_is_digit(char c) { return c >= '0' && c <= '9'; }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/*
+ * Converts the eight characters at p if they are all digits.  The digits are
+ * combined in pairs, then fours, then eights with a multiplication each.
+ */
+static int _tip_eight_digits(const char *p, uint64_t *value) {
+  uint64_t chunk;
+  memcpy(&chunk, p, sizeof(chunk));
+  if (((chunk & 0xF0F0F0F0F0F0F0F0) |
+       (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) !=
+      0x3333333333333333) {
+    return 0;
+  }
+  chunk = ((chunk & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+  chunk = ((chunk & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+  *value = ((chunk & 0x0000FFFF0000FFFF) * 42949672960001) >> 32;
+  return 1;
+}
+#endif
+
+// Values that do not fit wrap around like the arithmetic of programs does
+static int64_t _tip_batch_input() {
+  // Find the start of a value, a digit or a sign followed by one
+  for (;;) {
+    if (_tip_input_end - _tip_input_next < 2 && !_tip_input_fill()) {
+      return 0;
+    }
+    char c = *_tip_input_next;
+    if (_tip_is_digit(c) ||
+        ((c == '-' || c == '+') && _tip_input_end - _tip_input_next > 1 &&
+         _tip_is_digit(_tip_input_next[1]))) {
+      break;
+    }
+    _tip_input_next++;
+  }
+
+  int negative = *_tip_input_next == '-';
+  if (!_tip_is_digit(*_tip_input_next)) {
+    _tip_input_next++;
+  }
+
+  uint64_t value = 0;
+  for (;;) {
+    if (_tip_input_end - _tip_input_next < 8) {
+      _tip_input_fill();
+    }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t eight;
+    if (_tip_input_end - _tip_input_next >= 8 &&
+        _tip_eight_digits(_tip_input_next, &eight)) {
+      value = value * 100000000 + eight;
+      _tip_input_next += 8;
+      continue;
+    }
+#endif
+    if (_tip_input_next < _tip_input_end && _tip_is_digit(*_tip_input_next)) {
+      value = value * 10 + (uint64_t)(*_tip_input_next - '0');
+      _tip_input_next++;
+      continue;
+    }
+    break;
+  }
+  return (int64_t)(negative ? 0 - value : value);
+}
+
+/*
+ * Cells, records and small arrays are allocated from pools of blocks of the
+ * same size class, a multiple of 8 bytes, with a pool of each class for each
+ * thread.  Blocks are cut from zeroed chunks, and those returned with
+ * _tip_free are kept on a free list and zeroed again when they are reused.
+ * Larger objects are allocated with calloc, and those of TIP_MAP_THRESHOLD
+ * bytes or more are mapped directly (see _tip_map).
+ *
+ * The bytes and objects allocated by the running thread are counted.  They
+ * are reported on stderr at exit when TIP_ALLOC_STATS is set.
+ */
+#define TIP_POOL_GRANULE 8
+#define TIP_POOL_CLASSES 32
+#define TIP_POOL_MAX_SIZE (TIP_POOL_GRANULE * TIP_POOL_CLASSES)
+#define TIP_POOL_CHUNK_SIZE (1 << 16)
+#define TIP_CHUNK_BITMAP_WORDS (TIP_POOL_CHUNK_SIZE / TIP_POOL_GRANULE / 64)
+
+// The chunks and large objects the collector knows about
+struct _tip_chunk {
+  char *start;
+  size_t blockSize;
+  uint64_t allocated[TIP_CHUNK_BITMAP_WORDS];
+  uint64_t marked[TIP_CHUNK_BITMAP_WORDS];
+};
+
+struct _tip_pool {
+  char *next;
+  char *end;
+  void *free;
+  struct _tip_chunk *chunk;
+};
+
+struct _tip_large {
+  char *start;
+  size_t size;
+  int marked;
+};
+
+/*
+ * Large arrays are mapped at a huge page boundary, so that the kernel can back
+ * them with transparent huge pages where it supports MADV_HUGEPAGE.  Their
+ * pages are zeroed by the kernel when they are first touched, so they are
+ * written once when the program fills them, and not when they are allocated.
+ */
+#define TIP_MAP_THRESHOLD (2 << 20)
+#define TIP_HUGE_PAGE_SIZE (2 << 20)
+
+static size_t _tip_map_length(size_t size) {
+  return (size + TIP_HUGE_PAGE_SIZE - 1) & ~(size_t)(TIP_HUGE_PAGE_SIZE - 1);
+}
+
+static void *_tip_map(size_t size) {
+  size_t length = _tip_map_length(size);
+  char *mapped = mmap(NULL, length + TIP_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    return NULL;
+  }
+
+  // Trim the mapping to the aligned length
+  char *start = (char *)(((uintptr_t)mapped + TIP_HUGE_PAGE_SIZE - 1) &
+                         ~(uintptr_t)(TIP_HUGE_PAGE_SIZE - 1));
+  if (start != mapped) {
+    munmap(mapped, start - mapped);
+  }
+  size_t tail = mapped + length + TIP_HUGE_PAGE_SIZE - (start + length);
+  if (tail != 0) {
+    munmap(start + length, tail);
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(start, length, MADV_HUGEPAGE);
+#endif
+  return start;
+}
+
+static void *_tip_alloc_large(size_t size) {
+  if (size >= TIP_MAP_THRESHOLD) {
+    return _tip_map(size);
+  }
+  return calloc(1, size);
+}
+
+static void _tip_free_large(void *object, size_t size) {
+  if (size >= TIP_MAP_THRESHOLD) {
+    munmap(object, _tip_map_length(size));
+  } else {
+    free(object);
+  }
+}
+
+static _Thread_local struct _tip_pool _tip_pools[TIP_POOL_CLASSES];
+static _Thread_local int64_t _tip_allocated_bytes = 0;
+static _Thread_local int64_t _tip_allocated_objects = 0;
+static int _tip_alloc_setup = 0;
+
+/*
+ * With TIP_GC set to anything but 0, or when this file is compiled with
+ * TIP_RTLIB_GC, unreachable objects are collected by a mark-sweep collector.
+ *
+ * The collector is conservative: every word of the stack, of the saved
+ * registers and of reachable objects that points into an allocated object,
+ * including past its start, keeps that object alive.  Code generated with
+ * --typed knows which of its values are references, but it emits no stack
+ * maps of them, so its roots are found the same way.  The pools and the stack scanned are those of the running
+ * thread.  A collection runs when the bytes allocated since the last one
+ * exceed the bytes that survived it, and at least TIP_GC_MIN_HEAP.
+ *
+ * Hosts that keep values elsewhere than the native stack, like the
+ * interpreters of tipc, turn collection off with _tip_gc_disable.
+ */
+#define TIP_GC_MIN_HEAP (4 << 20)
+
+static _Thread_local int _tip_gc_enabled = 0;
+static _Thread_local int _tip_gc_disabled = 0;
+static _Thread_local struct _tip_chunk **_tip_chunks = NULL;
+static _Thread_local size_t _tip_num_chunks = 0, _tip_chunks_capacity = 0;
+static _Thread_local struct _tip_large *_tip_larges = NULL;
+static _Thread_local size_t _tip_num_larges = 0, _tip_larges_capacity = 0;
+static _Thread_local uintptr_t _tip_heap_low = UINTPTR_MAX, _tip_heap_high = 0;
+static _Thread_local char *_tip_stack_bottom = NULL;
+static _Thread_local int64_t _tip_gc_live_bytes = 0;
+static _Thread_local int64_t _tip_gc_since = 0;
+static _Thread_local int64_t _tip_gc_collections = 0;
+
+// The objects marked but not scanned yet
+static _Thread_local struct _tip_large *_tip_gc_work = NULL;
+static _Thread_local size_t _tip_gc_work_size = 0, _tip_gc_work_capacity = 0;
+
+int64_t _tip_alloc_bytes() { return _tip_allocated_bytes; }
+
+int64_t _tip_alloc_objects() { return _tip_allocated_objects; }
+
+int64_t _tip_gc_count() { return _tip_gc_collections; }
+
+void _tip_gc_disable() {
+  _tip_gc_disabled = 1;
+  _tip_gc_enabled = 0;
+}
+
+static void _tip_alloc_report() {
+  fprintf(stderr, "Allocated %" PRId64 " bytes in %" PRId64 " objects\n",
+          _tip_allocated_bytes, _tip_allocated_objects);
+  if (_tip_gc_collections > 0) {
+    fprintf(stderr, "Collected %" PRId64 " times, %" PRId64 " bytes live\n",
+            _tip_gc_collections, _tip_gc_live_bytes);
+  }
+}
+
+static void *_tip_out_of_memory() {
+  _tip_flush();
+  printf("Error: out of memory\n");
+  exit(-1);
+}
+
+// Grows an array to hold at least one more element
+static void *_tip_grow(void *array, size_t *capacity, size_t size,
+                       size_t element) {
+  if (size < *capacity) {
+    return array;
+  }
+  *capacity = *capacity == 0 ? 64 : *capacity * 2;
+  array = realloc(array, *capacity * element);
+  return array != NULL ? array : _tip_out_of_memory();
+}
+
+static void _tip_gc_setup() {
+#ifdef TIP_RTLIB_GC
+  _tip_gc_enabled = 1;
+#endif
+  const char *env = getenv("TIP_GC");
+  if (env != NULL) {
+    _tip_gc_enabled = strcmp(env, "0") != 0;
+  }
+  if (!_tip_gc_enabled || _tip_gc_disabled) {
+    _tip_gc_enabled = 0;
+    return;
+  }
+
+#if defined(__APPLE__)
+  _tip_stack_bottom = pthread_get_stackaddr_np(pthread_self());
+#elif defined(__linux__)
+  pthread_attr_t attr;
+  void *stack;
+  size_t size;
+  if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+    if (pthread_attr_getstack(&attr, &stack, &size) == 0) {
+      _tip_stack_bottom = (char *)stack + size;
+    }
+    pthread_attr_destroy(&attr);
+  }
+#endif
+  if (_tip_stack_bottom == NULL) {
+    _tip_gc_enabled = 0;
+  }
+}
+
+// Finds the chunk holding an address, which is known to be in the heap
+static struct _tip_chunk *_tip_find_chunk(uintptr_t address) {
+  size_t low = 0, high = _tip_num_chunks;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    struct _tip_chunk *chunk = _tip_chunks[middle];
+    if (address < (uintptr_t)chunk->start) {
+      high = middle;
+    } else if (address >= (uintptr_t)chunk->start + TIP_POOL_CHUNK_SIZE) {
+      low = middle + 1;
+    } else {
+      return chunk;
+    }
+  }
+  return NULL;
+}
+
+static void _tip_note_range(char *start, size_t size) {
+  if ((uintptr_t)start < _tip_heap_low) {
+    _tip_heap_low = (uintptr_t)start;
+  }
+  if ((uintptr_t)start + size > _tip_heap_high) {
+    _tip_heap_high = (uintptr_t)start + size;
+  }
+}
+
+// Keeps the chunks sorted by address
+static struct _tip_chunk *_tip_add_chunk(char *start, size_t blockSize) {
+  struct _tip_chunk *chunk = calloc(1, sizeof(struct _tip_chunk));
+  if (chunk == NULL) {
+    _tip_out_of_memory();
+  }
+  chunk->start = start;
+  chunk->blockSize = blockSize;
+
+  _tip_chunks = _tip_grow(_tip_chunks, &_tip_chunks_capacity, _tip_num_chunks,
+                          sizeof(*_tip_chunks));
+  size_t position = _tip_num_chunks;
+  while (position > 0 && _tip_chunks[position - 1]->start > start) {
+    _tip_chunks[position] = _tip_chunks[position - 1];
+    position--;
+  }
+  _tip_chunks[position] = chunk;
+  _tip_num_chunks++;
+  _tip_note_range(start, TIP_POOL_CHUNK_SIZE);
+  return chunk;
+}
+
+static void _tip_set_allocated(struct _tip_chunk *chunk, char *block,
+                               int allocated) {
+  size_t index = (block - chunk->start) / chunk->blockSize;
+  uint64_t bit = (uint64_t)1 << (index % 64);
+  if (allocated) {
+    chunk->allocated[index / 64] |= bit;
+  } else {
+    chunk->allocated[index / 64] &= ~bit;
+  }
+}
+
+static int _tip_compare_larges(const void *a, const void *b) {
+  const struct _tip_large *x = a, *y = b;
+  return x->start < y->start ? -1 : x->start > y->start;
+}
+
+static void _tip_gc_push(char *start, size_t size) {
+  _tip_gc_work = _tip_grow(_tip_gc_work, &_tip_gc_work_capacity,
+                           _tip_gc_work_size, sizeof(*_tip_gc_work));
+  _tip_gc_work[_tip_gc_work_size].start = start;
+  _tip_gc_work[_tip_gc_work_size].size = size;
+  _tip_gc_work_size++;
+}
+
+// Marks the object a word points into, if any
+static void _tip_gc_mark(uintptr_t word) {
+  if (word < _tip_heap_low || word >= _tip_heap_high) {
+    return;
+  }
+
+  struct _tip_chunk *chunk = _tip_find_chunk(word);
+  if (chunk != NULL) {
+    size_t index = (word - (uintptr_t)chunk->start) / chunk->blockSize;
+    uint64_t bit = (uint64_t)1 << (index % 64);
+    if ((chunk->allocated[index / 64] & bit) != 0 &&
+        (chunk->marked[index / 64] & bit) == 0) {
+      chunk->marked[index / 64] |= bit;
+      _tip_gc_push(chunk->start + index * chunk->blockSize, chunk->blockSize);
+    }
+    return;
+  }
+
+  // The large objects are sorted when a collection starts
+  size_t low = 0, high = _tip_num_larges;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    struct _tip_large *large = &_tip_larges[middle];
+    if (word < (uintptr_t)large->start) {
+      high = middle;
+    } else if (word >= (uintptr_t)large->start + large->size) {
+      low = middle + 1;
+    } else {
+      if (!large->marked) {
+        large->marked = 1;
+        _tip_gc_push(large->start, large->size);
+      }
+      return;
+    }
+  }
+}
+
+static void _tip_gc_scan(char *start, char *end) {
+  uintptr_t aligned = ((uintptr_t)start + sizeof(uintptr_t) - 1) &
+                      ~(uintptr_t)(sizeof(uintptr_t) - 1);
+  for (uintptr_t *word = (uintptr_t *)aligned; (char *)(word + 1) <= end;
+       word++) {
+    _tip_gc_mark(*word);
+  }
+}
+
+static void _tip_gc_sweep() {
+  _tip_gc_live_bytes = 0;
+
+  for (size_t c = 0; c < _tip_num_chunks; c++) {
+    struct _tip_chunk *chunk = _tip_chunks[c];
+    struct _tip_pool *pool = &_tip_pools[chunk->blockSize / TIP_POOL_GRANULE - 1];
+    for (size_t w = 0; w < TIP_CHUNK_BITMAP_WORDS; w++) {
+      uint64_t dead = chunk->allocated[w] & ~chunk->marked[w];
+      _tip_gc_live_bytes +=
+          (int64_t)__builtin_popcountll(chunk->marked[w]) * chunk->blockSize;
+      chunk->allocated[w] = chunk->marked[w];
+      chunk->marked[w] = 0;
+      while (dead != 0) {
+        size_t index = w * 64 + __builtin_ctzll(dead);
+        dead &= dead - 1;
+        void *block = chunk->start + index * chunk->blockSize;
+        *(void **)block = pool->free;
+        pool->free = block;
+      }
+    }
+  }
+
+  size_t kept = 0;
+  for (size_t l = 0; l < _tip_num_larges; l++) {
+    if (_tip_larges[l].marked) {
+      _tip_larges[l].marked = 0;
+      _tip_gc_live_bytes += _tip_larges[l].size;
+      _tip_larges[kept++] = _tip_larges[l];
+    } else {
+      _tip_free_large(_tip_larges[l].start, _tip_larges[l].size);
+    }
+  }
+  _tip_num_larges = kept;
+}
+
+// Marks what is reachable from the stack below the frame of the caller
+static void __attribute__((noinline)) _tip_gc_mark_and_sweep() {
+  char top;
+
+  qsort(_tip_larges, _tip_num_larges, sizeof(*_tip_larges),
+        _tip_compare_larges);
+  _tip_gc_scan(&top, _tip_stack_bottom);
+  while (_tip_gc_work_size > 0) {
+    struct _tip_large object = _tip_gc_work[--_tip_gc_work_size];
+    _tip_gc_scan(object.start, object.start + object.size);
+  }
+  _tip_gc_sweep();
+}
+
+/*
+ * The callee-saved registers are saved in the frame of this function by
+ * __builtin_unwind_init, so that the values they hold are scanned with the
+ * rest of the stack.  Unlike setjmp, which mangles the frame and stack
+ * pointers it saves on some targets, it saves every register as is.  The
+ * empty asm keeps the call from being a tail call, which would pop them.
+ */
+static void __attribute__((noinline)) _tip_gc_collect() {
+  __builtin_unwind_init();
+  _tip_gc_mark_and_sweep();
+  __asm__ volatile("" ::: "memory");
+
+  _tip_gc_collections++;
+  _tip_gc_since = 0;
+}
+
+void *_tip_alloc(int64_t size) {
+  if (!_tip_alloc_setup) {
+    _tip_alloc_setup = 1;
+    if (getenv("TIP_ALLOC_STATS") != NULL) {
+      atexit(_tip_alloc_report);
+    }
+    _tip_gc_setup();
+  }
+  if (size < TIP_POOL_GRANULE) {
+    size = TIP_POOL_GRANULE;
+  }
+
+  if (_tip_gc_enabled) {
+    _tip_gc_since += size;
+    if (_tip_gc_since > TIP_GC_MIN_HEAP && _tip_gc_since > _tip_gc_live_bytes) {
+      _tip_gc_collect();
+    }
+  }
+
+  _tip_allocated_objects++;
+  if (size > TIP_POOL_MAX_SIZE) {
+    _tip_allocated_bytes += size;
+    void *object = _tip_alloc_large(size);
+    if (object == NULL) {
+      return _tip_out_of_memory();
+    }
+    if (_tip_gc_enabled) {
+      _tip_larges = _tip_grow(_tip_larges, &_tip_larges_capacity,
+                              _tip_num_larges, sizeof(*_tip_larges));
+      _tip_larges[_tip_num_larges].start = object;
+      _tip_larges[_tip_num_larges].size = size;
+      _tip_larges[_tip_num_larges].marked = 0;
+      _tip_num_larges++;
+      _tip_note_range(object, size);
+    }
+    return object;
+  }
+
+  size_t index = (size - 1) / TIP_POOL_GRANULE;
+  size_t rounded = (index + 1) * TIP_POOL_GRANULE;
+  struct _tip_pool *pool = &_tip_pools[index];
+  _tip_allocated_bytes += rounded;
+
+  if (pool->free != NULL) {
+    void *block = pool->free;
+    pool->free = *(void **)block;
+    memset(block, 0, rounded);
+    if (_tip_gc_enabled) {
+      _tip_set_allocated(_tip_find_chunk((uintptr_t)block), block, 1);
+    }
+    return block;
+  }
+
+  // What is left of a chunk too small for a block is not used
+  if ((size_t)(pool->end - pool->next) < rounded) {
+    pool->next = calloc(1, TIP_POOL_CHUNK_SIZE);
+    if (pool->next == NULL) {
+      return _tip_out_of_memory();
+    }
+    pool->end = pool->next + TIP_POOL_CHUNK_SIZE;
+    if (_tip_gc_enabled) {
+      pool->chunk = _tip_add_chunk(pool->next, rounded);
+    }
+  }
+  void *block = pool->next;
+  pool->next += rounded;
+  if (_tip_gc_enabled) {
+    _tip_set_allocated(pool->chunk, block, 1);
+  }
+  return block;
+}
+
+void _tip_free(void *object, int64_t size) {
+  if (object == NULL) {
+    return;
+  }
+  if (size > TIP_POOL_MAX_SIZE) {
+    if (_tip_gc_enabled) {
+      for (size_t l = 0; l < _tip_num_larges; l++) {
+        if (_tip_larges[l].start == object) {
+          _tip_larges[l] = _tip_larges[--_tip_num_larges];
+          break;
+        }
+      }
+    }
+    _tip_free_large(object, size);
+    return;
+  }
+  if (size < TIP_POOL_GRANULE) {
+    size = TIP_POOL_GRANULE;
+  }
+  if (_tip_gc_enabled) {
+    _tip_set_allocated(_tip_find_chunk((uintptr_t)object), object, 0);
+  }
+  struct _tip_pool *pool = &_tip_pools[(size - 1) / TIP_POOL_GRANULE];
+  *(void **)object = pool->free;
+  pool->free = object;
+}
+
+/*
+ * Stores the value in each of the elements, four at a time with vector
+ * stores.  The vector type keeps its natural alignment of 32 bytes, so the
+ * elements must start at a 32-byte boundary, or the stores may fault.  They
+ * do in every array, whose elements start at a cache line in the heap, the
+ * frame and constant globals alike.
+ */
+typedef int64_t _tip_vector __attribute__((vector_size(32)));
+
+void _tip_fill(int64_t *elements, int64_t count, int64_t value) {
+  _tip_vector values = {value, value, value, value};
+  int64_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    *(_tip_vector *)(elements + i) = values;
+  }
+  for (; i < count; i++) {
+    elements[i] = value;
+  }
+}
+
 /*
  * runtime library functions for TIP IO expressions and statements
  *    x = input;
@@ -17,15 +738,56 @@ extern int64_t _tip_input_array[];
  *    error y;
  */
 int64_t _tip_input() {
+  if (_tip_input_mode == 0) {
+    _tip_input_setup();
+  }
+  if (_tip_input_mode == 2) {
+    return _tip_batch_input();
+  }
+
   int64_t x;
+  _tip_flush();
   printf("Enter input: ");
   scanf("%" SCNd64, &x);
   return x;
 }
 
-void _tip_output(int64_t x) { printf("Program output: %" PRId64 "\n", x); }
+void _tip_output(int64_t x) {
+  if (_tip_output_mode == 0) {
+    _tip_output_setup();
+  }
+
+  // The prefix, a sign, 20 digits and a newline
+  if (_tip_output_length + sizeof(_tip_output_prefix) + 22 >
+      TIP_OUTPUT_BUFFER_SIZE) {
+    _tip_flush();
+  }
+
+  char *out = _tip_output_buffer + _tip_output_length;
+  if (_tip_output_mode == 1) {
+    memcpy(out, _tip_output_prefix, sizeof(_tip_output_prefix) - 1);
+    out += sizeof(_tip_output_prefix) - 1;
+  }
+
+  char digits[20];
+  char *end = digits + sizeof(digits);
+  uint64_t magnitude = x < 0 ? 0 - (uint64_t)x : (uint64_t)x;
+  char *start = _tip_format(magnitude, end);
+  if (x < 0) {
+    *out++ = '-';
+  }
+  memcpy(out, start, end - start);
+  out += end - start;
+  *out++ = '\n';
+  _tip_output_length = out - _tip_output_buffer;
+
+  if (_tip_output_interactive) {
+    _tip_flush();
+  }
+}
 
 void _tip_error(int64_t x) {
+  _tip_flush();
   printf("[error] Error: Execution error, code: %" PRId64 "\n", x);
   exit(-1);
 }
@@ -35,10 +797,17 @@ void _tip_error(int64_t x) {
  * that calls this function.
  */
 void _tip_main_undefined() {
+  _tip_flush();
   printf("Error: missing main function\n");
   exit(-1);
 }
 
+/*
+ * tipc --run links these functions into tipc itself and sets up the
+ * arguments on its own.
+ */
+#ifndef TIP_RTLIB_NO_MAIN
+
 /*
  * Set up the arguments to be read by the TIP "main" function.
  * The number of arguments is defined by the compiled TIP code
@@ -62,7 +831,10 @@ int main(int argc, char *argv[]) {
     _tip_input_array[i] = strtoll(argv[i + 1], &eptr, 10);
   }
 
-  printf("Program output: %" PRId64 "\n", _tip_main());
+  _tip_output(_tip_main());
+  _tip_flush();
 
   return 0;
 }
+
+#endif
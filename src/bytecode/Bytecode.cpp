@@ -0,0 +1,213 @@
+#include "Bytecode.h"
+#include "BytecodeError.h"
+
+#include <cstring>
+#include <set>
+
+namespace {
+
+// Identifies the binary format, followed by its version
+const char magic[4] = {'T', 'I', 'P', 'B'};
+const int32_t version = 1;
+
+const char *const opcodeNames[] = {
+#define TIP_BYTECODE_NAME(name, operands) #name,
+    TIP_BYTECODE_OPCODES(TIP_BYTECODE_NAME)
+#undef TIP_BYTECODE_NAME
+};
+
+const char *const opcodeOperands[] = {
+#define TIP_BYTECODE_OPERANDS(name, operands) operands,
+    TIP_BYTECODE_OPCODES(TIP_BYTECODE_OPERANDS)
+#undef TIP_BYTECODE_OPERANDS
+};
+
+const int32_t numOpcodes = sizeof(opcodeNames) / sizeof(opcodeNames[0]);
+
+// Words are written in little-endian byte order
+void writeWord(std::ostream &out, int32_t word) {
+  auto bits = static_cast<uint32_t>(word);
+  char bytes[4];
+  for (int i = 0; i < 4; i++) {
+    bytes[i] = static_cast<char>((bits >> (8 * i)) & 0xff);
+  }
+  out.write(bytes, 4);
+}
+
+int32_t readWord(std::istream &in) {
+  unsigned char bytes[4];
+  if (!in.read(reinterpret_cast<char *>(bytes), 4)) {
+    throw BytecodeError("unexpected end of the bytecode");
+  }
+  uint32_t bits = 0;
+  for (int i = 0; i < 4; i++) {
+    bits |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+  }
+  return static_cast<int32_t>(bits);
+}
+
+// Reads a count, which bounds the size of what follows it
+int32_t readCount(std::istream &in, int32_t limit) {
+  int32_t count = readWord(in);
+  if (count < 0 || count > limit) {
+    throw BytecodeError("invalid count " + std::to_string(count) +
+                        " in the bytecode");
+  }
+  return count;
+}
+
+const int32_t maxCount = 1 << 28;
+
+} // namespace
+
+const char *BytecodeProgram::opcodeName(Opcode op) {
+  return opcodeNames[static_cast<int32_t>(op)];
+}
+
+const char *BytecodeProgram::operandKinds(Opcode op) {
+  return opcodeOperands[static_cast<int32_t>(op)];
+}
+
+void BytecodeProgram::write(std::ostream &out) const {
+  out.write(magic, sizeof(magic));
+  writeWord(out, version);
+  writeWord(out, numFields);
+  writeWord(out, mainFunction);
+  writeWord(out, functions.size());
+  for (auto &function : functions) {
+    writeWord(out, function.name.size());
+    out.write(function.name.data(), function.name.size());
+    writeWord(out, function.numParams);
+    writeWord(out, function.numRegisters);
+    writeWord(out, function.code.size());
+    for (auto word : function.code) {
+      writeWord(out, word);
+    }
+  }
+}
+
+std::shared_ptr<BytecodeProgram> BytecodeProgram::read(std::istream &in) {
+  char header[sizeof(magic)];
+  if (!in.read(header, sizeof(header)) ||
+      std::memcmp(header, magic, sizeof(magic)) != 0) {
+    throw BytecodeError("not a TIP bytecode file");
+  }
+  if (readWord(in) != version) {
+    throw BytecodeError("unsupported version of the bytecode");
+  }
+
+  auto program = std::make_shared<BytecodeProgram>();
+  program->numFields = readCount(in, maxCount);
+  program->mainFunction = readWord(in);
+  program->functions.resize(readCount(in, maxCount));
+  for (auto &function : program->functions) {
+    function.name.resize(readCount(in, maxCount));
+    if (!in.read(function.name.data(), function.name.size())) {
+      throw BytecodeError("unexpected end of the bytecode");
+    }
+    function.numParams = readCount(in, maxCount);
+    function.numRegisters = readCount(in, maxCount);
+    function.code.resize(readCount(in, maxCount));
+    for (auto &word : function.code) {
+      word = readWord(in);
+    }
+  }
+
+  program->verify();
+  return program;
+}
+
+/*
+ * Every instruction has to be complete and use registers of its function,
+ * jumps have to land on instructions and the code cannot run off its end.
+ */
+void BytecodeProgram::verify() const {
+  auto fail = [](const BytecodeFunction &function, const std::string &msg) {
+    throw BytecodeError("function " + function.name + ": " + msg);
+  };
+
+  if (mainFunction < -1 ||
+      mainFunction >= static_cast<int32_t>(functions.size())) {
+    throw BytecodeError("invalid main function");
+  }
+
+  for (auto &function : functions) {
+    if (function.numParams > function.numRegisters) {
+      fail(function, "more parameters than registers");
+    }
+
+    std::set<int32_t> starts;
+    std::vector<int32_t> targets;
+    auto &code = function.code;
+    int32_t size = code.size();
+    Opcode last = Opcode::Jump;
+    for (int32_t pc = 0; pc < size;) {
+      starts.insert(pc);
+      if (code[pc] < 0 || code[pc] >= numOpcodes) {
+        fail(function, "invalid opcode at " + std::to_string(pc));
+      }
+      last = static_cast<Opcode>(code[pc]);
+      int32_t start = pc++;
+
+      for (auto kind = operandKinds(last); *kind != '\0'; kind++) {
+        if (pc >= size) {
+          fail(function, "incomplete instruction at " + std::to_string(start));
+        }
+        int32_t operand = code[pc++];
+        if (*kind == 'r' &&
+            (operand < 0 || operand >= function.numRegisters)) {
+          fail(function, "invalid register at " + std::to_string(start));
+        } else if (*kind == 't') {
+          targets.push_back(operand);
+        } else if (*kind == 'f' && (operand < 0 || operand >= numFields)) {
+          fail(function, "invalid field at " + std::to_string(start));
+        } else if (*kind == 'n') {
+          if (operand < 0 || operand > size - pc) {
+            fail(function, "invalid argument count at " +
+                               std::to_string(start));
+          }
+          for (int32_t i = 0; i < operand; i++, pc++) {
+            if (code[pc] < 0 || code[pc] >= function.numRegisters) {
+              fail(function, "invalid register at " + std::to_string(start));
+            }
+          }
+        }
+      }
+    }
+
+    if (size == 0 || (last != Opcode::Return && last != Opcode::Jump)) {
+      fail(function, "the code does not end with a return or a jump");
+    }
+    for (auto target : targets) {
+      if (starts.count(target) == 0) {
+        fail(function, "invalid jump target " + std::to_string(target));
+      }
+    }
+  }
+}
+
+void BytecodeProgram::print(std::ostream &out) const {
+  for (std::size_t i = 0; i < functions.size(); i++) {
+    auto &function = functions[i];
+    out << "function " << i << " " << function.name << " ("
+        << function.numParams << " params, " << function.numRegisters
+        << " registers)\n";
+
+    auto &code = function.code;
+    for (std::size_t pc = 0; pc < code.size();) {
+      auto op = static_cast<Opcode>(code[pc]);
+      out << "  " << pc << ": " << opcodeName(op);
+      pc++;
+      for (auto kind = operandKinds(op); *kind != '\0'; kind++) {
+        int32_t operand = code[pc++];
+        out << (*kind == 'r' ? " r" : " ") << operand;
+        if (*kind == 'n') {
+          for (int32_t a = 0; a < operand; a++) {
+            out << " r" << code[pc++];
+          }
+        }
+      }
+      out << "\n";
+    }
+  }
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+static const char *const BYTECODE_EXT = ".tbc";
+
+/*
+ * The instructions of the bytecode and the kinds of their operands: r for a
+ * register of the running function, i for an immediate value, t for a jump
+ * target, which is an offset in the code of the function, f for the index of a
+ * field and n for the number of the registers that follow it.
+ *
+ *   Const dst imm            dst = imm
+ *   Move dst src             dst = src
+ *   Add ... Or dst a b       dst = a op b, comparisons give 0 or 1
+ *   AddImm dst a imm         dst = a + imm
+ *   Neg dst a, Not dst a     dst = -a, dst = a xor 1
+ *   Jump target              jump to the code offset target
+ *   JumpIfZero c target      jump if c == 0
+ *   JumpIfNotZero c target   jump if c != 0
+ *   JumpIfLess a b target    jump if a < b
+ *   Input dst, Output src, Error src
+ *   Call dst fn n args...    dst = the n argument call of function value fn
+ *   Return src
+ *   Alloc dst src            dst = a new cell holding src
+ *   AddressOf dst reg        dst = the address of register reg
+ *   Load dst addr            dst = *addr
+ *   Store addr src           *addr = src
+ *   NewArray dst n           dst = a new array of n zeroes
+ *   ArrayLength dst arr      dst = #arr
+ *   ElementAddress dst arr i dst = &arr[i], checking the bounds
+ *   GetElement dst arr i     dst = arr[i], checking the bounds
+ *   GetElementUnchecked dst arr i, SetElementUnchecked arr i src
+ *   NewRecord dst heap       dst = a new record, allocated if heap != 0 and
+ *                            freed on return otherwise
+ *   FieldAddress dst rec f   dst = the address of field number f of rec
+ *   GetField dst rec f       dst = field number f of rec
+ *   SetField rec f src       field number f of rec = src
+ */
+#define TIP_BYTECODE_OPCODES(X)                                                \
+  X(Const, "ri")                                                               \
+  X(Move, "rr")                                                                \
+  X(Add, "rrr")                                                                \
+  X(Sub, "rrr")                                                                \
+  X(Mul, "rrr")                                                                \
+  X(Div, "rrr")                                                                \
+  X(Rem, "rrr")                                                                \
+  X(Gt, "rrr")                                                                 \
+  X(Lt, "rrr")                                                                 \
+  X(Ge, "rrr")                                                                 \
+  X(Le, "rrr")                                                                 \
+  X(Eq, "rrr")                                                                 \
+  X(Ne, "rrr")                                                                 \
+  X(And, "rrr")                                                                \
+  X(Or, "rrr")                                                                 \
+  X(AddImm, "rri")                                                             \
+  X(Neg, "rr")                                                                 \
+  X(Not, "rr")                                                                 \
+  X(Jump, "t")                                                                 \
+  X(JumpIfZero, "rt")                                                          \
+  X(JumpIfNotZero, "rt")                                                       \
+  X(JumpIfLess, "rrt")                                                         \
+  X(Input, "r")                                                                \
+  X(Output, "r")                                                               \
+  X(Error, "r")                                                                \
+  X(Call, "rrn")                                                               \
+  X(Return, "r")                                                               \
+  X(Alloc, "rr")                                                               \
+  X(AddressOf, "rr")                                                           \
+  X(Load, "rr")                                                                \
+  X(Store, "rr")                                                               \
+  X(NewArray, "rr")                                                            \
+  X(ArrayLength, "rr")                                                         \
+  X(ElementAddress, "rrr")                                                     \
+  X(GetElement, "rrr")                                                         \
+  X(GetElementUnchecked, "rrr")                                                \
+  X(SetElementUnchecked, "rrr")                                                \
+  X(NewRecord, "ri")                                                           \
+  X(FieldAddress, "rrf")                                                       \
+  X(GetField, "rrf")                                                           \
+  X(SetField, "rfr")
+
+/*! \brief The opcodes of the bytecode instructions.
+ */
+enum class Opcode : int32_t {
+#define TIP_BYTECODE_ENUM(name, operands) name,
+  TIP_BYTECODE_OPCODES(TIP_BYTECODE_ENUM)
+#undef TIP_BYTECODE_ENUM
+};
+
+/*! \struct BytecodeFunction
+ *  \brief The code of a function.
+ *
+ * The code is a sequence of 32-bit words, each instruction being an opcode
+ * followed by its operands.  The parameters are held in the first registers,
+ * followed by the locals and the temporaries.
+ */
+struct BytecodeFunction {
+  std::string name;
+  int32_t numParams = 0;
+  int32_t numRegisters = 0;
+  std::vector<int32_t> code;
+};
+
+/*! \class BytecodeProgram
+ *  \brief A TIP program lowered to a register based bytecode.
+ *
+ * Functions are numbered in the order of the program and function values are
+ * those numbers, as in the function table of the generated LLVM code.  Records
+ * have a slot for each field of the program, as in the global record.
+ */
+class BytecodeProgram {
+public:
+  std::vector<BytecodeFunction> functions;
+  int32_t mainFunction = -1;
+  int32_t numFields = 0;
+
+  /*! \brief Write the program in the binary bytecode format.
+   */
+  void write(std::ostream &out) const;
+
+  /*! \brief Read a program in the binary bytecode format.
+   *
+   * The program is verified, so that running it cannot access registers
+   * outside of the frame of a function or jump outside of its code.
+   * \throws BytecodeError if the program is malformed
+   */
+  static std::shared_ptr<BytecodeProgram> read(std::istream &in);
+
+  /*! \brief Check that the program is well formed.
+   * \throws BytecodeError if it is not
+   */
+  void verify() const;
+
+  /*! \brief Print the instructions of the program in a readable form.
+   */
+  void print(std::ostream &out) const;
+
+  //! Returns the kinds of the operands of an instruction
+  static const char *operandKinds(Opcode op);
+
+  //! Returns the name of an opcode
+  static const char *opcodeName(Opcode op);
+};
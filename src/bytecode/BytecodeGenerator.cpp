@@ -0,0 +1,619 @@
+#include "BytecodeGenerator.h"
+#include "InternalError.h"
+#include "loguru.hpp"
+
+#include <cstring>
+
+namespace {
+
+// Finds whether an expression calls a function
+class CallFinder : public ASTVisitor {
+public:
+  bool found = false;
+
+  bool visit(ASTFunAppExpr *element) override {
+    found = true;
+    return false;
+  }
+};
+
+bool hasCalls(ASTExpr *e) {
+  CallFinder finder;
+  e->accept(&finder);
+  return finder.found;
+}
+
+Opcode binaryOpcode(const std::string &op) {
+  static const std::map<std::string, Opcode> opcodes = {
+      {"+", Opcode::Add},  {"-", Opcode::Sub},    {"*", Opcode::Mul},
+      {"/", Opcode::Div},  {"%", Opcode::Rem},    {">", Opcode::Gt},
+      {"<", Opcode::Lt},   {">=", Opcode::Ge},    {"<=", Opcode::Le},
+      {"==", Opcode::Eq},  {"!=", Opcode::Ne},    {"and", Opcode::And},
+      {"or", Opcode::Or}};
+  auto opcode = opcodes.find(op);
+  if (opcode == opcodes.end()) {
+    throw InternalError("Invalid binary operator: " + op);
+  }
+  return opcode->second;
+}
+
+// Whether the first operand of an instruction is the register it writes
+bool writesFirstOperand(Opcode op) {
+  switch (op) {
+  case Opcode::Jump:
+  case Opcode::JumpIfZero:
+  case Opcode::JumpIfNotZero:
+  case Opcode::JumpIfLess:
+  case Opcode::Output:
+  case Opcode::Error:
+  case Opcode::Return:
+  case Opcode::Store:
+  case Opcode::SetElementUnchecked:
+  case Opcode::SetField:
+    return false;
+  default:
+    return true;
+  }
+}
+
+} // namespace
+
+std::shared_ptr<BytecodeProgram>
+BytecodeGenerator::generate(ASTProgram *program, SemanticAnalysis *analysis) {
+  auto bytecode = std::make_shared<BytecodeProgram>();
+  BytecodeGenerator generator;
+
+  auto functions = program->getFunctions();
+  for (std::size_t i = 0; i < functions.size(); i++) {
+    generator.functionIndex[functions[i]->getName()] = i;
+    if (functions[i]->getName() == "main") {
+      bytecode->mainFunction = i;
+    }
+  }
+  for (auto &field : analysis->getSymbolTable()->getFields()) {
+    generator.fieldIndex.emplace(field, generator.fieldIndex.size());
+  }
+  bytecode->numFields = generator.fieldIndex.size();
+
+  bytecode->functions.resize(functions.size());
+  for (std::size_t i = 0; i < functions.size(); i++) {
+    generator.lowerFunction(functions[i], bytecode->functions[i]);
+  }
+  return bytecode;
+}
+
+void BytecodeGenerator::lowerFunction(ASTFunction *fn, BytecodeFunction &code) {
+  LOG_S(1) << "Generating bytecode for " << *fn;
+
+  function = &code;
+  code.name = fn->getName();
+  label = -1;
+  last = -1;
+
+  locals.clear();
+  for (auto formal : fn->getFormals()) {
+    locals.emplace(formal->getName(), locals.size());
+  }
+  code.numParams = locals.size();
+  for (auto decl : fn->getDeclarations()) {
+    for (auto local : decl->getVars()) {
+      locals.emplace(local->getName(), locals.size());
+    }
+  }
+  numLocals = next = code.numRegisters = locals.size();
+
+  for (auto stmt : fn->getStmts()) {
+    lowerStmt(stmt);
+  }
+}
+
+void BytecodeGenerator::lowerStmt(ASTStmt *s) {
+  int32_t mark = next;
+  s->accept(this);
+  next = mark;
+}
+
+int32_t BytecodeGenerator::lower(ASTExpr *e) {
+  e->accept(this);
+  return result;
+}
+
+/*
+ * Locals are used in place, so the value of one that has to be kept while a
+ * function is called, which may assign it through a pointer, is copied.
+ */
+int32_t BytecodeGenerator::lowerKept(ASTExpr *e, bool keep) {
+  int32_t reg = lower(e);
+  return keep ? copy(reg) : reg;
+}
+
+BytecodeGenerator::Location BytecodeGenerator::location(ASTExpr *e) {
+  if (auto variable = dynamic_cast<ASTVariableExpr *>(e)) {
+    auto local = locals.find(variable->getName());
+    if (local != locals.end()) {
+      return Location{local->second, false};
+    }
+  }
+  lValue = true;
+  e->accept(this);
+  lValue = false;
+  return Location{result, true};
+}
+
+int32_t BytecodeGenerator::temp() {
+  int32_t reg = next++;
+  if (next > function->numRegisters) {
+    function->numRegisters = next;
+  }
+  return reg;
+}
+
+int32_t BytecodeGenerator::copy(int32_t reg) {
+  if (reg >= numLocals) {
+    return reg;
+  }
+  int32_t t = temp();
+  emit(Opcode::Move, {t, reg});
+  return t;
+}
+
+int32_t BytecodeGenerator::emit(Opcode op,
+                                std::initializer_list<int32_t> operands) {
+  last = function->code.size();
+  function->code.push_back(static_cast<int32_t>(op));
+  function->code.insert(function->code.end(), operands);
+  return last;
+}
+
+// Returns the offset of the next instruction, which a jump targets
+int32_t BytecodeGenerator::here() {
+  label = function->code.size();
+  return label;
+}
+
+// Sets the target of a jump, which is its last operand
+void BytecodeGenerator::patch(int32_t instruction, int32_t target) {
+  auto op = static_cast<Opcode>(function->code[instruction]);
+  function->code[instruction +
+                 std::strlen(BytecodeProgram::operandKinds(op))] = target;
+}
+
+/*
+ * Writes the result of the last instruction to dst instead of reg, unless a
+ * jump lands after it, in which case other instructions also write reg.
+ */
+void BytecodeGenerator::retarget(int32_t reg, int32_t dst) {
+  auto &code = function->code;
+  if (reg >= numLocals && last >= 0 &&
+      label != static_cast<int32_t>(code.size()) &&
+      writesFirstOperand(static_cast<Opcode>(code[last])) &&
+      code[last + 1] == reg) {
+    code[last + 1] = dst;
+  } else if (reg != dst) {
+    emit(Opcode::Move, {dst, reg});
+  }
+}
+
+bool BytecodeGenerator::visit(ASTNumberExpr *element) {
+  result = temp();
+  emit(Opcode::Const, {result, element->getValue()});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTBoolExpr *element) {
+  result = temp();
+  emit(Opcode::Const, {result, element->getValue() != 0});
+  return false;
+}
+
+// A function name evaluates to its index in the function table
+bool BytecodeGenerator::visit(ASTVariableExpr *element) {
+  auto local = locals.find(element->getName());
+  if (local != locals.end()) {
+    if (lValue) {
+      lValue = false;
+      result = temp();
+      emit(Opcode::AddressOf, {result, local->second});
+    } else {
+      result = local->second;
+    }
+    return false;
+  }
+
+  auto index = functionIndex.find(element->getName());
+  if (index == functionIndex.end()) {
+    throw InternalError("Unknown variable name: " + element->getName());
+  }
+  result = temp();
+  emit(Opcode::Const, {result, index->second});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTBinaryExpr *element) {
+  int32_t mark = next;
+  int32_t l = lowerKept(element->getLeft(), hasCalls(element->getRight()));
+
+  auto op = element->getOp();
+  auto number = dynamic_cast<ASTNumberExpr *>(element->getRight());
+  if (number != nullptr && (op == "+" || op == "-")) {
+    next = mark;
+    result = temp();
+    emit(Opcode::AddImm,
+         {result, l, op == "+" ? number->getValue() : -number->getValue()});
+    return false;
+  }
+
+  int32_t r = lower(element->getRight());
+  next = mark;
+  result = temp();
+  emit(binaryOpcode(op), {result, l, r});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTNotExpr *element) {
+  int32_t mark = next;
+  int32_t arg = lower(element->getArg());
+  next = mark;
+  result = temp();
+  emit(Opcode::Not, {result, arg});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTNegExpr *element) {
+  int32_t mark = next;
+  int32_t arg = lower(element->getArg());
+  next = mark;
+  result = temp();
+  emit(Opcode::Neg, {result, arg});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTInputExpr *element) {
+  result = temp();
+  emit(Opcode::Input, {result});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTFunAppExpr *element) {
+  int32_t mark = next;
+  auto actuals = element->getActuals();
+
+  // Whether an actual after the i-th one calls a function
+  std::vector<bool> callsAfter(actuals.size() + 1, false);
+  for (int i = actuals.size() - 1; i >= 0; i--) {
+    callsAfter[i] = callsAfter[i + 1] || hasCalls(actuals[i]);
+  }
+
+  int32_t fn = lowerKept(element->getFunction(), callsAfter[0]);
+  std::vector<int32_t> args;
+  for (std::size_t i = 0; i < actuals.size(); i++) {
+    args.push_back(lowerKept(actuals[i], callsAfter[i + 1]));
+  }
+
+  next = mark;
+  result = temp();
+  emit(Opcode::Call, {result, fn, static_cast<int32_t>(args.size())});
+  function->code.insert(function->code.end(), args.begin(), args.end());
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTTernaryExpr *element) {
+  int32_t condition = lower(element->getCondition());
+  int32_t value = temp();
+  int32_t mark = next;
+  int32_t toElse = emit(Opcode::JumpIfZero, {condition, 0});
+
+  retarget(lower(element->getThen()), value);
+  next = mark;
+  int32_t toEnd = emit(Opcode::Jump, {0});
+
+  patch(toElse, here());
+  retarget(lower(element->getElse()), value);
+  next = mark;
+  patch(toEnd, here());
+
+  result = value;
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTAllocExpr *element) {
+  int32_t mark = next;
+  allocating = true;
+  int32_t initial = lower(element->getInitializer());
+  allocating = false;
+  next = mark;
+  result = temp();
+  emit(Opcode::Alloc, {result, initial});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTRefExpr *element) {
+  auto target = location(element->getVar());
+  if (target.isAddress) {
+    result = target.reg;
+  } else {
+    result = temp();
+    emit(Opcode::AddressOf, {result, target.reg});
+  }
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTDeRefExpr *element) {
+  bool isLValue = lValue;
+  lValue = false;
+  int32_t mark = next;
+  int32_t pointer = lower(element->getPtr());
+  if (isLValue) {
+    result = pointer;
+    return false;
+  }
+  next = mark;
+  result = temp();
+  emit(Opcode::Load, {result, pointer});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTNullExpr *element) {
+  result = temp();
+  emit(Opcode::Const, {result, 0});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTArrayExpr *element) {
+  auto elements = element->getElements();
+  int32_t array = temp();
+  int32_t index = temp();
+  emit(Opcode::Const, {index, static_cast<int32_t>(elements.size())});
+  emit(Opcode::NewArray, {array, index});
+
+  int32_t mark = next;
+  for (std::size_t i = 0; i < elements.size(); i++) {
+    int32_t value = lower(elements[i].get());
+    emit(Opcode::Const, {index, static_cast<int32_t>(i)});
+    emit(Opcode::SetElementUnchecked, {array, index, value});
+    next = mark;
+  }
+
+  next = index;
+  result = array;
+  return false;
+}
+
+// The element expression is evaluated for each element
+bool BytecodeGenerator::visit(ASTArrayOfExpr *element) {
+  int32_t length = copy(lower(element->getE1().get()));
+  int32_t array = temp();
+  int32_t index = temp();
+  emit(Opcode::NewArray, {array, length});
+  emit(Opcode::Const, {index, 0});
+  int32_t toCondition = emit(Opcode::Jump, {0});
+
+  int32_t mark = next;
+  int32_t body = here();
+  int32_t value = lower(element->getE2().get());
+  emit(Opcode::SetElementUnchecked, {array, index, value});
+  emit(Opcode::AddImm, {index, index, 1});
+  next = mark;
+
+  patch(toCondition, here());
+  emit(Opcode::JumpIfLess, {index, length, body});
+
+  // The array is kept in place of the length
+  emit(Opcode::Move, {length, array});
+  next = length + 1;
+  result = length;
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTArrayLenExpr *element) {
+  int32_t mark = next;
+  int32_t array = lower(element->getPtr());
+  next = mark;
+  result = temp();
+  emit(Opcode::ArrayLength, {result, array});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTIndexingExpr *element) {
+  bool isLValue = lValue;
+  lValue = false;
+  int32_t mark = next;
+  int32_t array = lowerKept(element->getArr(), hasCalls(element->getIdx()));
+  int32_t index = lower(element->getIdx());
+  next = mark;
+  result = temp();
+  emit(isLValue ? Opcode::ElementAddress : Opcode::GetElement,
+       {result, array, index});
+  return false;
+}
+
+/*
+ * Records that are not allocated live until the function that creates them
+ * returns, like the allocas of the generated code.
+ */
+bool BytecodeGenerator::visit(ASTRecordExpr *element) {
+  int32_t record = temp();
+  emit(Opcode::NewRecord, {record, allocating});
+
+  int32_t mark = next;
+  for (auto field : element->getFields()) {
+    int32_t value = lower(field);
+    emit(Opcode::SetField, {record, fieldIndex.at(field->getField()), value});
+    next = mark;
+  }
+  result = record;
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTFieldExpr *element) {
+  result = lower(element->getInitializer());
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTAccessExpr *element) {
+  bool isLValue = lValue;
+  lValue = false;
+  int32_t mark = next;
+  int32_t record = lower(element->getRecord());
+  next = mark;
+  result = temp();
+  emit(isLValue ? Opcode::FieldAddress : Opcode::GetField,
+       {result, record, fieldIndex.at(element->getField())});
+  return false;
+}
+
+// Registers are zeroed when a function is called
+bool BytecodeGenerator::visit(ASTDeclStmt *element) { return false; }
+
+bool BytecodeGenerator::visit(ASTAssignStmt *element) {
+  auto target = location(element->getLHS());
+  int32_t value = lower(element->getRHS());
+  if (target.isAddress) {
+    emit(Opcode::Store, {target.reg, value});
+  } else {
+    retarget(value, target.reg);
+  }
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTBlockStmt *element) {
+  for (auto stmt : element->getStmts()) {
+    lowerStmt(stmt);
+  }
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTUpdateStmt *element) {
+  int32_t increment = element->getIncrement() ? 1 : -1;
+  auto target = location(element->getArg());
+  if (target.isAddress) {
+    int32_t value = temp();
+    emit(Opcode::Load, {value, target.reg});
+    emit(Opcode::AddImm, {value, value, increment});
+    emit(Opcode::Store, {target.reg, value});
+  } else {
+    emit(Opcode::AddImm, {target.reg, target.reg, increment});
+  }
+  return false;
+}
+
+/*
+ * Loops test their condition at the bottom, so that each iteration takes a
+ * single branch.
+ */
+bool BytecodeGenerator::visit(ASTWhileStmt *element) {
+  int32_t toCondition = emit(Opcode::Jump, {0});
+  int32_t body = here();
+  lowerStmt(element->getBody());
+
+  patch(toCondition, here());
+  auto condition = element->getCondition();
+  auto less = dynamic_cast<ASTBinaryExpr *>(condition);
+  if (less != nullptr && less->getOp() == "<") {
+    int32_t l = lowerKept(less->getLeft(), hasCalls(less->getRight()));
+    int32_t r = lower(less->getRight());
+    emit(Opcode::JumpIfLess, {l, r, body});
+  } else {
+    emit(Opcode::JumpIfNotZero, {lower(condition), body});
+  }
+  return false;
+}
+
+/*
+ * The bounds and the increment of a range loop, and the array of a loop over
+ * its elements, are evaluated once before the loop.
+ */
+bool BytecodeGenerator::visit(ASTForStmt *element) {
+  auto item = location(element->getItem());
+
+  if (element->getRangeStart() != nullptr) {
+    int32_t start = copy(lower(element->getRangeStart()));
+    int32_t end = copy(lower(element->getRangeEnd()));
+    auto number = dynamic_cast<ASTNumberExpr *>(element->getIncrement());
+    int32_t increment = -1;
+    if (element->getIncrement() != nullptr && number == nullptr) {
+      increment = copy(lower(element->getIncrement()));
+    }
+
+    int32_t value = item.isAddress ? temp() : item.reg;
+    if (item.isAddress) {
+      emit(Opcode::Store, {item.reg, start});
+    } else {
+      emit(Opcode::Move, {item.reg, start});
+    }
+    int32_t toCondition = emit(Opcode::Jump, {0});
+
+    int32_t body = here();
+    lowerStmt(element->getBody());
+    if (item.isAddress) {
+      emit(Opcode::Load, {value, item.reg});
+    }
+    if (increment < 0) {
+      emit(Opcode::AddImm,
+           {value, value, number != nullptr ? number->getValue() : 1});
+    } else {
+      emit(Opcode::Add, {value, value, increment});
+    }
+    if (item.isAddress) {
+      emit(Opcode::Store, {item.reg, value});
+    }
+
+    patch(toCondition, here());
+    if (item.isAddress) {
+      emit(Opcode::Load, {value, item.reg});
+    }
+    emit(Opcode::JumpIfLess, {value, end, body});
+  } else {
+    int32_t array = copy(lower(element->getIterator()));
+    int32_t length = temp();
+    int32_t index = temp();
+    emit(Opcode::ArrayLength, {length, array});
+    emit(Opcode::Const, {index, 0});
+    int32_t toCondition = emit(Opcode::Jump, {0});
+
+    int32_t body = here();
+    if (item.isAddress) {
+      int32_t value = temp();
+      emit(Opcode::GetElementUnchecked, {value, array, index});
+      emit(Opcode::Store, {item.reg, value});
+    } else {
+      emit(Opcode::GetElementUnchecked, {item.reg, array, index});
+    }
+    lowerStmt(element->getBody());
+    emit(Opcode::AddImm, {index, index, 1});
+
+    patch(toCondition, here());
+    emit(Opcode::JumpIfLess, {index, length, body});
+  }
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTIfStmt *element) {
+  int32_t toElse = emit(Opcode::JumpIfZero, {lower(element->getCondition()), 0});
+  lowerStmt(element->getThen());
+  if (element->getElse() == nullptr) {
+    patch(toElse, here());
+    return false;
+  }
+
+  int32_t toEnd = emit(Opcode::Jump, {0});
+  patch(toElse, here());
+  lowerStmt(element->getElse());
+  patch(toEnd, here());
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTOutputStmt *element) {
+  emit(Opcode::Output, {lower(element->getArg())});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTErrorStmt *element) {
+  emit(Opcode::Error, {lower(element->getArg())});
+  return false;
+}
+
+bool BytecodeGenerator::visit(ASTReturnStmt *element) {
+  emit(Opcode::Return, {lower(element->getArg())});
+  return false;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ASTVisitor.h"
+#include "Bytecode.h"
+#include "SemanticAnalysis.h"
+
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+
+/*! \class BytecodeGenerator
+ *  \brief Lowers the AST of a program to bytecode.
+ *
+ * Each function gets a register for each of its parameters and locals,
+ * followed by the temporaries of its expressions, which are reused from one
+ * statement to the next.  Expressions are evaluated in the order of the LLVM
+ * code generation, so programs behave the same when run by the VM.
+ */
+class BytecodeGenerator : public ASTVisitor {
+public:
+  /*! \brief Generate the bytecode of a program.
+   * \param program the program AST
+   * \param analysis the semantic analysis results of the program
+   * \return the bytecode program
+   */
+  static std::shared_ptr<BytecodeProgram> generate(ASTProgram *program,
+                                                   SemanticAnalysis *analysis);
+
+  bool visit(ASTNumberExpr *element) override;
+  bool visit(ASTBoolExpr *element) override;
+  bool visit(ASTVariableExpr *element) override;
+  bool visit(ASTBinaryExpr *element) override;
+  bool visit(ASTNotExpr *element) override;
+  bool visit(ASTNegExpr *element) override;
+  bool visit(ASTInputExpr *element) override;
+  bool visit(ASTFunAppExpr *element) override;
+  bool visit(ASTTernaryExpr *element) override;
+  bool visit(ASTAllocExpr *element) override;
+  bool visit(ASTRefExpr *element) override;
+  bool visit(ASTDeRefExpr *element) override;
+  bool visit(ASTNullExpr *element) override;
+  bool visit(ASTArrayExpr *element) override;
+  bool visit(ASTArrayOfExpr *element) override;
+  bool visit(ASTArrayLenExpr *element) override;
+  bool visit(ASTIndexingExpr *element) override;
+  bool visit(ASTRecordExpr *element) override;
+  bool visit(ASTFieldExpr *element) override;
+  bool visit(ASTAccessExpr *element) override;
+  bool visit(ASTDeclStmt *element) override;
+  bool visit(ASTAssignStmt *element) override;
+  bool visit(ASTBlockStmt *element) override;
+  bool visit(ASTUpdateStmt *element) override;
+  bool visit(ASTWhileStmt *element) override;
+  bool visit(ASTForStmt *element) override;
+  bool visit(ASTIfStmt *element) override;
+  bool visit(ASTOutputStmt *element) override;
+  bool visit(ASTErrorStmt *element) override;
+  bool visit(ASTReturnStmt *element) override;
+
+private:
+  // Where an l-value is stored: a local register or the address in one
+  struct Location {
+    int32_t reg;
+    bool isAddress;
+  };
+
+  std::map<std::string, int32_t> functionIndex;
+  std::map<std::string, int32_t> fieldIndex;
+
+  BytecodeFunction *function = nullptr;
+  std::map<std::string, int32_t> locals;
+  int32_t numLocals = 0;
+  int32_t next = 0;
+  int32_t label = -1;
+  int32_t last = -1;
+  int32_t result = 0;
+  bool lValue = false;
+  bool allocating = false;
+
+  void lowerFunction(ASTFunction *fn, BytecodeFunction &code);
+  void lowerStmt(ASTStmt *s);
+  int32_t lower(ASTExpr *e);
+  int32_t lowerKept(ASTExpr *e, bool keep);
+  Location location(ASTExpr *e);
+  int32_t temp();
+  int32_t copy(int32_t reg);
+  int32_t emit(Opcode op, std::initializer_list<int32_t> operands);
+  int32_t here();
+  void patch(int32_t instruction, int32_t target);
+  void retarget(int32_t reg, int32_t dst);
+};
@@ -0,0 +1,291 @@
+#include "VM.h"
+#include "RuntimeLibrary.h"
+#include "loguru.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using rtlib::wrap;
+
+// Dispatch with computed gotos where the compiler supports them
+#if defined(__GNUC__)
+#define TIP_VM_THREADED_DISPATCH
+#endif
+
+namespace {
+
+// Ends a program that cannot go on, where native code would crash
+[[noreturn]] void fault(const char *msg) {
+  _tip_flush();
+  fprintf(stderr, "%s\n", msg);
+  exit(EXIT_FAILURE);
+}
+
+} // namespace
+
+int VM::run(std::shared_ptr<BytecodeProgram> program,
+            const std::vector<std::string> &args) {
+  LOG_S(1) << "Running the bytecode program";
+
+  if (program->mainFunction < 0) {
+    _tip_main_undefined();
+    return EXIT_FAILURE; // LCOV_EXCL_LINE
+  }
+
+  return rtlib::runMain(
+      args, program->functions[program->mainFunction].numParams,
+      [&](const std::vector<int64_t> &inputs) {
+        VM vm(program);
+        return vm.call(program->mainFunction, inputs);
+      });
+}
+
+VM::VM(std::shared_ptr<BytecodeProgram> program, std::size_t stackSize)
+    : program(std::move(program)), stack(new int64_t[stackSize]),
+      stackSize(stackSize) {
+  // Registers live in the VM's own stack, out of sight of the collector.
+  _tip_gc_disable();
+}
+
+VM::~VM() { freeRecords(0); }
+
+void VM::freeRecords(std::size_t mark) {
+  for (auto i = mark; i < records.size(); i++) {
+    _tip_free(records[i], program->numFields * 8);
+  }
+  records.resize(mark);
+}
+
+/*
+ * The instructions of the running function are read through pc, and its
+ * registers through regs.  A call saves them in a frame and sets them up for
+ * the callee, and a return restores them.
+ */
+int64_t VM::call(int32_t function, const std::vector<int64_t> &args) {
+  auto &functions = program->functions;
+  int64_t *stackEnd = stack.get() + stackSize;
+  const std::size_t base = frames.size();
+
+  const BytecodeFunction *current = &functions.at(function);
+  if (static_cast<std::size_t>(current->numRegisters) > stackSize) {
+    fault("Stack overflow");
+  }
+  int64_t *regs = stack.get();
+  std::fill(regs, regs + current->numRegisters, 0);
+  std::copy_n(args.begin(),
+              std::min<std::size_t>(args.size(), current->numParams), regs);
+  const int32_t *code = current->code.data();
+  const int32_t *pc = code;
+  std::size_t mark = records.size();
+
+#define R(n) regs[pc[n]]
+#define ADDRESS(n) reinterpret_cast<int64_t *>(R(n))
+
+#ifdef TIP_VM_THREADED_DISPATCH
+  static void *const labels[] = {
+#define TIP_VM_LABEL(name, operands) &&op_##name,
+      TIP_BYTECODE_OPCODES(TIP_VM_LABEL)
+#undef TIP_VM_LABEL
+  };
+#define DISPATCH() goto *labels[*pc]
+#define CASE(name) op_##name
+#else
+#define DISPATCH() goto dispatch
+#define CASE(name) case Opcode::name
+#endif
+#define NEXT(size)                                                             \
+  pc += (size) + 1;                                                            \
+  DISPATCH()
+#define BINARY(name, expr)                                                     \
+  CASE(name) : {                                                               \
+    int64_t a = R(2), b = R(3);                                                \
+    R(1) = (expr);                                                             \
+    NEXT(3);                                                                   \
+  }
+
+  DISPATCH();
+
+#ifndef TIP_VM_THREADED_DISPATCH
+dispatch:
+  switch (static_cast<Opcode>(*pc)) {
+#endif
+
+  CASE(Const) : R(1) = pc[2];
+  NEXT(2);
+
+  CASE(Move) : R(1) = R(2);
+  NEXT(2);
+
+  BINARY(Add, wrap(static_cast<uint64_t>(a) + static_cast<uint64_t>(b)))
+  BINARY(Sub, wrap(static_cast<uint64_t>(a) - static_cast<uint64_t>(b)))
+  BINARY(Mul, wrap(static_cast<uint64_t>(a) * static_cast<uint64_t>(b)))
+  BINARY(Div, a / b)
+  BINARY(Rem, a % b)
+  BINARY(Gt, a > b)
+  BINARY(Lt, a < b)
+  BINARY(Ge, a >= b)
+  BINARY(Le, a <= b)
+  BINARY(Eq, a == b)
+  BINARY(Ne, a != b)
+  BINARY(And, a & b)
+  BINARY(Or, a | b)
+
+  CASE(AddImm) : R(1) = wrap(static_cast<uint64_t>(R(2)) +
+                             static_cast<uint64_t>(int64_t{pc[3]}));
+  NEXT(3);
+
+  CASE(Neg) : R(1) = wrap(0 - static_cast<uint64_t>(R(2)));
+  NEXT(2);
+
+  CASE(Not) : R(1) = R(2) ^ 1;
+  NEXT(2);
+
+  CASE(Jump) : pc = code + pc[1];
+  DISPATCH();
+
+  CASE(JumpIfZero) : pc = R(1) == 0 ? code + pc[2] : pc + 3;
+  DISPATCH();
+
+  CASE(JumpIfNotZero) : pc = R(1) != 0 ? code + pc[2] : pc + 3;
+  DISPATCH();
+
+  CASE(JumpIfLess) : pc = R(1) < R(2) ? code + pc[3] : pc + 4;
+  DISPATCH();
+
+  CASE(Input) : R(1) = _tip_input();
+  NEXT(1);
+
+  CASE(Output) : _tip_output(R(1));
+  NEXT(1);
+
+  CASE(Error) : _tip_error(R(1));
+  NEXT(1);
+
+  CASE(Call) : {
+    int64_t value = R(2);
+    if (value < 0 || value >= static_cast<int64_t>(functions.size())) {
+      fault("Invalid function value");
+    }
+    const BytecodeFunction *callee = &functions[value];
+    int64_t *calleeRegs = regs + current->numRegisters;
+    if (calleeRegs + callee->numRegisters > stackEnd) {
+      fault("Stack overflow");
+    }
+
+    std::fill(calleeRegs, calleeRegs + callee->numRegisters, 0);
+    int32_t numArgs = std::min(pc[3], callee->numParams);
+    for (int32_t i = 0; i < numArgs; i++) {
+      calleeRegs[i] = regs[pc[4 + i]];
+    }
+
+    frames.push_back(Frame{current, pc, regs, mark});
+    current = callee;
+    regs = calleeRegs;
+    code = pc = callee->code.data();
+    mark = records.size();
+    DISPATCH();
+  }
+
+  CASE(Return) : {
+    int64_t value = R(1);
+    freeRecords(mark);
+    if (frames.size() == base) {
+      return value;
+    }
+
+    auto &caller = frames.back();
+    current = caller.function;
+    pc = caller.pc;
+    regs = caller.registers;
+    mark = caller.records;
+    frames.pop_back();
+    code = current->code.data();
+    R(1) = value;
+    NEXT(3 + pc[3]);
+  }
+
+  CASE(Alloc) : {
+    auto cell = static_cast<int64_t *>(_tip_alloc(8));
+    *cell = R(2);
+    R(1) = reinterpret_cast<int64_t>(cell);
+    NEXT(2);
+  }
+
+  CASE(AddressOf) : R(1) = reinterpret_cast<int64_t>(&R(2));
+  NEXT(2);
+
+  CASE(Load) : R(1) = *ADDRESS(2);
+  NEXT(2);
+
+  CASE(Store) : *ADDRESS(1) = R(2);
+  NEXT(2);
+
+  // Arrays hold their length followed by their elements
+  CASE(NewArray) : {
+    int64_t length = R(2);
+    auto array = static_cast<int64_t *>(_tip_alloc((length + 1) * 8));
+    array[0] = length;
+    R(1) = reinterpret_cast<int64_t>(array);
+    NEXT(2);
+  }
+
+  CASE(ArrayLength) : R(1) = *ADDRESS(2);
+  NEXT(2);
+
+  CASE(ElementAddress) : {
+    int64_t *array = ADDRESS(2);
+    int64_t index = R(3);
+    if (index < 0 || index >= array[0]) {
+      _tip_error(0);
+    }
+    R(1) = reinterpret_cast<int64_t>(array + index + 1);
+    NEXT(3);
+  }
+
+  CASE(GetElement) : {
+    int64_t *array = ADDRESS(2);
+    int64_t index = R(3);
+    if (index < 0 || index >= array[0]) {
+      _tip_error(0);
+    }
+    R(1) = array[index + 1];
+    NEXT(3);
+  }
+
+  CASE(GetElementUnchecked) : R(1) = ADDRESS(2)[R(3) + 1];
+  NEXT(3);
+
+  CASE(SetElementUnchecked) : ADDRESS(1)[R(2) + 1] = R(3);
+  NEXT(3);
+
+  CASE(NewRecord) : {
+    auto record = static_cast<int64_t *>(_tip_alloc(program->numFields * 8));
+    if (pc[2] == 0) {
+      records.push_back(record);
+    }
+    R(1) = reinterpret_cast<int64_t>(record);
+    NEXT(2);
+  }
+
+  CASE(FieldAddress) : R(1) = reinterpret_cast<int64_t>(ADDRESS(2) + pc[3]);
+  NEXT(3);
+
+  CASE(GetField) : R(1) = ADDRESS(2)[pc[3]];
+  NEXT(3);
+
+  CASE(SetField) : ADDRESS(1)[pc[2]] = R(3);
+  NEXT(3);
+
+#ifndef TIP_VM_THREADED_DISPATCH
+  }
+#endif
+  return 0; // LCOV_EXCL_LINE
+
+#undef BINARY
+#undef NEXT
+#undef CASE
+#undef DISPATCH
+#undef ADDRESS
+#undef R
+}
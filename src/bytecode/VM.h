@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Bytecode.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*! \class VM
+ *  \brief A virtual machine running the bytecode of TIP programs.
+ *
+ * The registers of the running functions are allocated from a stack of fixed
+ * size, so that their addresses stay valid while the functions run, and
+ * calls do not recurse in the VM.  When compiled with GCC or Clang the
+ * instructions are dispatched with computed gotos, each instruction jumping
+ * directly to the code of the next one.
+ *
+ * Values are represented the way the generated code represents them and the
+ * program calls the runtime library for input and output.
+ */
+class VM {
+public:
+  /*! \brief Run a program.
+   *
+   * Calls the main function with the given arguments, like an executable
+   * linked with the runtime library would run it.
+   * \param program the bytecode of the program
+   * \param args the arguments of the TIP main function
+   * \return the exit code of the program
+   */
+  static int run(std::shared_ptr<BytecodeProgram> program,
+                 const std::vector<std::string> &args);
+
+  /*! \brief Set up a VM for a program.
+   * \param program the bytecode of the program, which has to be verified
+   * \param stackSize the number of registers for the running functions
+   */
+  explicit VM(std::shared_ptr<BytecodeProgram> program,
+              std::size_t stackSize = 1 << 20);
+  ~VM();
+
+  /*! \brief Call a function of the program.
+   * \param function the index of the function
+   * \return the value the function returns
+   */
+  int64_t call(int32_t function, const std::vector<int64_t> &args);
+
+private:
+  // The state of a function that is waiting for a call to return
+  struct Frame {
+    const BytecodeFunction *function;
+    const int32_t *pc;
+    int64_t *registers;
+    std::size_t records;
+  };
+
+  std::shared_ptr<BytecodeProgram> program;
+  std::unique_ptr<int64_t[]> stack;
+  std::size_t stackSize;
+  std::vector<Frame> frames;
+
+  // The records the running functions created, which are freed on return
+  std::vector<int64_t *> records;
+
+  void freeRecords(std::size_t mark);
+};
@@ -1,8 +1,20 @@
 #include <ASTDeclNode.h>
 
 #include "AST.h"
+#include "ASTVisitor.h"
+#include "CodeGenOptions.h"
+#include "EscapeAnalysis.h"
 #include "InternalError.h"
+#include "RangeAnalysis.h"
 #include "SemanticAnalysis.h"
+#include "TipAbsentField.h"
+#include "TipArray.h"
+#include "TipBool.h"
+#include "TipFunction.h"
+#include "TipMu.h"
+#include "TipRecord.h"
+#include "TipRef.h"
+#include "TipVar.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
@@ -13,6 +25,7 @@
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
@@ -46,6 +59,26 @@ std::map<std::basic_string<char>, int> fieldIndex;
 // Vector of fields in a global record
 std::vector<std::basic_string<char>> fieldVector;
 
+// A record structure and the index of each of its fields
+struct RecordLayout {
+  llvm::StructType *type;
+  std::map<std::string, int> fieldIndex;
+};
+
+/*
+ * Records with a known shape, i.e., a known set of fields, use a compact
+ * layout holding just those fields.  The layouts are keyed by their fields in
+ * the order of the global record, which is the layout of the shape with all
+ * of the fields.
+ */
+std::map<std::vector<std::string>, RecordLayout> recordLayouts;
+
+/*
+ * The type results that determine the shapes of records.  Without them every
+ * record uses the global record.
+ */
+TypeInference *recordTypes = nullptr;
+
 // Permits getFunction to access the current module being compiled
 std::shared_ptr<llvm::Module> CurrentModule;
 
@@ -58,7 +91,7 @@ llvm::Function *nop = nullptr;
 llvm::Function *inputIntrinsic = nullptr;
 llvm::Function *outputIntrinsic = nullptr;
 llvm::Function *errorIntrinsic = nullptr;
-llvm::Function *callocFun = nullptr;
+llvm::Function *allocFun = nullptr;
 
 // A counter to create shared labels
 int labelNum = 0;
@@ -71,6 +104,42 @@ bool allocFlag = false;
 
 llvm::GlobalVariable *tipFunctionTable = nullptr;
 
+/*
+ * The call graph is used to call functions directly rather than through the
+ * function table.  Without it every call goes through the table.
+ */
+CallGraph *callGraph = nullptr;
+
+// Calls that may reach more functions than this always go through the table
+const std::size_t maxGuardedCallees = 4;
+
+/*
+ * The range analysis results are used to omit the bounds checks of indexing
+ * that is known to be in bounds.  Without them every indexing is checked.
+ */
+std::shared_ptr<RangeAnalysis> rangeResults;
+
+// Indexing whose checks are covered by the guard of the loop being generated
+std::set<ASTIndexingExpr *> uncheckedAccesses;
+
+/*
+ * An array is the address of its elements, which start at a cache line so
+ * that vector loads and stores of them are aligned, and its length is in the
+ * word before them.  The memory of an array from the heap has room to align
+ * its elements within it.
+ */
+const int64_t arrayAlignment = 64;
+
+/*
+ * The escape analysis results are used to allocate the values of sites that
+ * do not escape their function in its frame.  Without them every alloc,
+ * array and alloc'd record is allocated in the heap.
+ */
+std::shared_ptr<EscapeAnalysis> escapeResults;
+
+// Arrays larger than this are allocated in the heap even if they do not escape
+const int64_t maxStackArrayBytes = 4096;
+
 int64_t numTIPArgs = 0;
 
 /*
@@ -89,6 +158,363 @@ llvm::Constant *zeroV =
 llvm::Constant *oneV =
     llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 1);
 
+/*
+ * In typed mode the results of type inference select the representation of
+ * values.  Integers, function values, and values whose type is not known
+ * precisely, e.g., in polymorphic functions, are Int64.  Booleans are Int1 and
+ * references, arrays and records are pointers.  Memory cells always hold 64
+ * bits, so booleans are widened when they are stored.  Without type results
+ * every value is an Int64.
+ */
+TypeInference *typeResults = nullptr;
+
+// The declarations of the names in namedValues, used to look up their types
+std::map<std::string, ASTDeclNode *> namedDecls;
+
+// The declarations of the functions, used to look up their types
+std::map<std::string, ASTDeclNode *> functionDecls;
+
+// The representations of the values of declarations and expressions
+std::map<ASTNode *, llvm::Type *> valueTypes;
+
+/*
+ * Whether function signatures follow the inferred function types.  A generic
+ * type does not determine the signature at the sites that call instances of a
+ * polymorphic function through a function value, so programs with polymorphic
+ * functions keep the Int64 signatures.
+ */
+bool typedSignatures = false;
+
+/*
+ * In typed code the elements of arrays of booleans may be packed, so that
+ * element i is bit i % 64 of word i / 64 of the array.  The length stays in
+ * its word, so the length expression and the bounds checks do not depend on
+ * the packing.  The types of all of the arrays that
+ * an expression may evaluate to agree only when no function is polymorphic,
+ * and an element has no address of its own, so programs that take one are
+ * not packed.
+ */
+bool packBooleans = false;
+
+// The bit of the word returned by indexing a packed array for an L-value
+llvm::Value *packedBit = nullptr;
+
+bool isArray(TipType *type) {
+  if (auto mu = dynamic_cast<TipMu *>(type)) {
+    type = mu->getT().get();
+  }
+  return dynamic_cast<TipArray *>(type) != nullptr;
+}
+
+llvm::Type *llvmType(TipType *type) {
+  if (auto mu = dynamic_cast<TipMu *>(type)) {
+    type = mu->getT().get();
+  }
+
+  if (dynamic_cast<TipBool *>(type)) {
+    return llvm::Type::getInt1Ty(llvmContext);
+  } else if (dynamic_cast<TipRef *>(type) || dynamic_cast<TipArray *>(type) ||
+             dynamic_cast<TipRecord *>(type)) {
+    return llvm::PointerType::get(llvmContext, 0);
+  }
+  return llvm::Type::getInt64Ty(llvmContext);
+}
+
+llvm::Type *valueType(ASTDeclNode *decl) {
+  if (typeResults == nullptr) {
+    return llvm::Type::getInt64Ty(llvmContext);
+  }
+
+  auto known = valueTypes.find(decl);
+  if (known != valueTypes.end()) {
+    return known->second;
+  }
+  auto *type = llvmType(typeResults->getInferredType(decl).get());
+  valueTypes[decl] = type;
+  return type;
+}
+
+llvm::Type *valueType(ASTExpr *expr) {
+  if (typeResults == nullptr) {
+    return llvm::Type::getInt64Ty(llvmContext);
+  }
+
+  if (auto ve = dynamic_cast<ASTVariableExpr *>(expr)) {
+    auto local = namedDecls.find(ve->getName());
+    if (local != namedDecls.end()) {
+      return valueType(local->second);
+    }
+    return llvm::Type::getInt64Ty(llvmContext);
+  }
+
+  auto known = valueTypes.find(expr);
+  if (known != valueTypes.end()) {
+    return known->second;
+  }
+  auto *type = llvmType(typeResults->getInferredExprType(expr).get());
+  valueTypes[expr] = type;
+  return type;
+}
+
+// Memory cells hold booleans as Int64
+llvm::Type *storageType(llvm::Type *type) {
+  return type->isIntegerTy(1) ? llvm::Type::getInt64Ty(llvmContext) : type;
+}
+
+llvm::Type *boolType() {
+  return typeResults != nullptr ? llvm::Type::getInt1Ty(llvmContext)
+                                : llvm::Type::getInt64Ty(llvmContext);
+}
+
+/*
+ * Converts a value to another representation.  Mismatches arise where values
+ * flow in and out of polymorphic functions and through memory cells.
+ */
+llvm::Value *coerce(llvm::Value *value, llvm::Type *type) {
+  auto *from = value->getType();
+  if (from == type) {
+    return value;
+  }
+
+  if (from->isPointerTy()) {
+    if (type->isIntegerTy(1)) {
+      return irBuilder.CreateIsNotNull(value);
+    }
+    return irBuilder.CreatePtrToInt(value, type);
+  } else if (type->isPointerTy()) {
+    return irBuilder.CreateIntToPtr(value, type);
+  } else if (type->isIntegerTy(1)) {
+    return irBuilder.CreateICmpNE(value, llvm::ConstantInt::get(from, 0));
+  }
+  return irBuilder.CreateZExt(value, type);
+}
+
+// Pointers are only converted to Int64 when not generating typed code
+llvm::Value *fromPointer(llvm::Value *pointer, const std::string &name) {
+  if (typeResults != nullptr) {
+    return pointer;
+  }
+  return irBuilder.CreatePtrToInt(pointer, llvm::Type::getInt64Ty(llvmContext),
+                                  name);
+}
+
+// Comparisons are only widened to Int64 when not generating typed code
+llvm::Value *fromBool(llvm::Value *cmp, const std::string &name) {
+  if (typeResults != nullptr) {
+    return cmp;
+  }
+  return irBuilder.CreateIntCast(
+      cmp, llvm::IntegerType::getInt64Ty(llvmContext), false, name);
+}
+
+/*
+ * Type-based alias analysis metadata tells LLVM which accesses cannot touch
+ * the same memory.  The lengths of arrays are apart from all other memory.
+ * Array elements, each field of records and the cells from alloc are kinds
+ * of cells, which references point to.  A dereference reaches an element or
+ * a field when its address is taken, so in programs that take one,
+ * dereferences access any cell.  Accesses to the locals of functions are not
+ * tagged, so they may alias any other.
+ */
+bool cellAddressesTaken = false;
+
+// Returns the tag of accesses to a kind of cell, any cell if kind is empty
+llvm::MDNode *cellTag(const std::string &kind) {
+  llvm::MDBuilder builder(llvmContext);
+  auto *type = builder.createTBAAScalarTypeNode(
+      "cell", builder.createTBAARoot("TIP memory"));
+  if (!kind.empty()) {
+    type = builder.createTBAAScalarTypeNode(kind, type);
+  }
+  return builder.createTBAAStructTagNode(type, type, 0);
+}
+
+llvm::MDNode *lengthTag() {
+  llvm::MDBuilder builder(llvmContext);
+  auto *type = builder.createTBAAScalarTypeNode(
+      "array length", builder.createTBAARoot("TIP memory"));
+  return builder.createTBAAStructTagNode(type, type, 0);
+}
+
+llvm::MDNode *elementTag() { return cellTag("array element"); }
+
+llvm::MDNode *fieldTag(const std::string &field) {
+  return cellTag("field " + field);
+}
+
+llvm::MDNode *allocTag() { return cellTag("alloc cell"); }
+
+llvm::MDNode *derefTag() {
+  return cellTag(cellAddressesTaken ? "" : "alloc cell");
+}
+
+// Returns the tag of the memory denoted by an l-value, nullptr for a local
+llvm::MDNode *lValueTag(ASTExpr *lValue) {
+  if (dynamic_cast<ASTIndexingExpr *>(lValue)) {
+    return elementTag();
+  } else if (auto access = dynamic_cast<ASTAccessExpr *>(lValue)) {
+    return fieldTag(access->getField());
+  } else if (dynamic_cast<ASTDeRefExpr *>(lValue)) {
+    return derefTag();
+  }
+  return nullptr;
+}
+
+// Tags a load or store with the kind of memory it accesses
+template <typename T> T *tagged(T *access, llvm::MDNode *tag) {
+  if (tag != nullptr) {
+    access->setMetadata(llvm::LLVMContext::MD_tbaa, tag);
+  }
+  return access;
+}
+
+llvm::Value *loadValue(llvm::Value *address, llvm::Type *type,
+                       const std::string &name, llvm::MDNode *tag = nullptr) {
+  auto *load =
+      tagged(irBuilder.CreateLoad(storageType(type), address, name), tag);
+  return coerce(load, type);
+}
+
+llvm::Value *storeValue(llvm::Value *value, llvm::Value *address,
+                        llvm::MDNode *tag = nullptr) {
+  return tagged(
+      irBuilder.CreateStore(coerce(value, storageType(value->getType())),
+                            address),
+      tag);
+}
+
+// Returns whether the arrays holding the element expression are packed
+bool isPacked(ASTExpr *element) {
+  return packBooleans && valueType(element)->isIntegerTy(1);
+}
+
+// The number of words holding the elements of a packed array
+llvm::Value *packedWords(llvm::Value *numElements) {
+  auto *intType = llvm::Type::getInt64Ty(llvmContext);
+  return irBuilder.CreateAShr(
+      irBuilder.CreateAdd(numElements, llvm::ConstantInt::get(intType, 63)),
+      6, "packedWords");
+}
+
+// Returns the address of the word holding an element, and its bit
+llvm::Value *packedWord(llvm::Value *arrayPtr, llvm::Value *index,
+                        llvm::Value *&bit) {
+  auto *intType = llvm::Type::getInt64Ty(llvmContext);
+  bit = irBuilder.CreateAnd(index, llvm::ConstantInt::get(intType, 63), "bit");
+  auto *wordIndex = irBuilder.CreateAShr(index, 6, "wordIndex");
+  return irBuilder.CreateInBoundsGEP(intType, arrayPtr, wordIndex, "wordPtr");
+}
+
+llvm::Value *loadPacked(llvm::Value *wordPtr, llvm::Value *bit) {
+  auto *word = tagged(irBuilder.CreateLoad(llvm::Type::getInt64Ty(llvmContext),
+                                           wordPtr, "word"),
+                      elementTag());
+  return irBuilder.CreateTrunc(irBuilder.CreateLShr(word, bit),
+                               llvm::Type::getInt1Ty(llvmContext),
+                               "elementVal");
+}
+
+llvm::Value *storePacked(llvm::Value *value, llvm::Value *wordPtr,
+                         llvm::Value *bit) {
+  auto *intType = llvm::Type::getInt64Ty(llvmContext);
+  auto *word =
+      tagged(irBuilder.CreateLoad(intType, wordPtr, "word"), elementTag());
+  auto *cleared = irBuilder.CreateAnd(
+      word, irBuilder.CreateNot(irBuilder.CreateShl(oneV, bit)), "cleared");
+  auto *element = irBuilder.CreateShl(
+      irBuilder.CreateZExt(coerce(value, llvm::Type::getInt1Ty(llvmContext)),
+                           intType),
+      bit);
+  return tagged(
+      irBuilder.CreateStore(irBuilder.CreateOr(cleared, element), wordPtr),
+      elementTag());
+}
+
+// Finds the elements and fields whose addresses are taken
+class TakenAddresses : public ASTVisitor {
+public:
+  // Whether the address of an element of an array of booleans is taken
+  bool booleanElements = false;
+
+  // Whether the address of any element or field is taken
+  bool cells = false;
+
+  void endVisit(ASTRefExpr *element) override {
+    auto *var = element->getVar();
+    if (dynamic_cast<ASTIndexingExpr *>(var) ||
+        dynamic_cast<ASTAccessExpr *>(var)) {
+      cells = true;
+    }
+    checkBoolean(var);
+  }
+
+  // The item of a loop is assigned through its address
+  void endVisit(ASTForStmt *element) override {
+    checkBoolean(element->getItem());
+  }
+
+private:
+  void checkBoolean(ASTExpr *e) {
+    if (typeResults != nullptr && dynamic_cast<ASTIndexingExpr *>(e) &&
+        dynamic_cast<TipBool *>(typeResults->getInferredExprType(e).get())) {
+      booleanElements = true;
+    }
+  }
+};
+
+/*
+ * Returns the signature of functions of the given type.  Types that are not
+ * function types, e.g., when the type results are not available, yield the
+ * Int64 signature of the given arity.
+ */
+llvm::FunctionType *functionType(TipType *type, std::size_t arity) {
+  if (auto mu = dynamic_cast<TipMu *>(type)) {
+    type = mu->getT().get();
+  }
+
+  std::vector<llvm::Type *> paramTypes(arity,
+                                       llvm::Type::getInt64Ty(llvmContext));
+  llvm::Type *returnType = llvm::Type::getInt64Ty(llvmContext);
+  auto fun = dynamic_cast<TipFunction *>(type);
+  if (fun != nullptr && fun->getParamTypes().size() == arity) {
+    auto params = fun->getParamTypes();
+    for (std::size_t i = 0; i < arity; i++) {
+      paramTypes[i] = llvmType(params[i].get());
+    }
+    returnType = llvmType(fun->getReturnType().get());
+  }
+  return llvm::FunctionType::get(returnType, paramTypes, false);
+}
+
+llvm::FunctionType *functionType(ASTDeclNode *decl, std::size_t arity) {
+  if (!typedSignatures || decl == nullptr) {
+    return functionType(static_cast<TipType *>(nullptr), arity);
+  }
+  return functionType(typeResults->getInferredType(decl).get(), arity);
+}
+
+/*
+ * Returns the signature used to call the value of the given expression.
+ * Function names and locals are typed through their declarations.
+ */
+llvm::FunctionType *calleeType(ASTExpr *callee, std::size_t arity) {
+  if (!typedSignatures) {
+    return functionType(static_cast<TipType *>(nullptr), arity);
+  }
+
+  if (auto ve = dynamic_cast<ASTVariableExpr *>(callee)) {
+    auto local = namedDecls.find(ve->getName());
+    if (local != namedDecls.end()) {
+      return functionType(local->second, arity);
+    }
+    auto fun = functionDecls.find(ve->getName());
+    if (fun != functionDecls.end()) {
+      return functionType(fun->second, arity);
+    }
+  }
+  return functionType(typeResults->getInferredExprType(callee).get(), arity);
+}
+
 /*
  * Create LLVM Function in Module associated with current program.
  * This function declares the function, but it does not generate code.
@@ -125,13 +551,11 @@ llvm::Function *getFunction(const std::string& functionName) {
 
     // Function Not Found, Create it.
 
-    std::vector<llvm::Type *> FormalTypes(formalNames.size(),
-                                          llvm::Type::getInt64Ty(llvmContext));
-
-    // Use type factory to create function from formal type to int
-
-    auto *scratchFunctionType = llvm::FunctionType::get(
-        llvm::Type::getInt64Ty(llvmContext), FormalTypes, false);
+    // In typed mode the signature follows the inferred type of the function
+    auto decl = functionDecls.find(functionName);
+    auto *scratchFunctionType = functionType(
+        decl != functionDecls.end() ? decl->second : nullptr,
+        formalNames.size());
 
     auto *scratchFunction = llvm::Function::Create(
         scratchFunctionType, llvm::Function::InternalLinkage, functionName,
@@ -142,6 +566,28 @@ llvm::Function *getFunction(const std::string& functionName) {
     for (auto &param : scratchFunction->args()) {
       param.setName(formalNames[i++]);
     }
+
+    // The elements of the arrays passed and returned start at a cache line
+    if (typedSignatures && decl != functionDecls.end()) {
+      auto *type = typeResults->getInferredType(decl->second).get();
+      if (auto mu = dynamic_cast<TipMu *>(type)) {
+        type = mu->getT().get();
+      }
+      if (auto fun = dynamic_cast<TipFunction *>(type)) {
+        auto params = fun->getParamTypes();
+        for (std::size_t p = 0; p < params.size(); p++) {
+          if (isArray(params[p].get())) {
+            scratchFunction->addParamAttr(
+                p, llvm::Attribute::getWithAlignment(
+                       llvmContext, llvm::Align(arrayAlignment)));
+          }
+        }
+        if (isArray(fun->getReturnType().get())) {
+          scratchFunction->addRetAttr(llvm::Attribute::getWithAlignment(
+              llvmContext, llvm::Align(arrayAlignment)));
+        }
+      }
+    }
     return scratchFunction;
   }
 }
@@ -151,11 +597,365 @@ llvm::Function *getFunction(const std::string& functionName) {
  * This is used for mutable variables, including arguments to functions.
  */
 llvm::AllocaInst *CreateEntryBlockAlloca(llvm::Function *TheFunction,
-                                         const std::string &VarName) {
+                                         const std::string &VarName,
+                                         llvm::Type *type = nullptr) {
   llvm::IRBuilder<> tmpAlloca(&TheFunction->getEntryBlock(),
                               TheFunction->getEntryBlock().begin());
-  return tmpAlloca.CreateAlloca(llvm::Type::getInt64Ty(llvmContext), nullptr,
-                                VarName);
+  if (type == nullptr) {
+    type = llvm::Type::getInt64Ty(llvmContext);
+  }
+  return tmpAlloca.CreateAlloca(type, nullptr, VarName);
+}
+
+// Returns whether the site is allocated in the frame of its function
+bool isStackAllocated(ASTExpr *site) {
+  return escapeResults != nullptr && escapeResults->isStackAllocatable(site);
+}
+
+/*
+ * Returns the fill function of the runtime library, which stores a value in
+ * the elements of an array.  It is declared when it is first used.
+ */
+llvm::Function *fillFunction() {
+  if (auto *fill = CurrentModule->getFunction("_tip_fill")) {
+    return fill;
+  }
+  auto *intType = llvm::Type::getInt64Ty(llvmContext);
+  auto *FT = llvm::FunctionType::get(
+      llvm::Type::getVoidTy(llvmContext),
+      {llvm::PointerType::get(llvmContext, 0), intType, intType}, false);
+  auto *fill = llvm::Function::Create(FT, llvm::Function::ExternalLinkage,
+                                      "_tip_fill", CurrentModule.get());
+  fill->addFnAttr(llvm::Attribute::NoUnwind);
+  fill->addFnAttr(llvm::Attribute::WillReturn);
+  fill->setMemoryEffects(
+      llvm::MemoryEffects::argMemOnly(llvm::ModRefInfo::Mod));
+  fill->addParamAttr(0, llvm::Attribute::NoCapture);
+  return fill;
+}
+
+// Returns the address of the length of an array
+llvm::Value *lengthAddress(llvm::Value *arrayPtr) {
+  return irBuilder.CreateInBoundsGEP(
+      llvm::Type::getInt64Ty(llvmContext), arrayPtr,
+      llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), -1, true),
+      "lengthPtr");
+}
+
+llvm::Value *arrayLength(llvm::Value *arrayPtr) {
+  return tagged(irBuilder.CreateLoad(llvm::Type::getInt64Ty(llvmContext),
+                                     lengthAddress(arrayPtr), "arrayLength"),
+                lengthTag());
+}
+
+// Allocates an object of a constant size in the heap
+llvm::CallInst *allocateObject(int64_t bytes, const std::string &name) {
+  auto *object = irBuilder.CreateCall(
+      allocFun,
+      {llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), bytes)},
+      name);
+  object->addRetAttr(
+      llvm::Attribute::getWithDereferenceableBytes(llvmContext, bytes));
+  return object;
+}
+
+/*
+ * Returns the elements of an array allocated in the heap.  Negative sizes
+ * yield an array with just its length, whose elements are never accessed.
+ */
+llvm::Value *heapArray(llvm::Value *arrayBytes) {
+  auto *intType = llvm::Type::getInt64Ty(llvmContext);
+  llvm::CallInst *object;
+  if (auto *bytes = llvm::dyn_cast<llvm::ConstantInt>(arrayBytes)) {
+    int64_t objectBytes =
+        std::max<int64_t>(bytes->getSExtValue(), 8) + arrayAlignment;
+    object = allocateObject(objectBytes, "arrayObject");
+  } else {
+    auto *objectBytes = irBuilder.CreateAdd(
+        irBuilder.CreateBinaryIntrinsic(llvm::Intrinsic::smax, arrayBytes,
+                                        llvm::ConstantInt::get(intType, 8)),
+        llvm::ConstantInt::get(intType, arrayAlignment), "objectBytes");
+    object = irBuilder.CreateCall(allocFun, {objectBytes}, "arrayObject");
+  }
+
+  // The first cache line past the length word
+  auto *unaligned = irBuilder.CreateGEP(
+      irBuilder.getInt8Ty(), object,
+      llvm::ConstantInt::get(intType, 8 + arrayAlignment - 1), "unaligned");
+  return irBuilder.CreateIntrinsic(
+      llvm::Intrinsic::ptrmask,
+      {llvm::PointerType::get(llvmContext, 0), intType},
+      {unaligned, llvm::ConstantInt::get(intType, -arrayAlignment, true)},
+      nullptr, "arrayPtr");
+}
+
+/*
+ * Allocate the memory of an array of numItems 64-bit words, its length and
+ * its elements, and return the address of its elements.  An array that does
+ * not escape its function is allocated in its frame, in the entry block when
+ * its size is a small constant.  Otherwise the size is checked when the array
+ * is created, and arrays too large for the frame are allocated in the heap.
+ * Memory from the heap is zeroed, and memory in the frame is zeroed too when
+ * zeroed is set.
+ */
+llvm::Value *allocateArray(ASTExpr *site, llvm::Value *numItems,
+                           llvm::Value *arrayBytes, bool zeroed = false) {
+  auto *intType = llvm::Type::getInt64Ty(llvmContext);
+  if (!isStackAllocated(site)) {
+    return heapArray(arrayBytes);
+  }
+
+  // The words of the frame before the cache line of the elements
+  auto *padding = llvm::ConstantInt::get(intType, arrayAlignment / 8 - 1);
+  auto *lineWords = llvm::ConstantInt::get(intType, arrayAlignment / 8);
+
+  llvm::Function *TheFunction = irBuilder.GetInsertBlock()->getParent();
+  if (auto *bytes = llvm::dyn_cast<llvm::ConstantInt>(arrayBytes)) {
+    if (bytes->getSExtValue() > 0 &&
+        bytes->getSExtValue() <= maxStackArrayBytes) {
+      auto *frame = CreateEntryBlockAlloca(
+          TheFunction, "arrayFrame",
+          llvm::ArrayType::get(intType, bytes->getSExtValue() / 8 +
+                                            arrayAlignment / 8 - 1));
+      frame->setAlignment(llvm::Align(arrayAlignment));
+      if (zeroed) {
+        irBuilder.CreateMemSet(
+            irBuilder.CreateInBoundsGEP(intType, frame, padding),
+            irBuilder.getInt8(0), arrayBytes, llvm::MaybeAlign(8));
+      }
+      return irBuilder.CreateInBoundsGEP(intType, frame, lineWords,
+                                         "arrayPtr");
+    }
+    return heapArray(arrayBytes);
+  }
+
+  labelNum++;
+  llvm::BasicBlock *FrameBB = llvm::BasicBlock::Create(
+      llvmContext, "framearray" + std::to_string(labelNum), TheFunction);
+  llvm::BasicBlock *HeapBB = llvm::BasicBlock::Create(
+      llvmContext, "heaparray" + std::to_string(labelNum), TheFunction);
+  llvm::BasicBlock *DoneBB = llvm::BasicBlock::Create(
+      llvmContext, "allocated" + std::to_string(labelNum), TheFunction);
+
+  // Negative sizes are large unsigned numbers, which go to the heap
+  auto *fits = irBuilder.CreateICmpULE(
+      arrayBytes, llvm::ConstantInt::get(intType, maxStackArrayBytes),
+      "fitsFrame");
+  irBuilder.CreateCondBr(fits, FrameBB, HeapBB);
+
+  irBuilder.SetInsertPoint(FrameBB);
+  auto *frame = irBuilder.CreateAlloca(
+      intType, irBuilder.CreateAdd(numItems, padding), "arrayFrame");
+  frame->setAlignment(llvm::Align(arrayAlignment));
+  if (zeroed) {
+    irBuilder.CreateMemSet(irBuilder.CreateInBoundsGEP(intType, frame, padding),
+                           irBuilder.getInt8(0), arrayBytes,
+                           llvm::MaybeAlign(8));
+  }
+  auto *framePtr =
+      irBuilder.CreateInBoundsGEP(intType, frame, lineWords, "framePtr");
+  irBuilder.CreateBr(DoneBB);
+
+  irBuilder.SetInsertPoint(HeapBB);
+  auto *heapPtr = heapArray(arrayBytes);
+  irBuilder.CreateBr(DoneBB);
+
+  irBuilder.SetInsertPoint(DoneBB);
+  auto *arrayPtr =
+      irBuilder.CreatePHI(llvm::PointerType::get(llvmContext, 0), 2, "arrayPtr");
+  arrayPtr->addIncoming(framePtr, FrameBB);
+  arrayPtr->addIncoming(heapPtr, HeapBB);
+  return arrayPtr;
+}
+
+/*
+ * Returns the layout of the records an expression evaluates to.  Creating and
+ * accessing a record yields the same type, so they agree on the layout.  The
+ * global record is used when the type does not determine the fields.
+ */
+RecordLayout &recordLayout(ASTExpr *record) {
+  auto &globalLayout = recordLayouts[fieldVector];
+  if (recordTypes == nullptr) {
+    return globalLayout;
+  }
+
+  std::shared_ptr<TipType> type;
+  if (auto ve = dynamic_cast<ASTVariableExpr *>(record)) {
+    auto local = namedDecls.find(ve->getName());
+    if (local == namedDecls.end()) {
+      return globalLayout;
+    }
+    type = recordTypes->getInferredType(local->second);
+  } else {
+    type = recordTypes->getInferredExprType(record);
+  }
+  if (auto mu = std::dynamic_pointer_cast<TipMu>(type)) {
+    type = mu->getT();
+  }
+
+  auto recordType = std::dynamic_pointer_cast<TipRecord>(type);
+  if (recordType == nullptr) {
+    return globalLayout;
+  }
+
+  std::vector<std::string> fields;
+  auto &inits = recordType->getInits();
+  for (std::size_t i = 0; i < inits.size(); i++) {
+    if (std::dynamic_pointer_cast<TipVar>(inits[i]) != nullptr) {
+      return globalLayout;
+    } else if (std::dynamic_pointer_cast<TipAbsentField>(inits[i]) == nullptr) {
+      fields.push_back(recordType->getNames()[i]);
+    }
+  }
+  if (fields.empty()) {
+    return globalLayout;
+  }
+
+  auto known = recordLayouts.find(fields);
+  if (known != recordLayouts.end()) {
+    return known->second;
+  }
+
+  RecordLayout layout;
+  std::string name = "record";
+  for (std::size_t i = 0; i < fields.size(); i++) {
+    layout.fieldIndex[fields[i]] = i;
+    name += "." + fields[i];
+  }
+  std::vector<llvm::Type *> members(fields.size(),
+                                    llvm::Type::getInt64Ty(llvmContext));
+  layout.type = llvm::StructType::create(llvmContext, members, name);
+  return recordLayouts[fields] = layout;
+}
+
+/*
+ * Returns the functions that a call may reach according to the call graph, in
+ * the order of the function table.  Main is declared without parameters and
+ * is only called through the table.  Calls that may reach too many functions
+ * yield no callees.
+ */
+std::vector<std::string> possibleCallees(ASTFunAppExpr *call) {
+  std::vector<std::string> callees;
+  if (callGraph == nullptr) {
+    return callees;
+  }
+
+  for (auto fn : callGraph->getCalledFuns(call)) {
+    if (fn->getName() != "main" &&
+        fn->getFormals().size() == call->getActuals().size()) {
+      callees.push_back(fn->getName());
+    }
+  }
+  if (callees.size() > maxGuardedCallees) {
+    callees.clear();
+  }
+
+  std::sort(callees.begin(), callees.end(),
+            [](const std::string &f1, const std::string &f2) {
+              return functionIndex[f1] < functionIndex[f2];
+            });
+  return callees;
+}
+
+/*
+ * Calls the named function directly.  The actuals are converted to the
+ * parameter types of the function and the result to the given type.
+ */
+llvm::Value *callDirectly(const std::string &functionName,
+                          const std::vector<llvm::Value *> &actuals,
+                          llvm::Type *resultType) {
+  auto *callee = getFunction(functionName);
+  std::vector<llvm::Value *> argsV;
+  for (auto &param : callee->args()) {
+    argsV.push_back(coerce(actuals[param.getArgNo()], param.getType()));
+  }
+  return coerce(irBuilder.CreateCall(callee, argsV, "calltmp"), resultType);
+}
+
+/*
+ * Calls the function with the given index through the function table.
+ */
+llvm::Value *callThroughTable(llvm::Value *funVal, llvm::FunctionType *funType,
+                              const std::vector<llvm::Value *> &actuals) {
+  /*
+   * Emit the GEP instruction to compute the address of LLVM function
+   * pointer to be called.
+   */
+  std::vector<llvm::Value *> indices;
+  indices.push_back(zeroV);
+  indices.push_back(funVal);
+
+  auto *gep = irBuilder.CreateInBoundsGEP(
+      tipFunctionTable->getValueType(), tipFunctionTable, indices, "ftableidx");
+
+  // Load the function pointer
+  auto *functionPointer = irBuilder.CreateLoad(
+      llvm::PointerType::get(llvmContext, 0), gep, "genfptr");
+
+  std::vector<llvm::Value *> argsV;
+  for (auto *argVal : actuals) {
+    argsV.push_back(coerce(argVal, funType->getParamType(argsV.size())));
+  }
+  return irBuilder.CreateCall(funType, functionPointer, argsV, "calltmp");
+}
+
+/*
+ * Emits a loop running the body for the item ranging from start up to, but
+ * excluding, end by the given increment.
+ */
+void emitRangeLoop(llvm::Value *ItemV, llvm::Value *StartV, llvm::Value *EndV,
+                   llvm::Value *IncrementV, ASTStmt *body) {
+  llvm::Function *TheFunction = irBuilder.GetInsertBlock()->getParent();
+  llvm::Type *intType = llvm::Type::getInt64Ty(llvmContext);
+
+  labelNum++;
+
+  llvm::BasicBlock *HeaderBB = llvm::BasicBlock::Create(
+      llvmContext, "header" + std::to_string(labelNum), TheFunction);
+  llvm::BasicBlock *BodyBB =
+      llvm::BasicBlock::Create(llvmContext, "body" + std::to_string(labelNum));
+  llvm::BasicBlock *ExitBB =
+      llvm::BasicBlock::Create(llvmContext, "exit" + std::to_string(labelNum));
+
+  // Set ItemV to StartV.
+  irBuilder.CreateStore(StartV, ItemV);
+
+  // Add an explicit branch from the current BB to the header
+  irBuilder.CreateBr(HeaderBB);
+
+  // Emit loop header
+  {
+    irBuilder.SetInsertPoint(HeaderBB);
+
+    // Check if item is less than EndV.
+    llvm::Value *CondV = irBuilder.CreateICmpSLT(
+        irBuilder.CreateLoad(intType, ItemV, "loadarg"), EndV, "loopcond");
+    irBuilder.CreateCondBr(CondV, BodyBB, ExitBB);
+  }
+
+  // Emit loop body
+  {
+    TheFunction->insert(TheFunction->end(), BodyBB);
+    irBuilder.SetInsertPoint(BodyBB);
+
+    llvm::Value *BodyV = body->codegen();
+    if (BodyV == nullptr) {
+      throw InternalError(                                 // LCOV_EXCL_LINE
+          "failed to generate bitcode for the loop body"); // LCOV_EXCL_LINE
+    }
+
+    // Increment iterator.
+    llvm::Value *CurrentItemV = irBuilder.CreateLoad(intType, ItemV, "loadarg");
+    llvm::Value *NextItemV =
+        irBuilder.CreateAdd(CurrentItemV, IncrementV, "iterator_inc");
+    irBuilder.CreateStore(NextItemV, ItemV);
+
+    irBuilder.CreateBr(HeaderBB);
+  }
+
+  // Emit loop exit block.
+  TheFunction->insert(TheFunction->end(), ExitBB);
+  irBuilder.SetInsertPoint(ExitBB);
 }
 } // namespace
 
@@ -163,9 +963,30 @@ llvm::AllocaInst *CreateEntryBlockAlloca(llvm::Function *TheFunction,
 
 std::shared_ptr<llvm::Module>
 ASTProgram::codegen(SemanticAnalysis *semanticAnalysis,
-                    const std::string &programName) {
+                    const std::string &programName,
+                    const CodeGenOptions &options) {
   LOG_S(1) << "Generating code for program " << programName;
 
+  typeResults = options.typed ? semanticAnalysis->getTypeResults() : nullptr;
+  valueTypes.clear();
+  auto functions = getFunctions();
+  bool polymorphic = std::any_of(functions.begin(), functions.end(),
+                                 [](auto fn) { return fn->isPoly(); });
+  typedSignatures = options.typed && !polymorphic;
+  TakenAddresses addresses;
+  accept(&addresses);
+  packBooleans =
+      options.packBooleans && typedSignatures && !addresses.booleanElements;
+  cellAddressesTaken = addresses.cells;
+
+  callGraph = options.directCalls ? semanticAnalysis->getCallGraph() : nullptr;
+  rangeResults =
+      options.eliminateBoundsChecks ? RangeAnalysis::analyze(this) : nullptr;
+  escapeResults = options.stackAllocation
+                      ? EscapeAnalysis::analyze(
+                            this, semanticAnalysis->getCallGraph())
+                      : nullptr;
+
   auto TheModule = std::make_shared<llvm::Module>(programName, llvmContext);
 
   llvm::Triple targetTriple(llvm::sys::getProcessTriple());
@@ -201,6 +1022,7 @@ ASTProgram::codegen(SemanticAnalysis *semanticAnalysis,
                      [](auto &d) { return d->getName(); });
 
       functionFormalNames[fn->getName()] = names;
+      functionDecls[fn->getName()] = fn->getDecl();
     }
 
     /*
@@ -289,18 +1111,25 @@ ASTProgram::codegen(SemanticAnalysis *semanticAnalysis,
         llvm::ConstantArray::get(inputArrayType, zeros), "_tip_input_array");
   }
 
-  // declare the calloc function
-  // the calloc function takes in two ints: the number of items and the size of
-  // the items
-  std::vector<llvm::Type *> twoInt(2, llvm::Type::getInt64Ty(llvmContext));
+  /*
+   * Declare the allocation function of the runtime library, which takes the
+   * size in bytes and returns zeroed memory.  Its attributes let LLVM treat it
+   * like calloc, e.g., removing allocations that are never used.  It exits
+   * when memory runs out, so it never returns null.
+   */
   auto *FT = llvm::FunctionType::get(llvm::PointerType::get(llvmContext, 0),
-                                     twoInt, false);
-  callocFun = llvm::Function::Create(FT, llvm::Function::ExternalLinkage,
-                                     "calloc", CurrentModule.get());
-  callocFun->addFnAttr(llvm::Attribute::NoUnwind);
-
-  callocFun->setAttributes(callocFun->getAttributes().addAttributeAtIndex(
-      callocFun->getContext(), 0, llvm::Attribute::NoAlias));
+                                     {llvm::Type::getInt64Ty(llvmContext)},
+                                     false);
+  allocFun = llvm::Function::Create(FT, llvm::Function::ExternalLinkage,
+                                    "_tip_alloc", CurrentModule.get());
+  allocFun->addFnAttr(llvm::Attribute::NoUnwind);
+  allocFun->addFnAttr(llvm::Attribute::getWithAllocKind(
+      llvmContext, llvm::AllocFnKind::Alloc | llvm::AllocFnKind::Zeroed));
+  allocFun->addFnAttr(
+      llvm::Attribute::getWithAllocSizeArgs(llvmContext, 0, std::nullopt));
+  allocFun->addFnAttr("alloc-family", "_tip_alloc");
+  allocFun->addRetAttr(llvm::Attribute::NoAlias);
+  allocFun->addRetAttr(llvm::Attribute::NonNull);
 
   /* We create a single unified record structure that is capable of representing
    * all records in a TIP program.  While wasteful of memory, this approach is
@@ -320,6 +1149,17 @@ ASTProgram::codegen(SemanticAnalysis *semanticAnalysis,
       llvm::StructType::create(llvmContext, member_values, "globalRecord");
   pointerToGlobalRecordType = llvm::PointerType::get(llvmContext, 0);
 
+  /*
+   * Records of known shapes get their own compact layouts.  Generic types do
+   * not determine the shapes of the records in polymorphic functions, so
+   * programs with polymorphic functions only use the global record.
+   */
+  recordLayouts.clear();
+  recordLayouts[fieldVector] = RecordLayout{globalRecordType, fieldIndex};
+  recordTypes = options.compactRecords && !polymorphic
+                    ? semanticAnalysis->getTypeResults()
+                    : nullptr;
+
   // Code is generated into the module by the other routines
   for (auto const &fn : getFunctions()) {
     fn->codegen();
@@ -348,6 +1188,7 @@ llvm::Value *ASTFunction::codegen() {
 
   // keep scope separate from prior definitions
   namedValues.clear();
+  namedDecls.clear();
 
   /*
    * Add arguments to the symbol table
@@ -381,14 +1222,16 @@ llvm::Value *ASTFunction::codegen() {
       namedValues[argName] = argAlloc;
     }
   } else {
+    auto formals = getFormals();
     for (auto &arg : TheFunction->args()) {
       // Create an alloca for this argument and store its value
-      llvm::AllocaInst *argAlloc =
-          CreateEntryBlockAlloca(TheFunction, arg.getName().str());
-      irBuilder.CreateStore(&arg, argAlloc);
+      llvm::AllocaInst *argAlloc = CreateEntryBlockAlloca(
+          TheFunction, arg.getName().str(), storageType(arg.getType()));
+      storeValue(&arg, argAlloc);
 
       // Record name binding to alloca
       namedValues[arg.getName().str()] = argAlloc;
+      namedDecls[arg.getName().str()] = formals[arg.getArgNo()];
     }
   }
 
@@ -425,8 +1268,7 @@ llvm::Value *ASTNumberExpr::codegen() {
 llvm::Value *ASTBoolExpr::codegen() {
   LOG_S(1) << "Generating code for " << *this;
   
-  return llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext),
-                                getValue());
+  return llvm::ConstantInt::get(boolType(), getValue());
 } // LCOV_EXCL_LINE
 
 llvm::Value *ASTArrayOfExpr::codegen() {
@@ -439,14 +1281,33 @@ llvm::Value *ASTArrayOfExpr::codegen() {
   }
 
   // the number of items or the size of the array to cast is sizeValue + 1 for the header for the length
+  bool packed = isPacked(getE2().get());
+  llvm::Value *words = packed ? packedWords(sizeValue) : sizeValue;
   llvm::Value *numItems = irBuilder.CreateAdd(
-      sizeValue,
+      words,
       llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 1),
       "numItems");
 
-  // Call calloc to allocate the memory
-  llvm::Value *sizeOfItem = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 8); // size of int64_t
-  llvm::Value *arrayPtr = irBuilder.CreateCall(callocFun, {numItems, sizeOfItem}, "arrayPtr");
+  // Allocate the memory, 8 bytes (the size of int64_t) for each item
+  llvm::Value *arrayBytes = irBuilder.CreateMul(
+      numItems, llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 8),
+      "arrayBytes");
+  /*
+   * A number is stored in all of the elements at once, and zero not at all,
+   * since the memory of the array is zeroed.  Likewise a packed array of
+   * true has all of its bits set, and one of false none.  Other elements are
+   * evaluated for each element, and packed ones are or'ed into the zeroed
+   * words.
+   */
+  auto *number = dynamic_cast<ASTNumberExpr *>(getE2().get());
+  auto *boolean =
+      packed ? dynamic_cast<ASTBoolExpr *>(getE2().get()) : nullptr;
+  bool zeroElements = number != nullptr && number->getValue() == 0;
+  if (packed) {
+    zeroElements = boolean == nullptr || !boolean->getValue();
+  }
+  llvm::Value *arrayPtr =
+      allocateArray(this, numItems, arrayBytes, zeroElements);
 
   // Cast the array pointer to int64_t*
   llvm::Value *int64Ptr = irBuilder.CreateBitCast(
@@ -454,14 +1315,26 @@ llvm::Value *ASTArrayOfExpr::codegen() {
       llvm::PointerType::get(llvm::Type::getInt64Ty(llvmContext), 0),
       "int64Ptr");
 
-  // Store the length of the array at index 0
-  irBuilder.CreateStore(sizeValue, int64Ptr);
+  // Store the length of the array before its elements
+  tagged(irBuilder.CreateStore(sizeValue, lengthAddress(int64Ptr)),
+         lengthTag());
+
+  if (number != nullptr || boolean != nullptr) {
+    if (!zeroElements) {
+      llvm::Value *fillValue =
+          packed ? llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext),
+                                          -1, true)
+                 : getE2()->codegen();
+      irBuilder.CreateCall(fillFunction(), {int64Ptr, words, fillValue});
+    }
+    return fromPointer(int64Ptr, "arrayIntVal");
+  }
 
   // Create an index variable for the loop
   llvm::Value *indexPtr = irBuilder.CreateAlloca(
       llvm::Type::getInt64Ty(llvmContext), nullptr, "indexPtr");
   irBuilder.CreateStore(
-      llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 1),
+      llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 0),
       indexPtr);
 
   // Prepare the loop blocks
@@ -482,7 +1355,7 @@ llvm::Value *ASTArrayOfExpr::codegen() {
   irBuilder.SetInsertPoint(LoopCondBB);
   llvm::Value *currentIndex = irBuilder.CreateLoad(
       llvm::Type::getInt64Ty(llvmContext), indexPtr, "currentIndex");
-  llvm::Value *loopCond = irBuilder.CreateICmpSLE(
+  llvm::Value *loopCond = irBuilder.CreateICmpSLT(
       currentIndex, sizeValue, "loopCond");
   irBuilder.CreateCondBr(loopCond, LoopBodyBB, LoopEndBB);
 
@@ -496,12 +1369,28 @@ llvm::Value *ASTArrayOfExpr::codegen() {
   }
 
   // Store elementValue into array at index currentIndex
-  llvm::Value *elementPtr = irBuilder.CreateInBoundsGEP(
-      llvm::Type::getInt64Ty(llvmContext),
-      int64Ptr,
-      {currentIndex},
-      "elementPtr");
-  irBuilder.CreateStore(elementValue, elementPtr);
+  if (packed) {
+    llvm::Value *bit;
+    llvm::Value *wordPtr = packedWord(int64Ptr, currentIndex, bit);
+    llvm::Value *word = tagged(
+        irBuilder.CreateLoad(llvm::Type::getInt64Ty(llvmContext), wordPtr,
+                             "word"),
+        elementTag());
+    llvm::Value *element = irBuilder.CreateShl(
+        irBuilder.CreateZExt(
+            coerce(elementValue, llvm::Type::getInt1Ty(llvmContext)),
+            llvm::Type::getInt64Ty(llvmContext)),
+        bit);
+    tagged(irBuilder.CreateStore(irBuilder.CreateOr(word, element), wordPtr),
+           elementTag());
+  } else {
+    llvm::Value *elementPtr = irBuilder.CreateInBoundsGEP(
+        llvm::Type::getInt64Ty(llvmContext),
+        int64Ptr,
+        {currentIndex},
+        "elementPtr");
+    storeValue(elementValue, elementPtr, elementTag());
+  }
 
   // Increment the index
   llvm::Value *nextIndex = irBuilder.CreateAdd(
@@ -517,8 +1406,7 @@ llvm::Value *ASTArrayOfExpr::codegen() {
   irBuilder.SetInsertPoint(LoopEndBB);
 
   // Return the array pointer casted to int64_t
-  return irBuilder.CreatePtrToInt(
-      int64Ptr, llvm::Type::getInt64Ty(llvmContext), "arrayIntVal");
+  return fromPointer(int64Ptr, "arrayIntVal");
 } // LCOV_EXCL_LINE
 
 llvm::Value *ASTIndexingExpr::codegen() {
@@ -537,9 +1425,8 @@ llvm::Value *ASTIndexingExpr::codegen() {
       arrayVal, llvm::PointerType::getUnqual(llvm::Type::getInt64Ty(llvmContext)),
       "arrayPtr");
 
-  // Load the length from the first element (index 0)
-  llvm::Value *length = irBuilder.CreateLoad(
-      llvm::Type::getInt64Ty(llvmContext), arrayPtr, "arrayLength");
+  // Load the length from the word before the elements
+  llvm::Value *length = arrayLength(arrayPtr);
 
   // Generate code for the index expression
   llvm::Value *indexVal = getIdx()->codegen();
@@ -548,6 +1435,28 @@ llvm::Value *ASTIndexingExpr::codegen() {
     throw InternalError("Failed to generate code for the index expression");
   }
 
+  // Skip the bounds checks of indexing that is known to be in bounds
+  bool packed = isPacked(this);
+  if (rangeResults != nullptr && (rangeResults->isInBounds(this) ||
+                                  uncheckedAccesses.count(this) != 0)) {
+    if (packed) {
+      llvm::Value *bit;
+      llvm::Value *wordPtr = packedWord(arrayPtr, indexVal, bit);
+      if (lValueGen) {
+        packedBit = bit;
+        return wordPtr;
+      }
+      return loadPacked(wordPtr, bit);
+    }
+    llvm::Value *elementPtr = irBuilder.CreateInBoundsGEP(
+        llvm::Type::getInt64Ty(llvmContext), arrayPtr, indexVal,
+        "elementPtr");
+    if (lValueGen) {
+      return elementPtr;
+    }
+    return loadValue(elementPtr, valueType(this), "elementVal", elementTag());
+  }
+
   // Perform bounds checking
   llvm::Value *zeroConst = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 0);
   llvm::Value *isIndexNegative = irBuilder.CreateICmpSLT(indexVal, zeroConst, "isIndexNegative");
@@ -578,16 +1487,16 @@ llvm::Value *ASTIndexingExpr::codegen() {
   // In-bounds block
   irBuilder.SetInsertPoint(InBoundsBB);
 
-  // Adjust index to skip over the head
-  llvm::Value *adjustedIndex = irBuilder.CreateAdd(
-      indexVal,
-      llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 1),
-      "adjustedIndex");
-
-  // Get pointer to the desired element
-  llvm::Value *elementPtr = irBuilder.CreateGEP(
-      llvm::Type::getInt64Ty(llvmContext), arrayPtr, adjustedIndex,
-      "elementPtr");
+  // Get pointer to the desired element, or the word holding it if packed
+  llvm::Value *elementPtr;
+  llvm::Value *bit = nullptr;
+  if (packed) {
+    elementPtr = packedWord(arrayPtr, indexVal, bit);
+  } else {
+    elementPtr = irBuilder.CreateInBoundsGEP(
+        llvm::Type::getInt64Ty(llvmContext), arrayPtr, indexVal,
+        "elementPtr");
+  }
 
   irBuilder.CreateBr(ContinueBB);
 
@@ -600,12 +1509,13 @@ llvm::Value *ASTIndexingExpr::codegen() {
     // PHI node to select the correct element pointer
     llvm::PHINode *phiElementPtr = irBuilder.CreatePHI(elementPtr->getType(), 1, "phiElementPtr");
     phiElementPtr->addIncoming(elementPtr, InBoundsBB);
+    packedBit = bit;
     return phiElementPtr;
+  } else if (packed) {
+    return loadPacked(elementPtr, bit);
   } else {
     // Load and return the value
-    llvm::Value *elementVal = irBuilder.CreateLoad(
-        llvm::Type::getInt64Ty(llvmContext), elementPtr, "elementVal");
-    return elementVal;
+    return loadValue(elementPtr, valueType(this), "elementVal", elementTag());
   }
 }// LCOV_EXCL_LINE
 
@@ -628,28 +1538,22 @@ llvm::Value *ASTBinaryExpr::codegen() {
     return irBuilder.CreateSDiv(L, R, "divtmp");
   } else if (getOp() == ">") {
     auto *cmp = irBuilder.CreateICmpSGT(L, R, "_gttmp");
-    return irBuilder.CreateIntCast(
-        cmp, llvm::IntegerType::getInt64Ty(llvmContext), false, "gttmp");
+    return fromBool(cmp, "gttmp");
   } else if (getOp() == "<") {
     auto *cmp = irBuilder.CreateICmpSLT(L, R, "_lttmp");
-    return irBuilder.CreateIntCast(
-        cmp, llvm::IntegerType::getInt64Ty(llvmContext), false, "lttmp");
+    return fromBool(cmp, "lttmp");
   } else if (getOp() == ">=") {
     auto *cmp = irBuilder.CreateICmpSGE(L, R, "_getmp");
-    return irBuilder.CreateIntCast(
-        cmp, llvm::IntegerType::getInt64Ty(llvmContext), false, "getmp");
+    return fromBool(cmp, "getmp");
   } else if (getOp() == "<=") {
     auto *cmp = irBuilder.CreateICmpSLE(L, R, "_letmp");
-    return irBuilder.CreateIntCast(
-        cmp, llvm::IntegerType::getInt64Ty(llvmContext), false, "letmp");
+    return fromBool(cmp, "letmp");
   } else if (getOp() == "==") {
-    auto *cmp = irBuilder.CreateICmpEQ(L, R, "_eqtmp");
-    return irBuilder.CreateIntCast(
-        cmp, llvm::IntegerType::getInt64Ty(llvmContext), false, "eqtmp");
+    auto *cmp = irBuilder.CreateICmpEQ(L, coerce(R, L->getType()), "_eqtmp");
+    return fromBool(cmp, "eqtmp");
   } else if (getOp() == "!=") {
-    auto *cmp = irBuilder.CreateICmpNE(L, R, "_neqtmp");
-    return irBuilder.CreateIntCast(
-        cmp, llvm::IntegerType::getInt64Ty(llvmContext), false, "neqtmp");
+    auto *cmp = irBuilder.CreateICmpNE(L, coerce(R, L->getType()), "_neqtmp");
+    return fromBool(cmp, "neqtmp");
   } else if (getOp() == "and") {
     return irBuilder.CreateAnd(L, R, "andtmp");
   } else if (getOp() == "or") {
@@ -676,8 +1580,10 @@ llvm::Value *ASTVariableExpr::codegen() {
     if (lValueGen) {
       return namedValues[nv->first];
     } else {
-      return irBuilder.CreateLoad(nv->second->getAllocatedType(), nv->second,
-                                  getName().c_str());
+      auto decl = namedDecls.find(getName());
+      auto *type = (decl != namedDecls.end()) ? valueType(decl->second)
+                                              : nv->second->getAllocatedType();
+      return loadValue(nv->second, type, getName());
     }
   }
 
@@ -716,50 +1622,100 @@ llvm::Value *ASTFunAppExpr::codegen() {
   LOG_S(1) << "Generating code for " << *this;
 
   /*
-   * Evaluate the function expression - it will resolve to an integer value
-   * whether it is a function literal or an expression.
+   * A function name that is not shadowed by a local can only denote that
+   * function, so when it is the only possible callee the call is direct and
+   * the function expression need not be evaluated.
    */
-  auto *funVal = getFunction()->codegen();
-  if (funVal == nullptr) {
-    throw InternalError("failed to generate bitcode for the function");
-  }
+  auto callees = possibleCallees(this);
+  auto *name = dynamic_cast<ASTVariableExpr *>(getFunction());
+  bool direct = callees.size() == 1 && name != nullptr &&
+                name->getName() == callees.front() &&
+                namedValues.count(name->getName()) == 0;
 
   /*
-   * Emit the GEP instruction to compute the address of LLVM function
-   * pointer to be called.
+   * Evaluate the function expression - it will resolve to an integer value
+   * whether it is a function literal or an expression.
    */
-  std::vector<llvm::Value *> indices;
-  indices.push_back(zeroV);
-  indices.push_back(funVal);
-
-  auto *gep = irBuilder.CreateInBoundsGEP(
-      tipFunctionTable->getValueType(), tipFunctionTable, indices, "ftableidx");
-
-  // Load the function pointer
-  auto *functionPointer = irBuilder.CreateLoad(
-      llvm::PointerType::get(llvmContext, 0), gep, "genfptr");
+  llvm::Value *funVal = nullptr;
+  if (!direct) {
+    funVal = getFunction()->codegen();
+    if (funVal == nullptr) {
+      throw InternalError("failed to generate bitcode for the function");
+    }
+  }
 
   /*
-   * All functions are pointer types and return INT64.
-   *
+   * All functions are pointer types and return INT64, unless typed code is
+   * generated, in which case the signature follows the type of the function
+   * expression.
    */
-  std::vector<llvm::Type *> actualTypes(getActuals().size(),
-                                        llvm::Type::getInt64Ty(llvmContext));
-  auto *funType = llvm::FunctionType::get(llvm::Type::getInt64Ty(llvmContext),
-                                          actualTypes, false);
+  auto *funType = calleeType(getFunction(), getActuals().size());
 
   // Compute the actual parameters
-  std::vector<llvm::Value *> argsV;
+  std::vector<llvm::Value *> actuals;
   for (auto const &arg : getActuals()) {
     llvm::Value *argVal = arg->codegen();
     if (argVal == nullptr) {
       throw InternalError(                                // LCOV_EXCL_LINE
           "failed to generate bitcode for the argument"); // LCOV_EXCL_LINE
     }
-    argsV.push_back(argVal);
+    actuals.push_back(argVal);
   }
 
-  return irBuilder.CreateCall(funType, functionPointer, argsV, "calltmp");
+  if (direct) {
+    return callDirectly(callees.front(), actuals, funType->getReturnType());
+  } else if (callees.empty()) {
+    return callThroughTable(funVal, funType, actuals);
+  }
+
+  /*
+   * Compare the function value with each of the possible callees and call the
+   * matching one directly.  The call graph does not follow function values
+   * through memory, so any other value is still called through the table.
+   */
+  funVal = coerce(funVal, llvm::Type::getInt64Ty(llvmContext));
+  llvm::Function *TheFunction = irBuilder.GetInsertBlock()->getParent();
+
+  labelNum++; // create shared labels for these BBs
+  llvm::BasicBlock *MergeBB = llvm::BasicBlock::Create(
+      llvmContext, "callmerge" + std::to_string(labelNum));
+
+  std::vector<std::pair<llvm::Value *, llvm::BasicBlock *>> results;
+  for (auto const &callee : callees) {
+    llvm::BasicBlock *CallBB = llvm::BasicBlock::Create(
+        llvmContext, "call" + std::to_string(labelNum), TheFunction);
+    llvm::BasicBlock *NextBB = llvm::BasicBlock::Create(
+        llvmContext, "callnext" + std::to_string(labelNum), TheFunction);
+
+    auto *isCallee = irBuilder.CreateICmpEQ(
+        funVal,
+        llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext),
+                               functionIndex[callee]),
+        "iscallee");
+    irBuilder.CreateCondBr(isCallee, CallBB, NextBB);
+
+    irBuilder.SetInsertPoint(CallBB);
+    auto *result = callDirectly(callee, actuals, funType->getReturnType());
+    irBuilder.CreateBr(MergeBB);
+    results.emplace_back(result, irBuilder.GetInsertBlock());
+
+    irBuilder.SetInsertPoint(NextBB);
+  }
+
+  auto *result = callThroughTable(funVal, funType, actuals);
+  irBuilder.CreateBr(MergeBB);
+  results.emplace_back(result, irBuilder.GetInsertBlock());
+
+  // Emit merge block.
+  TheFunction->insert(TheFunction->end(), MergeBB);
+  irBuilder.SetInsertPoint(MergeBB);
+
+  llvm::PHINode *PhiNode =
+      irBuilder.CreatePHI(funType->getReturnType(), results.size(), "calltmp");
+  for (auto &incoming : results) {
+    PhiNode->addIncoming(incoming.first, incoming.second);
+  }
+  return PhiNode;
 }
 
 /* 'alloc' Allocate expression
@@ -776,26 +1732,25 @@ llvm::Value *ASTAllocExpr::codegen() {
                         "alloc expression");
   }
 
-  // Allocate an int pointer with calloc
-  std::vector<llvm::Value *> twoArg;
-  twoArg.push_back(
-      llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 1));
-  twoArg.push_back(
-      llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 8));
-  auto *allocInst = irBuilder.CreateCall(callocFun, twoArg, "allocPtr");
+  // Allocate an int pointer, in the frame if it does not escape the function
+  llvm::Value *allocInst;
+  if (isStackAllocated(this)) {
+    allocInst = CreateEntryBlockAlloca(
+        irBuilder.GetInsertBlock()->getParent(), "allocPtr");
+  } else {
+    allocInst = allocateObject(8, "allocPtr");
+  }
 
   // Initialize with argument
-  irBuilder.CreateStore(argVal, allocInst);
+  storeValue(argVal, allocInst, allocTag());
 
-  return irBuilder.CreatePtrToInt(
-      allocInst, llvm::Type::getInt64Ty(llvmContext), "allocIntVal");
+  return fromPointer(allocInst, "allocIntVal");
 }
 
 llvm::Value *ASTNullExpr::codegen() {
   auto *nullPtr =
       llvm::ConstantPointerNull::get(llvm::PointerType::get(llvmContext, 0));
-  return irBuilder.CreatePtrToInt(nullPtr, llvm::Type::getInt64Ty(llvmContext),
-                                  "nullPtrIntVal");
+  return fromPointer(nullPtr, "nullPtrIntVal");
 }
 
 /* '&' address of expression
@@ -815,8 +1770,7 @@ llvm::Value *ASTRefExpr::codegen() {
     throw InternalError("could not generate l-value for address of");
   }
 
-  return irBuilder.CreatePtrToInt(lValue, llvm::Type::getInt64Ty(llvmContext),
-                                  "addrOfPtr");
+  return fromPointer(lValue, "addrOfPtr");
 } // LCOV_EXCL_LINE
 
 /* '*' dereference expression
@@ -850,40 +1804,133 @@ llvm::Value *ASTDeRefExpr::codegen() {
     return address;
   } else {
     // For an r-value, return the value at the address
-    return irBuilder.CreateLoad(llvm::Type::getInt64Ty(llvmContext), address,
-                                "valueAt");
+    return loadValue(address, valueType(this), "valueAt", derefTag());
+  }
+}
+
+/*
+ * Returns the global holding the length and the elements of an array literal
+ * whose elements are all numbers or booleans, or nullptr if an element is
+ * not.  The elements start at a cache line of the global, like those of the
+ * arrays from the heap, and are packed when the array is.
+ */
+llvm::GlobalVariable *constantArray(ASTArrayExpr *literal, bool packed) {
+  auto *intType = llvm::Type::getInt64Ty(llvmContext);
+  auto elements = literal->getElements();
+  std::vector<llvm::Constant *> values(arrayAlignment / 8 - 1, zeroV);
+  values.push_back(llvm::ConstantInt::get(intType, elements.size()));
+  uint64_t word = 0;
+  for (size_t i = 0; i < elements.size(); i++) {
+    int64_t value;
+    if (auto number = dynamic_cast<ASTNumberExpr *>(elements[i].get())) {
+      value = number->getValue();
+    } else if (auto boolean = dynamic_cast<ASTBoolExpr *>(elements[i].get())) {
+      value = boolean->getValue();
+    } else {
+      return nullptr;
+    }
+
+    if (!packed) {
+      values.push_back(llvm::ConstantInt::get(intType, value, true));
+      continue;
+    }
+    word |= static_cast<uint64_t>(value != 0) << (i % 64);
+    if (i % 64 == 63 || i + 1 == elements.size()) {
+      values.push_back(llvm::ConstantInt::get(intType, word));
+      word = 0;
+    }
   }
+
+  auto *type = llvm::ArrayType::get(intType, values.size());
+  auto *global = new llvm::GlobalVariable(
+      *CurrentModule, type, true, llvm::GlobalValue::PrivateLinkage,
+      llvm::ConstantArray::get(type, values), "arrayLiteral");
+  global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+  global->setAlignment(llvm::Align(arrayAlignment));
+  return global;
 }
 
+/* [E1, ..., En] array expression
+ *
+ * An array of constants is copied from a global holding its length and
+ * elements, or is that global if it is never written.  A literal in a loop
+ * then yields the same array on each iteration, which is intended: the array
+ * cannot be told apart from a fresh copy except by comparing references.  Otherwise the length
+ * and each element are stored in turn, a word at a time for packed arrays.
+ */
 llvm::Value *ASTArrayExpr::codegen() {
   LOG_S(1) << "Generating code for " << *this;
 
   // codegen the elements of the array
   auto elements = getElements();
   size_t numElements = elements.size();
+  bool packed = numElements > 0 && isPacked(elements[0].get());
+  size_t words = packed ? (numElements + 63) / 64 : numElements;
+
+  llvm::Value *arrayBytes = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 8 * (1 + words)); // 8 is the size of int64_t (also the same size as an address)
+
+  if (auto *literal = constantArray(this, packed)) {
+    auto *elementsPtr = llvm::ConstantExpr::getInBoundsGetElementPtr(
+        llvm::Type::getInt64Ty(llvmContext), literal,
+        llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext),
+                               arrayAlignment / 8));
+    if (escapeResults != nullptr && escapeResults->isReadOnly(this)) {
+      return fromPointer(elementsPtr, "arrayIntVal");
+    }
+    llvm::Value *numItems = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 1 + words);
+    llvm::Value *arrayPtr = allocateArray(this, numItems, arrayBytes);
+    irBuilder.CreateMemCpy(lengthAddress(arrayPtr), llvm::MaybeAlign(8),
+                           lengthAddress(elementsPtr), llvm::MaybeAlign(8),
+                           arrayBytes);
+    return fromPointer(arrayPtr, "arrayIntVal");
+  }
 
-  llvm::Value *numItems = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 1 + numElements);
-  llvm::Value *sizeOfItem = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 8); // size of int64_t (also the same size as an address)
-
-  llvm::Value *arrayPtr = irBuilder.CreateCall(callocFun, {numItems, sizeOfItem}, "arrayPtr");
+  llvm::Value *numItems = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), 1 + words);
+  llvm::Value *arrayPtr = allocateArray(this, numItems, arrayBytes);
 
   llvm::Value *int64Ptr = irBuilder.CreateBitCast(arrayPtr, llvm::PointerType::get(llvm::Type::getInt64Ty(llvmContext), 0), "int64Ptr");
 
-  llvm::Value *lengthPtr = int64Ptr; // index 0
+  llvm::Value *lengthPtr = lengthAddress(int64Ptr);
   llvm::Value *arraySize = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), numElements);
-  irBuilder.CreateStore(arraySize, lengthPtr);
+  tagged(irBuilder.CreateStore(arraySize, lengthPtr), lengthTag());
+
+  // The bits of each word of a packed array are gathered before it is stored
+  if (packed) {
+    llvm::Value *word = zeroV;
+    for (size_t i = 0; i < numElements; ++i) {
+      llvm::Value *elementValue = elements[i]->codegen();
+      if (!elementValue) {
+        throw InternalError("Failed to generate code for array element");
+      }
+      llvm::Value *element = irBuilder.CreateZExt(
+          coerce(elementValue, llvm::Type::getInt1Ty(llvmContext)),
+          llvm::Type::getInt64Ty(llvmContext));
+      word = irBuilder.CreateOr(word, irBuilder.CreateShl(element, i % 64),
+                                "word");
+      if (i % 64 == 63 || i + 1 == numElements) {
+        llvm::Value *wordPtr = irBuilder.CreateInBoundsGEP(
+            llvm::Type::getInt64Ty(llvmContext), int64Ptr,
+            llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext),
+                                   i / 64),
+            "wordPtr");
+        tagged(irBuilder.CreateStore(word, wordPtr), elementTag());
+        word = zeroV;
+      }
+    }
+    return fromPointer(int64Ptr, "arrayIntVal");
+  }
 
   for (size_t i = 0; i < numElements; ++i) {
     llvm::Value *elementValue = elements[i]->codegen();
     if (!elementValue) {
       throw InternalError("Failed to generate code for array element");
     }
-    llvm::Value *index = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), i + 1); // +1 to skip length
+    llvm::Value *index = llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext), i);
     llvm::Value *elementPtr = irBuilder.CreateInBoundsGEP(llvm::Type::getInt64Ty(llvmContext), int64Ptr, index, "elementPtr");
-    irBuilder.CreateStore(elementValue, elementPtr);
+    storeValue(elementValue, elementPtr, elementTag());
   }
 
-  return irBuilder.CreatePtrToInt(int64Ptr, llvm::Type::getInt64Ty(llvmContext), "arrayIntVal");
+  return fromPointer(int64Ptr, "arrayIntVal");
 }
 
 /* '#' array length expression
@@ -902,9 +1949,7 @@ llvm::Value *ASTArrayLenExpr::codegen() {
       arrayVal, llvm::PointerType::get(llvm::Type::getInt64Ty(llvmContext), 0),
       "arrayPtr");
 
-  llvm::Value *length = irBuilder.CreateLoad(llvm::Type::getInt64Ty(llvmContext), arrayPtr, "arrayLength");
-
-  return length;
+  return arrayLength(arrayPtr);
 }
 
 /* 
@@ -970,6 +2015,7 @@ llvm::Value *ASTTernaryExpr::codegen() {
     throw InternalError(                                  // LCOV_EXCL_LINE
         "failed to generate bitcode for the else block"); // LCOV_EXCL_LINE
   }
+  ElseV = coerce(ElseV, ThenV->getType());
 
   irBuilder.CreateBr(MergeBB);
   ElseBB = irBuilder.GetInsertBlock();
@@ -988,28 +2034,46 @@ llvm::Value *ASTTernaryExpr::codegen() {
 
 /* {field1 : val1, ..., fieldN : valN} record expression
  *
- * Builds an instance of the GlobalRecord using the declared fields
+ * Builds an instance of the record layout for the shape of the record, which
+ * is the GlobalRecord unless compact layouts are used, using the declared
+ * fields
  */
 llvm::Value *ASTRecordExpr::codegen() {
   LOG_S(1) << "Generating code for " << *this;
 
-  // If this is an alloc, we calloc the record
+  auto &layout = recordLayout(this);
+
+  /*
+   * An alloc'd record that does not escape its function is allocated in its
+   * frame, with the fields that are not set zeroed as in the heap
+   */
+  if (allocFlag && isStackAllocated(this)) {
+    auto *recordPtr = CreateEntryBlockAlloca(
+        irBuilder.GetInsertBlock()->getParent(), "framedRecord", layout.type);
+    irBuilder.CreateStore(llvm::Constant::getNullValue(layout.type), recordPtr);
+    for (auto const &field : getFields()) {
+      auto *gep = irBuilder.CreateStructGEP(
+          layout.type, recordPtr, layout.fieldIndex[field->getField()],
+          field->getField());
+      auto value = field->codegen();
+      storeValue(value, gep, fieldTag(field->getField()));
+    }
+    return fromPointer(recordPtr, "recordPtr");
+  }
+
+  // If this is an alloc, we allocate the record on the heap
   if (allocFlag) {
     // Allocate a pointer to an global record
     auto *allocaRecord = irBuilder.CreateAlloca(pointerToGlobalRecordType);
 
-    // Use irBuilder to create the calloc call using pre-defined callocFun
+    // Allocate the record with the allocation function of the runtime
     auto sizeOfGlobalRecord = CurrentModule->getDataLayout()
-                                  .getStructLayout(globalRecordType)
+                                  .getStructLayout(layout.type)
                                   ->getSizeInBytes();
-    std::vector<llvm::Value *> callocArgs;
-    callocArgs.push_back(oneV);
-    callocArgs.push_back(llvm::ConstantInt::get(
-        llvm::Type::getInt64Ty(llvmContext), sizeOfGlobalRecord));
-    auto *calloc = irBuilder.CreateCall(callocFun, callocArgs, "callocedPtr");
+    auto *allocated = allocateObject(sizeOfGlobalRecord, "allocedPtr");
 
-    // Bitcast the calloc call to theStruct Type
-    auto recordPtr = calloc;
+    // Bitcast the allocation call to theStruct Type
+    auto recordPtr = allocated;
 
     // Store the ptr to the record in the record alloc
     irBuilder.CreateStore(recordPtr, allocaRecord);
@@ -1021,19 +2085,18 @@ llvm::Value *ASTRecordExpr::codegen() {
     // For each field, generate GEP for location of field in the globalRecord
     // Generate the code for the field and store it in the GEP
     for (auto const &field : getFields()) {
-      auto *gep = irBuilder.CreateStructGEP(globalRecordType, loadInst,
-                                            fieldIndex[field->getField()],
-                                            field->getField());
+      auto *gep = irBuilder.CreateStructGEP(
+          layout.type, loadInst, layout.fieldIndex[field->getField()],
+          field->getField());
       auto value = field->codegen();
-      irBuilder.CreateStore(value, gep);
+      storeValue(value, gep, fieldTag(field->getField()));
     }
 
     // Return int64 pointer to the pointer to the record
-    return irBuilder.CreatePtrToInt(
-        recordPtr, llvm::Type::getInt64Ty(llvmContext), "recordPtr");
+    return fromPointer(recordPtr, "recordPtr");
   } else {
     // Allocate the space for a global record
-    auto *allocaRecord = irBuilder.CreateAlloca(globalRecordType);
+    auto *allocaRecord = irBuilder.CreateAlloca(layout.type);
 
     // Codegen the fields present in this record and store them in the
     // appropriate location We do not give a value to fields that are not
@@ -1041,14 +2104,13 @@ llvm::Value *ASTRecordExpr::codegen() {
     for (auto const &field : getFields()) {
       auto *gep = irBuilder.CreateStructGEP(
           allocaRecord->getAllocatedType(), allocaRecord,
-          fieldIndex[field->getField()], field->getField());
+          layout.fieldIndex[field->getField()], field->getField());
       auto value = field->codegen();
-      irBuilder.CreateStore(value, gep);
+      storeValue(value, gep, fieldTag(field->getField()));
     }
     // Return int64 pointer to the record since all variables are pointers to
     // ints
-    return irBuilder.CreatePtrToInt(
-        allocaRecord, llvm::Type::getInt64Ty(llvmContext), "record");
+    return fromPointer(allocaRecord, "record");
   }
 }
 
@@ -1088,11 +2150,15 @@ llvm::Value *ASTAccessExpr::codegen() {
   llvm::Value *recordAddress =
       irBuilder.CreateIntToPtr(recordVal, pointerToGlobalRecordType);
 
-  // Generate the field index
-  auto index = fieldIndex[currField];
+  // Generate the field index in the layout of the record
+  auto &layout = recordLayout(getRecord());
+  if (layout.fieldIndex.count(currField) == 0) {
+    throw InternalError("The record layout lacks the field " + currField);
+  }
+  auto index = layout.fieldIndex[currField];
 
   // Generate the location of the field
-  auto *gep = irBuilder.CreateStructGEP(globalRecordType, recordAddress, index,
+  auto *gep = irBuilder.CreateStructGEP(layout.type, recordAddress, index,
                                         currField);
 
   // If LHS, return location of field
@@ -1101,10 +2167,7 @@ llvm::Value *ASTAccessExpr::codegen() {
   }
 
   // Load value at GEP and return it
-  auto fieldLoad =
-      irBuilder.CreateLoad(llvm::IntegerType::getInt64Ty(llvmContext), gep);
-  return irBuilder.CreatePtrToInt(
-      fieldLoad, llvm::Type::getInt64Ty(llvmContext), "fieldAccess");
+  return loadValue(gep, valueType(this), "fieldAccess", fieldTag(currField));
 }
 
 llvm::Value *ASTDeclNode::codegen() {
@@ -1121,13 +2184,15 @@ llvm::Value *ASTDeclStmt::codegen() {
 
   // Register all variables and emit their initializer.
   for (auto l : getVars()) {
-    localAlloca = CreateEntryBlockAlloca(TheFunction, l->getName());
+    auto *type = storageType(valueType(l));
+    localAlloca = CreateEntryBlockAlloca(TheFunction, l->getName(), type);
 
     // Initialize all locals to "0"
-    irBuilder.CreateStore(zeroV, localAlloca);
+    irBuilder.CreateStore(llvm::Constant::getNullValue(type), localAlloca);
 
     // Remember this binding.
     namedValues[l->getName()] = localAlloca;
+    namedDecls[l->getName()] = l;
   }
 
   // Return the body computation.
@@ -1141,6 +2206,8 @@ llvm::Value *ASTAssignStmt::codegen() {
   lValueGen = true;
   llvm::Value *lValue = getLHS()->codegen();
   lValueGen = false;
+  llvm::Value *bit = packedBit;
+  packedBit = nullptr;
 
   if (lValue == nullptr) {
     throw InternalError(
@@ -1153,7 +2220,16 @@ llvm::Value *ASTAssignStmt::codegen() {
         "failed to generate bitcode for the rhs of the assignment");
   }
 
-  return irBuilder.CreateStore(rValue, lValue);
+  // Locals are stored in their own representation
+  if (auto *local = llvm::dyn_cast<llvm::AllocaInst>(lValue)) {
+    return irBuilder.CreateStore(coerce(rValue, local->getAllocatedType()),
+                                 lValue);
+  }
+  // An element of a packed array is stored in its bit of the word
+  if (bit != nullptr) {
+    return storePacked(rValue, lValue, bit);
+  }
+  return storeValue(rValue, lValue, lValueTag(getLHS()));
 } // LCOV_EXCL_LINE
 
 llvm::Value *ASTBlockStmt::codegen() {
@@ -1181,7 +2257,9 @@ llvm::Value *ASTUpdateStmt::codegen() {
 
   // Loading the value of the argument -> everything is an int so we are assuming this 
   llvm::Type *intType = llvm::Type::getInt64Ty(llvmContext);
-  llvm::Value *argValLoaded = irBuilder.CreateLoad(intType, argVal, "loadarg");
+  llvm::MDNode *tag = lValueTag(getArg());
+  llvm::Value *argValLoaded =
+      tagged(irBuilder.CreateLoad(intType, argVal, "loadarg"), tag);
 
   llvm::Value *updatedVal;
   if (getIncrement()) {
@@ -1191,7 +2269,7 @@ llvm::Value *ASTUpdateStmt::codegen() {
   }
 
   // Storing the updated value into the argument value
-  irBuilder.CreateStore(updatedVal, argVal);
+  tagged(irBuilder.CreateStore(updatedVal, argVal), tag);
 
   return updatedVal;
 }
@@ -1271,14 +2349,6 @@ llvm::Value *ASTForStmt::codegen() {
 
   llvm::Function *TheFunction = irBuilder.GetInsertBlock()->getParent();
 
-  labelNum++;
-
-  llvm::BasicBlock *HeaderBB = llvm::BasicBlock::Create(
-      llvmContext, "header" + std::to_string(labelNum), TheFunction);
-  llvm::BasicBlock *BodyBB =
-      llvm::BasicBlock::Create(llvmContext, "body" + std::to_string(labelNum));
-  llvm::BasicBlock *ExitBB =
-      llvm::BasicBlock::Create(llvmContext, "exit" + std::to_string(labelNum));
   llvm::Type *intType = llvm::Type::getInt64Ty(llvmContext);
 
   bool using_range = getRangeStart() != nullptr && getRangeEnd() != nullptr;
@@ -1296,7 +2366,6 @@ llvm::Value *ASTForStmt::codegen() {
     llvm::Value *StartV;
     llvm::Value *EndV;
     llvm::Value *IncrementV = llvm::ConstantInt::get(intType, 1);
-    llvm::Value *CollectionV;
 
     // Generate start and end.
     StartV = getRangeStart()->codegen();
@@ -1317,68 +2386,109 @@ llvm::Value *ASTForStmt::codegen() {
       }
     }
 
-    // Set ItemV to StartV.
-    irBuilder.CreateStore(StartV, ItemV);
-
-
-    // Add an explicit branch from the current BB to the header
-    irBuilder.CreateBr(HeaderBB);
-
-    // Emit loop header
-    {
-      irBuilder.SetInsertPoint(HeaderBB);
-
-      // Check if item is less than EndV.
-      llvm::Value *CondV = irBuilder.CreateICmpSLT(
-          irBuilder.CreateLoad(intType, ItemV, "loadarg"), 
-          EndV, 
-          "loopcond"
-      );
-      irBuilder.CreateCondBr(CondV, BodyBB, ExitBB);
+    std::vector<RangeAnalysis::ArrayGuard> guards;
+    if (rangeResults != nullptr) {
+      guards = rangeResults->getGuards(this);
     }
-
-    // Emit loop body
-    {
-      TheFunction->insert(TheFunction->end(), BodyBB);
-      irBuilder.SetInsertPoint(BodyBB);
-
-      llvm::Value *BodyV = getBody()->codegen();
-      if (BodyV == nullptr) {
-        throw InternalError(                                 // LCOV_EXCL_LINE
-            "failed to generate bitcode for the loop body"); // LCOV_EXCL_LINE
+    for (auto const &guard : guards) {
+      if (namedValues.count(guard.array) == 0) {
+        guards.clear();
+        break;
       }
+    }
 
-      // Increment iterator.
-      llvm::Value *CurrentItemV = irBuilder.CreateLoad(intType, ItemV, "loadarg");
-      llvm::Value *NextItemV = irBuilder.CreateAdd(
-          CurrentItemV, 
-          IncrementV, 
-          "iterator_inc"
-      );
-      irBuilder.CreateStore(NextItemV, ItemV);
+    if (guards.empty()) {
+      emitRangeLoop(ItemV, StartV, EndV, IncrementV, getBody());
+      return irBuilder.CreateCall(nop);
+    }
 
-      irBuilder.CreateBr(HeaderBB);
+    /*
+     * Version the loop.  When the guards hold before the loop, none of the
+     * guarded indexing in its body can be out of bounds, so a copy of the
+     * loop without their checks is run.  An empty range runs no iterations
+     * and takes the checked copy.
+     */
+    labelNum++;
+    llvm::BasicBlock *UncheckedBB = llvm::BasicBlock::Create(
+        llvmContext, "unchecked" + std::to_string(labelNum));
+    llvm::BasicBlock *CheckedBB = llvm::BasicBlock::Create(
+        llvmContext, "checked" + std::to_string(labelNum));
+    llvm::BasicBlock *MergeBB = llvm::BasicBlock::Create(
+        llvmContext, "versionmerge" + std::to_string(labelNum));
+
+    llvm::Value *CondV = irBuilder.CreateICmpSLT(StartV, EndV, "nonempty");
+    for (auto const &guard : guards) {
+      llvm::BasicBlock *NotNullBB = llvm::BasicBlock::Create(
+          llvmContext, "guard" + std::to_string(labelNum), TheFunction);
+      llvm::BasicBlock *LengthBB = llvm::BasicBlock::Create(
+          llvmContext, "guardlength" + std::to_string(labelNum), TheFunction);
+
+      irBuilder.CreateCondBr(CondV, NotNullBB, CheckedBB);
+      irBuilder.SetInsertPoint(NotNullBB);
+      auto *arrayAlloca = namedValues[guard.array];
+      auto *arrayPtr = coerce(
+          irBuilder.CreateLoad(arrayAlloca->getAllocatedType(), arrayAlloca,
+                               guard.array),
+          llvm::PointerType::get(llvmContext, 0));
+      irBuilder.CreateCondBr(irBuilder.CreateIsNotNull(arrayPtr), LengthBB,
+                             CheckedBB);
+
+      // start + minOffset >= 0 and end - 1 + maxOffset < #array
+      irBuilder.SetInsertPoint(LengthBB);
+      auto *length = arrayLength(arrayPtr);
+      auto *lowOk = irBuilder.CreateICmpSGE(
+          StartV, llvm::ConstantInt::get(intType, -guard.minOffset), "lowok");
+      auto *highOk = irBuilder.CreateICmpSLE(
+          EndV,
+          irBuilder.CreateSub(length,
+                              llvm::ConstantInt::get(intType, guard.maxOffset)),
+          "highok");
+      CondV = irBuilder.CreateAnd(lowOk, highOk, "guardok");
     }
+    irBuilder.CreateCondBr(CondV, UncheckedBB, CheckedBB);
+
+    // Emit the copy of the loop without the guarded checks
+    TheFunction->insert(TheFunction->end(), UncheckedBB);
+    irBuilder.SetInsertPoint(UncheckedBB);
+    auto checkedAccesses = uncheckedAccesses;
+    uncheckedAccesses = rangeResults->getGuardedAccesses(this);
+    emitRangeLoop(ItemV, StartV, EndV, IncrementV, getBody());
+    uncheckedAccesses = checkedAccesses;
+    irBuilder.CreateBr(MergeBB);
 
-    // Emit loop exit block.
-    TheFunction->insert(TheFunction->end(), ExitBB);
-    irBuilder.SetInsertPoint(ExitBB);
+    // Emit the copy of the loop with all of the checks
+    TheFunction->insert(TheFunction->end(), CheckedBB);
+    irBuilder.SetInsertPoint(CheckedBB);
+    emitRangeLoop(ItemV, StartV, EndV, IncrementV, getBody());
+    irBuilder.CreateBr(MergeBB);
+
+    TheFunction->insert(TheFunction->end(), MergeBB);
+    irBuilder.SetInsertPoint(MergeBB);
     return irBuilder.CreateCall(nop);
   } else {
+    labelNum++;
+
+    llvm::BasicBlock *HeaderBB = llvm::BasicBlock::Create(
+        llvmContext, "header" + std::to_string(labelNum), TheFunction);
+    llvm::BasicBlock *BodyBB = llvm::BasicBlock::Create(
+        llvmContext, "body" + std::to_string(labelNum));
+    llvm::BasicBlock *ExitBB = llvm::BasicBlock::Create(
+        llvmContext, "exit" + std::to_string(labelNum));
+
     llvm::Value *IteratorV = getIterator()->codegen();
     if (IteratorV == nullptr) {
       throw InternalError("Failed to generate bitcode for the iterator in for statement");
     }
 
     llvm::AllocaInst *IndexV = irBuilder.CreateAlloca(intType, nullptr, "index");
-    irBuilder.CreateStore(llvm::ConstantInt::get(intType, 1), IndexV);
+    irBuilder.CreateStore(llvm::ConstantInt::get(intType, 0), IndexV);
 
     // Get array pointe and length.
     llvm::Value *arrayPtr = irBuilder.CreateIntToPtr(
       IteratorV, llvm::PointerType::get(llvm::Type::getInt64Ty(llvmContext), 0),
       "arrayPtr");
 
-    llvm::Value *length = irBuilder.CreateLoad(llvm::Type::getInt64Ty(llvmContext), arrayPtr, "arrayLength");
+    llvm::Value *length = arrayLength(arrayPtr);
 
 
     // Add an explicit branch from the current BB to the header
@@ -1389,7 +2499,7 @@ llvm::Value *ASTForStmt::codegen() {
       irBuilder.SetInsertPoint(HeaderBB);
 
       // Check if index is less than EndV.
-      llvm::Value *CondV = irBuilder.CreateICmpSLE(
+      llvm::Value *CondV = irBuilder.CreateICmpSLT(
           irBuilder.CreateLoad(intType, IndexV, "curIndex"), 
           length, 
           "loopcond"
@@ -1405,16 +2515,25 @@ llvm::Value *ASTForStmt::codegen() {
       // Get pointer to the desired element
       llvm::Value *CurrentIndexV = irBuilder.CreateLoad(intType, IndexV, "curIndex");
 
-      llvm::Value *elementPtr = irBuilder.CreateGEP(
-          llvm::Type::getInt64Ty(llvmContext), arrayPtr, CurrentIndexV,
-          "elementPtr");
-
-      llvm::Value *elementValue = irBuilder.CreateLoad(
-        llvm::Type::getInt64Ty(llvmContext),
-        elementPtr,
-        "elementValue");
+      // The element is copied as is, so it is loaded in the item's storage
+      auto *local = llvm::dyn_cast<llvm::AllocaInst>(ItemV);
+      llvm::Type *itemType =
+          local != nullptr ? local->getAllocatedType() : intType;
+      llvm::Value *elementValue;
+      if (isPacked(getItem())) {
+        llvm::Value *bit;
+        llvm::Value *wordPtr = packedWord(arrayPtr, CurrentIndexV, bit);
+        elementValue = coerce(loadPacked(wordPtr, bit), itemType);
+      } else {
+        llvm::Value *elementPtr = irBuilder.CreateInBoundsGEP(
+            llvm::Type::getInt64Ty(llvmContext), arrayPtr, CurrentIndexV,
+            "elementPtr");
+        elementValue = tagged(
+            irBuilder.CreateLoad(itemType, elementPtr, "elementValue"),
+            elementTag());
+      }
 
-      irBuilder.CreateStore(elementValue, ItemV);
+      tagged(irBuilder.CreateStore(elementValue, ItemV), lValueTag(getItem()));
 
       llvm::Value *BodyV = getBody()->codegen();
       if (BodyV == nullptr) {
@@ -1432,11 +2551,12 @@ llvm::Value *ASTForStmt::codegen() {
 
       irBuilder.CreateBr(HeaderBB);
     }
+
+    // Emit loop exit block.
+    TheFunction->insert(TheFunction->end(), ExitBB);
+    irBuilder.SetInsertPoint(ExitBB);
+    return irBuilder.CreateCall(nop);
   }
-  // Emit loop exit block.
-  TheFunction->insert(TheFunction->end(), ExitBB);
-  irBuilder.SetInsertPoint(ExitBB);
-  return irBuilder.CreateCall(nop);
 }
 
 /*
@@ -1547,7 +2667,8 @@ llvm::Value *ASTOutputStmt::codegen() {
         "failed to generate bitcode for the argument of the output statement");
   }
 
-  std::vector<llvm::Value *> ArgsV(1, argVal);
+  std::vector<llvm::Value *> ArgsV(
+      1, coerce(argVal, llvm::Type::getInt64Ty(llvmContext)));
 
   return irBuilder.CreateCall(outputIntrinsic, ArgsV);
 }
@@ -1569,7 +2690,8 @@ llvm::Value *ASTErrorStmt::codegen() {
         "failed to generate bitcode for the argument of the error statement");
   }
 
-  std::vector<llvm::Value *> ArgsV(1, argVal);
+  std::vector<llvm::Value *> ArgsV(
+      1, coerce(argVal, llvm::Type::getInt64Ty(llvmContext)));
 
   return irBuilder.CreateCall(errorIntrinsic, ArgsV);
 }
@@ -1578,6 +2700,10 @@ llvm::Value *ASTReturnStmt::codegen() {
   LOG_S(1) << "Generating code for " << *this;
 
   llvm::Value *argVal = getArg()->codegen();
+  if (typeResults != nullptr) {
+    auto *TheFunction = irBuilder.GetInsertBlock()->getParent();
+    argVal = coerce(argVal, TheFunction->getReturnType());
+  }
   return irBuilder.CreateRet(argVal);
 }
 
@@ -1589,7 +2715,8 @@ llvm::Value *ASTNotExpr::codegen() {
       throw InternalError("failed to generate bitcode for the argument of the not expression");
   }
 
-  return irBuilder.CreateXor(argVal, oneV, "nottmp");;
+  return irBuilder.CreateXor(
+      argVal, llvm::ConstantInt::get(argVal->getType(), 1), "nottmp");
 }
 
 llvm::Value *ASTNegExpr::codegen() {
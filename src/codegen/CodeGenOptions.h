@@ -0,0 +1,28 @@
+#pragma once
+
+/*! \struct CodeGenOptions
+ *  \brief Selects optional code generation strategies.
+ *
+ * All options are off by default, which yields the baseline code in which
+ * every value is a 64-bit integer and every call goes through the function
+ * table.
+ */
+struct CodeGenOptions {
+  //! Represent values according to their inferred types
+  bool typed = false;
+
+  //! Call functions directly when the possible callees are known
+  bool directCalls = false;
+
+  //! Give each record shape a layout holding just its fields
+  bool compactRecords = false;
+
+  //! Omit bounds checks that range analysis shows to be unnecessary
+  bool eliminateBoundsChecks = false;
+
+  //! Allocate values that do not escape their function in its frame
+  bool stackAllocation = false;
+
+  //! Store the elements of arrays of booleans as bits, in typed code
+  bool packBooleans = false;
+};
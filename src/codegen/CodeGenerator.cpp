@@ -1,16 +1,92 @@
 #include "CodeGenerator.h"
+#include "TipRtlib.h"
+#include "loguru.hpp"
 #include <llvm/IR/Verifier.h>
 
 #include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/MC/TargetRegistry.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+#include <optional>
 
 using namespace llvm;
 
+namespace {
+
+/*
+ * Returns a machine for the target of the module, or null if the target is
+ * not available.  It generates code for the CPU and features the functions
+ * were optimized for, if any.
+ */
+std::unique_ptr<TargetMachine> targetMachine(Module *m) {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+
+  std::string error;
+  auto target = TargetRegistry::lookupTarget(m->getTargetTriple(), error);
+  if (target == nullptr) {
+    LOG_S(ERROR) << "tipc: error: " << error;
+    return nullptr;
+  }
+
+  std::string cpu = "generic";
+  std::string features;
+  for (auto &function : *m) {
+    if (function.hasFnAttribute("target-cpu")) {
+      cpu = function.getFnAttribute("target-cpu").getValueAsString().str();
+      features =
+          function.getFnAttribute("target-features").getValueAsString().str();
+      break;
+    }
+  }
+
+  // Position independent, since linkers default to position independent
+  // executables
+  return std::unique_ptr<TargetMachine>(target->createTargetMachine(
+      m->getTargetTriple(), cpu, features, TargetOptions(), Reloc::PIC_));
+}
+
+bool writeObject(Module *m, const std::string &filename) {
+  auto machine = targetMachine(m);
+  if (machine == nullptr) {
+    return false;
+  }
+  m->setDataLayout(machine->createDataLayout());
+
+  std::error_code ec;
+  ToolOutputFile result(filename, ec, sys::fs::OF_None);
+  if (ec) {
+    LOG_S(ERROR) << "tipc: error: failed to open '" << filename
+                 << "' for writing";
+    return false;
+  }
+
+  legacy::PassManager passManager;
+  if (machine->addPassesToEmitFile(passManager, result.os(), nullptr,
+                                   CGFT_ObjectFile)) {
+    LOG_S(ERROR) << "tipc: error: the target cannot emit object files";
+    return false;
+  }
+  passManager.run(*m);
+  result.keep();
+  return true;
+}
+
+} // namespace
+
 std::shared_ptr<Module>
 CodeGenerator::generate(ASTProgram *program, SemanticAnalysis *analysisResults,
-                        std::string fileName) {
-  return std::move(program->codegen(analysisResults, fileName));
+                        std::string fileName,
+                        const CodeGenOptions &options) {
+  return std::move(program->codegen(analysisResults, fileName, options));
 } // LCOV_EXCL_LINE
 
 void CodeGenerator::emit(llvm::Module *m, std::string filename) {
@@ -60,3 +136,53 @@ void CodeGenerator::emitHumanReadableAssembly(llvm::Module *m,
   m->print(result.os(), nullptr);
   result.keep();
 }
+
+bool CodeGenerator::emitObject(llvm::Module *m, std::string filename) {
+  if (filename.empty()) {
+    filename = m->getModuleIdentifier() + OBJECT_EXT;
+  }
+  return writeObject(m, filename);
+}
+
+bool CodeGenerator::emitExecutable(llvm::Module *m, std::string filename) {
+  if (filename.empty()) {
+    filename = sys::path::stem(m->getModuleIdentifier()).str();
+  }
+
+  // The object files are only needed until they are linked
+  SmallString<128> objectFile;
+  SmallString<128> rtlibFile;
+  if (sys::fs::createTemporaryFile("tipc", "o", objectFile) ||
+      sys::fs::createTemporaryFile("tip_rtlib", "o", rtlibFile)) {
+    LOG_S(ERROR) << "tipc: error: failed to create temporary object files";
+    return false;
+  }
+  FileRemover objectRemover(objectFile);
+  FileRemover rtlibRemover(rtlibFile);
+
+  if (!writeObject(m, objectFile.str().str())) {
+    return false;
+  }
+
+  {
+    std::error_code ec;
+    raw_fd_ostream rtlib(rtlibFile, ec, sys::fs::OF_None);
+    if (ec) {
+      LOG_S(ERROR) << "tipc: error: failed to open '" << rtlibFile.str().str()
+                   << "' for writing";
+      return false;
+    }
+    rtlib.write(reinterpret_cast<const char *>(tipRtlibObject),
+                tipRtlibObjectSize);
+  }
+
+  StringRef args[] = {TIPC_LINKER, "-o", filename, objectFile, rtlibFile};
+  std::string error;
+  if (sys::ExecuteAndWait(TIPC_LINKER, args, std::nullopt, {}, 0, 0,
+                          &error) != 0) {
+    LOG_S(ERROR) << "tipc: error: failed to link '" << filename << "' "
+                 << error;
+    return false;
+  }
+  return true;
+}
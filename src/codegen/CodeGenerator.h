@@ -1,11 +1,13 @@
 #pragma once
 
 #include "ASTProgram.h"
+#include "CodeGenOptions.h"
 #include "SemanticAnalysis.h"
 #include "llvm/IR/Module.h"
 
 static const char *const LLVM_ASM_EXT = ".ll";
 static const char *const LLVM_BC_EXT = ".bc";
+static const char *const OBJECT_EXT = ".o";
 
 /*! \class CodeGenerator
  *  \brief Routines to optimize generated code.
@@ -22,11 +24,13 @@ public:
    * \param program the root of an AST encoding the program
    * \param analysisResults the results from semantic analysis of the program
    * \param fileName the name of the source file holding the program
+   * \param options the optional code generation strategies to apply
    * \return the LLVM module holding the generated program
    */
   static std::shared_ptr<llvm::Module>
   generate(ASTProgram *program, SemanticAnalysis *analysisResults,
-           std::string fileName);
+           std::string fileName,
+           const CodeGenOptions &options = CodeGenOptions());
 
   /*! \fn emit
    *  \brief Emit LLVM IR to a file.
@@ -42,4 +46,23 @@ public:
    */
   static void emitHumanReadableAssembly(llvm::Module *m,
                                         std::string filename = "");
+
+  /*! \fn emitObject
+   *  \brief Emit a native object file.
+   *
+   * Code is generated for the CPU the program was optimized for, if any.
+   * \param m the LLVM module holding the generated program
+   * \return whether the object file was emitted
+   */
+  static bool emitObject(llvm::Module *m, std::string filename = "");
+
+  /*! \fn emitExecutable
+   *  \brief Emit an executable linked with the runtime library.
+   *
+   * The runtime library is embedded in tipc and the executable is linked by
+   * the system linker, so no separate link step is needed.
+   * \param m the LLVM module holding the generated program
+   * \return whether the executable was emitted
+   */
+  static bool emitExecutable(llvm::Module *m, std::string filename = "");
 };
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ * The object code of the runtime library, rtlib/tip_rtlib.c, compiled when
+ * tipc is built.  It is linked into the executables emitted by tipc.
+ */
+extern const unsigned char tipRtlibObject[];
+extern const std::size_t tipRtlibObjectSize;
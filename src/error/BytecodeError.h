@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Error.h"
+
+/*! \brief Class for tipc bytecode errors.
+ *
+ * Bytecode files that cannot be read or that fail verification generate
+ * instances of this type. \sa Error
+ */
+class BytecodeError : public Error {
+public:
+  BytecodeError(const std::string &msg)
+      : Error(msg) {} //! Construct bytecode error with message
+};
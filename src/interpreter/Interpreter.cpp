@@ -0,0 +1,531 @@
+#include "Interpreter.h"
+#include "InternalError.h"
+#include "RuntimeLibrary.h"
+#include "loguru.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+using rtlib::wrap;
+
+namespace {
+
+// Native code is called through function pointers of up to this many args
+const int maxNativeArity = 6;
+
+// Collects the variable expressions of a function
+class VariableCollector : public ASTVisitor {
+public:
+  std::vector<ASTVariableExpr *> variables;
+
+  void endVisit(ASTVariableExpr *element) override {
+    variables.push_back(element);
+  }
+};
+
+int64_t callNative(void *f, const std::vector<int64_t> &a) {
+  using I = int64_t;
+  switch (a.size()) {
+  case 0:
+    return reinterpret_cast<I (*)()>(f)();
+  case 1:
+    return reinterpret_cast<I (*)(I)>(f)(a[0]);
+  case 2:
+    return reinterpret_cast<I (*)(I, I)>(f)(a[0], a[1]);
+  case 3:
+    return reinterpret_cast<I (*)(I, I, I)>(f)(a[0], a[1], a[2]);
+  case 4:
+    return reinterpret_cast<I (*)(I, I, I, I)>(f)(a[0], a[1], a[2], a[3]);
+  case 5:
+    return reinterpret_cast<I (*)(I, I, I, I, I)>(f)(a[0], a[1], a[2], a[3],
+                                                     a[4]);
+  case 6:
+    return reinterpret_cast<I (*)(I, I, I, I, I, I)>(f)(a[0], a[1], a[2], a[3],
+                                                        a[4], a[5]);
+  }
+  throw InternalError("too many arguments for a native call"); // LCOV_EXCL_LINE
+}
+
+} // namespace
+
+int Interpreter::run(ASTProgram *program, SemanticAnalysis *analysis,
+                     const std::vector<std::string> &args, Compiler compiler,
+                     int64_t threshold) {
+  LOG_S(1) << "Interpreting program " << program->getName();
+
+  auto main = program->findFunctionByName("main");
+  if (main == nullptr) {
+    _tip_main_undefined();
+    return EXIT_FAILURE; // LCOV_EXCL_LINE
+  }
+
+  return rtlib::runMain(
+      args, main->getFormals().size(), [&](const std::vector<int64_t> &inputs) {
+        Interpreter interpreter(program, analysis, std::move(compiler),
+                                threshold);
+        return interpreter.call(main, inputs);
+      });
+}
+
+/*
+ * Functions are numbered in the order of the program, as they are in the
+ * function table of the generated code, and the fields of records are laid
+ * out in the order of the symbol table, as in the global record.  The
+ * variables of each function are resolved to frame slots up front.
+ */
+Interpreter::Interpreter(ASTProgram *program, SemanticAnalysis *analysis,
+                         Compiler compiler, int64_t threshold)
+    : compiler(std::move(compiler)), threshold(threshold) {
+  // Interpreted values live in heap frames the collector cannot scan.
+  _tip_gc_disable();
+  for (auto fn : program->getFunctions()) {
+    functionIndex[fn] = functions.size();
+    functions.push_back(FunctionInfo{fn, 0, 0});
+  }
+  std::map<std::string, int> functionNames;
+  for (auto &info : functions) {
+    functionNames[info.function->getName()] = functionIndex[info.function];
+  }
+
+  for (auto &info : functions) {
+    std::map<std::string, int> slots;
+    for (auto formal : info.function->getFormals()) {
+      slots.emplace(formal->getName(), slots.size());
+    }
+    info.arity = slots.size();
+    for (auto decl : info.function->getDeclarations()) {
+      for (auto local : decl->getVars()) {
+        slots.emplace(local->getName(), slots.size());
+      }
+    }
+    info.frameSize = slots.size();
+
+    VariableCollector collector;
+    info.function->accept(&collector);
+    for (auto variable : collector.variables) {
+      auto slot = slots.find(variable->getName());
+      if (slot != slots.end()) {
+        variables[variable] = slot->second;
+      } else if (functionNames.count(variable->getName()) != 0) {
+        variables[variable] = -1 - functionNames[variable->getName()];
+      } else {
+        throw InternalError("Unknown variable name: " + variable->getName());
+      }
+    }
+  }
+
+  for (auto &field : analysis->getSymbolTable()->getFields()) {
+    fieldIndex.emplace(field, fieldIndex.size());
+  }
+}
+
+Interpreter::~Interpreter() { waitForCompilation(); }
+
+void Interpreter::waitForCompilation() {
+  if (compilation.joinable()) {
+    compilation.join();
+  }
+}
+
+bool Interpreter::isPromoted(ASTFunction *function) const {
+  if (!compiled.load(std::memory_order_acquire)) {
+    return false;
+  }
+  auto index = functionIndex.at(function);
+  return functions[index].hot && nativeFunctions[index] != nullptr;
+}
+
+/*
+ * Hot functions other than main call their native code once it is ready.
+ * The native main takes its arguments from the input array instead.
+ */
+int64_t Interpreter::call(ASTFunction *function,
+                          const std::vector<int64_t> &args) {
+  auto index = functionIndex.at(function);
+  auto &info = functions[index];
+  if (++info.heat == threshold) {
+    promote(info);
+  }
+  if (info.hot && compiled.load(std::memory_order_acquire) &&
+      nativeFunctions[index] != nullptr) {
+    return callNative(nativeFunctions[index], args);
+  }
+
+  Frame callee{&info, std::vector<int64_t>(info.frameSize), {}};
+  for (int i = 0; i < info.arity; i++) {
+    callee.slots[i] = args[i];
+  }
+
+  auto caller = frame;
+  frame = &callee;
+  value = 0;
+  for (auto stmt : function->getStmts()) {
+    stmt->accept(this);
+  }
+  frame = caller;
+  return value;
+}
+
+// Counts a loop iteration of the running function
+void Interpreter::tick() {
+  if (++frame->info->heat == threshold) {
+    promote(*frame->info);
+  }
+}
+
+/*
+ * The first hot function starts the compilation of the program.  The native
+ * code of all of the functions is looked up on the compilation thread, so
+ * that the JIT compiles them there, and published by setting compiled.
+ */
+void Interpreter::promote(FunctionInfo &info) {
+  LOG_S(1) << "Function " << info.function->getName() << " is hot";
+  info.hot = true;
+  if (compiling || !compiler) {
+    return;
+  }
+  compiling = true;
+
+  compilation = std::thread([this] {
+    std::vector<void *> native(functions.size(), nullptr);
+    auto module = compiler();
+    auto jit = module != nullptr ? JIT::compile(module.get()) : nullptr;
+    if (jit != nullptr) {
+      for (std::size_t i = 0; i < functions.size(); i++) {
+        auto name = functions[i].function->getName();
+        if (name != "main" && functions[i].arity <= maxNativeArity) {
+          native[i] = jit->lookup("_tip_" + name);
+        }
+      }
+    }
+    nativeCode = std::move(jit);
+    nativeFunctions = std::move(native);
+    LOG_S(1) << "Optimized tier is ready";
+    compiled.store(true, std::memory_order_release);
+  });
+}
+
+// Runtime errors end the program, so the compilation is finished first
+void Interpreter::fail(int64_t code) {
+  waitForCompilation();
+  _tip_error(code);
+}
+
+int64_t Interpreter::eval(ASTExpr *e) {
+  e->accept(this);
+  return value;
+}
+
+// Evaluates an l-value to the address of its location
+int64_t *Interpreter::address(ASTExpr *e) {
+  lValue = true;
+  e->accept(this);
+  lValue = false;
+  return reinterpret_cast<int64_t *>(value);
+}
+
+/*
+ * Arrays are the addresses of their elements, which start at a cache line and
+ * follow their length, as in the generated code.
+ */
+int64_t *Interpreter::element(int64_t array, int64_t index) {
+  auto elements = reinterpret_cast<int64_t *>(array);
+  if (index < 0 || index >= elements[-1]) {
+    fail(0);
+  }
+  return elements + index;
+}
+
+int64_t *Interpreter::newArray(int64_t length) {
+  const int64_t alignment = 64;
+  auto object = static_cast<char *>(
+      _tip_alloc(std::max<int64_t>((length + 1) * 8, 8) + alignment));
+  auto elements = reinterpret_cast<int64_t *>(
+      (reinterpret_cast<uintptr_t>(object) + 8 + alignment - 1) &
+      ~static_cast<uintptr_t>(alignment - 1));
+  elements[-1] = length;
+  return elements;
+}
+
+bool Interpreter::visit(ASTNumberExpr *element) {
+  value = element->getValue();
+  return false;
+}
+
+bool Interpreter::visit(ASTBoolExpr *element) {
+  value = element->getValue() != 0;
+  return false;
+}
+
+bool Interpreter::visit(ASTVariableExpr *element) {
+  int slot = variables.at(element);
+  if (slot < 0) {
+    value = -1 - slot;
+  } else if (lValue) {
+    lValue = false;
+    value = reinterpret_cast<int64_t>(&frame->slots[slot]);
+  } else {
+    value = frame->slots[slot];
+  }
+  return false;
+}
+
+bool Interpreter::visit(ASTBinaryExpr *element) {
+  uint64_t l = eval(element->getLeft());
+  uint64_t r = eval(element->getRight());
+  auto sl = static_cast<int64_t>(l);
+  auto sr = static_cast<int64_t>(r);
+
+  auto op = element->getOp();
+  if (op == "+") {
+    value = wrap(l + r);
+  } else if (op == "-") {
+    value = wrap(l - r);
+  } else if (op == "*") {
+    value = wrap(l * r);
+  } else if (op == "/") {
+    value = sl / sr;
+  } else if (op == "%") {
+    value = sl % sr;
+  } else if (op == ">") {
+    value = sl > sr;
+  } else if (op == "<") {
+    value = sl < sr;
+  } else if (op == ">=") {
+    value = sl >= sr;
+  } else if (op == "<=") {
+    value = sl <= sr;
+  } else if (op == "==") {
+    value = sl == sr;
+  } else if (op == "!=") {
+    value = sl != sr;
+  } else if (op == "and") {
+    value = sl & sr;
+  } else if (op == "or") {
+    value = sl | sr;
+  } else {
+    throw InternalError("Invalid binary operator: " + op);
+  }
+  return false;
+}
+
+bool Interpreter::visit(ASTNotExpr *element) {
+  value = eval(element->getArg()) ^ 1;
+  return false;
+}
+
+bool Interpreter::visit(ASTNegExpr *element) {
+  value = wrap(-static_cast<uint64_t>(eval(element->getArg())));
+  return false;
+}
+
+bool Interpreter::visit(ASTInputExpr *element) {
+  value = _tip_input();
+  return false;
+}
+
+bool Interpreter::visit(ASTFunAppExpr *element) {
+  int64_t callee = eval(element->getFunction());
+  std::vector<int64_t> args;
+  for (auto actual : element->getActuals()) {
+    args.push_back(eval(actual));
+  }
+  value = call(functions[callee].function, args);
+  return false;
+}
+
+bool Interpreter::visit(ASTTernaryExpr *element) {
+  value = eval(element->getCondition()) != 0 ? eval(element->getThen())
+                                             : eval(element->getElse());
+  return false;
+}
+
+bool Interpreter::visit(ASTAllocExpr *element) {
+  allocating = true;
+  int64_t initial = eval(element->getInitializer());
+  allocating = false;
+
+  auto cell = static_cast<int64_t *>(_tip_alloc(8));
+  *cell = initial;
+  value = reinterpret_cast<int64_t>(cell);
+  return false;
+}
+
+bool Interpreter::visit(ASTRefExpr *element) {
+  value = reinterpret_cast<int64_t>(address(element->getVar()));
+  return false;
+}
+
+bool Interpreter::visit(ASTDeRefExpr *element) {
+  bool isLValue = lValue;
+  lValue = false;
+  int64_t pointer = eval(element->getPtr());
+  value = isLValue ? pointer : *reinterpret_cast<int64_t *>(pointer);
+  return false;
+}
+
+bool Interpreter::visit(ASTNullExpr *element) {
+  value = 0;
+  return false;
+}
+
+bool Interpreter::visit(ASTArrayExpr *element) {
+  auto elements = element->getElements();
+  auto array = newArray(elements.size());
+  for (std::size_t i = 0; i < elements.size(); i++) {
+    array[i] = eval(elements[i].get());
+  }
+  value = reinterpret_cast<int64_t>(array);
+  return false;
+}
+
+/*
+ * The element expression is evaluated for each element, unless it is a
+ * number, which is stored in all of them at once
+ */
+bool Interpreter::visit(ASTArrayOfExpr *element) {
+  int64_t length = eval(element->getE1().get());
+  auto array = newArray(length);
+  if (auto number = dynamic_cast<ASTNumberExpr *>(element->getE2().get())) {
+    if (number->getValue() != 0) {
+      _tip_fill(array, length, number->getValue());
+    }
+  } else {
+    for (int64_t i = 0; i < length; i++) {
+      array[i] = eval(element->getE2().get());
+    }
+  }
+  value = reinterpret_cast<int64_t>(array);
+  return false;
+}
+
+bool Interpreter::visit(ASTArrayLenExpr *element) {
+  value = reinterpret_cast<int64_t *>(eval(element->getPtr()))[-1];
+  return false;
+}
+
+bool Interpreter::visit(ASTIndexingExpr *element) {
+  bool isLValue = lValue;
+  lValue = false;
+  int64_t array = eval(element->getArr());
+  int64_t index = eval(element->getIdx());
+  auto location = this->element(array, index);
+  value = isLValue ? reinterpret_cast<int64_t>(location) : *location;
+  return false;
+}
+
+/*
+ * Records live in the frame of the function that creates them, like the
+ * allocas of the generated code, unless they are allocated.
+ */
+bool Interpreter::visit(ASTRecordExpr *element) {
+  int64_t *record;
+  if (allocating) {
+    record = static_cast<int64_t *>(_tip_alloc(fieldIndex.size() * 8));
+  } else {
+    frame->records.emplace_back(new int64_t[fieldIndex.size()]());
+    record = frame->records.back().get();
+  }
+  for (auto field : element->getFields()) {
+    record[fieldIndex.at(field->getField())] = eval(field);
+  }
+  value = reinterpret_cast<int64_t>(record);
+  return false;
+}
+
+bool Interpreter::visit(ASTFieldExpr *element) {
+  value = eval(element->getInitializer());
+  return false;
+}
+
+bool Interpreter::visit(ASTAccessExpr *element) {
+  bool isLValue = lValue;
+  lValue = false;
+  auto record = reinterpret_cast<int64_t *>(eval(element->getRecord()));
+  auto location = record + fieldIndex.at(element->getField());
+  value = isLValue ? reinterpret_cast<int64_t>(location) : *location;
+  return false;
+}
+
+// Locals are zeroed when the frame is created
+bool Interpreter::visit(ASTDeclStmt *element) { return false; }
+
+bool Interpreter::visit(ASTAssignStmt *element) {
+  auto location = address(element->getLHS());
+  *location = eval(element->getRHS());
+  return false;
+}
+
+bool Interpreter::visit(ASTBlockStmt *element) {
+  for (auto stmt : element->getStmts()) {
+    stmt->accept(this);
+  }
+  return false;
+}
+
+bool Interpreter::visit(ASTUpdateStmt *element) {
+  auto location = address(element->getArg());
+  *location = wrap(static_cast<uint64_t>(*location) +
+                   (element->getIncrement() ? 1 : -1));
+  return false;
+}
+
+bool Interpreter::visit(ASTWhileStmt *element) {
+  while (eval(element->getCondition()) != 0) {
+    element->getBody()->accept(this);
+    tick();
+  }
+  return false;
+}
+
+bool Interpreter::visit(ASTForStmt *element) {
+  auto item = address(element->getItem());
+
+  if (element->getRangeStart() != nullptr) {
+    int64_t start = eval(element->getRangeStart());
+    int64_t end = eval(element->getRangeEnd());
+    int64_t increment = 1;
+    if (element->getIncrement() != nullptr) {
+      increment = eval(element->getIncrement());
+    }
+
+    for (*item = start; *item < end;
+         *item = wrap(static_cast<uint64_t>(*item) + increment)) {
+      element->getBody()->accept(this);
+      tick();
+    }
+  } else {
+    auto array = reinterpret_cast<int64_t *>(eval(element->getIterator()));
+    int64_t length = array[-1];
+    for (int64_t i = 0; i < length; i++) {
+      *item = array[i];
+      element->getBody()->accept(this);
+      tick();
+    }
+  }
+  return false;
+}
+
+bool Interpreter::visit(ASTIfStmt *element) {
+  if (eval(element->getCondition()) != 0) {
+    element->getThen()->accept(this);
+  } else if (element->getElse() != nullptr) {
+    element->getElse()->accept(this);
+  }
+  return false;
+}
+
+bool Interpreter::visit(ASTOutputStmt *element) {
+  _tip_output(eval(element->getArg()));
+  return false;
+}
+
+bool Interpreter::visit(ASTErrorStmt *element) {
+  fail(eval(element->getArg()));
+  return false;
+}
+
+bool Interpreter::visit(ASTReturnStmt *element) {
+  value = eval(element->getArg());
+  return false;
+}
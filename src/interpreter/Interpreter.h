@@ -0,0 +1,148 @@
+#pragma once
+
+#include "ASTVisitor.h"
+#include "JIT.h"
+#include "SemanticAnalysis.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*! \class Interpreter
+ *  \brief Tiered execution of TIP programs.
+ *
+ * Programs start running right away in an interpreter over the AST, which
+ * counts the calls and loop iterations of each function.  Once a function
+ * reaches the threshold, the whole program is compiled with optimizations on
+ * a background thread, and when the native code is ready the calls to hot
+ * functions run it instead.  There is no on-stack replacement, so a function
+ * call that is already running, e.g., a hot loop in main, stays interpreted.
+ *
+ * Values are represented the way the generated code represents them, so the
+ * two tiers share arrays, records, pointers and function values.
+ */
+class Interpreter : public ASTVisitor {
+public:
+  //! Generates the LLVM module of the program for the optimized tier
+  using Compiler = std::function<std::shared_ptr<llvm::Module>()>;
+
+  /*! \brief Run a program.
+   *
+   * Interprets the main function with the given arguments, like an executable
+   * linked with the runtime library would run it.
+   * \param program the program AST
+   * \param analysis the semantic analysis results of the program
+   * \param args the arguments of the TIP main function
+   * \param compiler generates the code of the optimized tier
+   * \param threshold the number of calls and loop iterations that make a
+   * function hot
+   * \return the exit code of the program
+   */
+  static int run(ASTProgram *program, SemanticAnalysis *analysis,
+                 const std::vector<std::string> &args, Compiler compiler,
+                 int64_t threshold);
+
+  /*! \brief Set up the interpretation of a program.
+   * \param compiler generates the code of the optimized tier, or nothing to
+   * only interpret the program
+   */
+  Interpreter(ASTProgram *program, SemanticAnalysis *analysis,
+              Compiler compiler = nullptr, int64_t threshold = 1000);
+  ~Interpreter();
+
+  /*! \brief Call a function of the program.
+   * \return the value the function returns
+   */
+  int64_t call(ASTFunction *function, const std::vector<int64_t> &args);
+
+  //! Waits for the optimized tier if it is being compiled
+  void waitForCompilation();
+
+  //! Returns whether the calls to the function run native code
+  bool isPromoted(ASTFunction *function) const;
+
+  bool visit(ASTNumberExpr *element) override;
+  bool visit(ASTBoolExpr *element) override;
+  bool visit(ASTVariableExpr *element) override;
+  bool visit(ASTBinaryExpr *element) override;
+  bool visit(ASTNotExpr *element) override;
+  bool visit(ASTNegExpr *element) override;
+  bool visit(ASTInputExpr *element) override;
+  bool visit(ASTFunAppExpr *element) override;
+  bool visit(ASTTernaryExpr *element) override;
+  bool visit(ASTAllocExpr *element) override;
+  bool visit(ASTRefExpr *element) override;
+  bool visit(ASTDeRefExpr *element) override;
+  bool visit(ASTNullExpr *element) override;
+  bool visit(ASTArrayExpr *element) override;
+  bool visit(ASTArrayOfExpr *element) override;
+  bool visit(ASTArrayLenExpr *element) override;
+  bool visit(ASTIndexingExpr *element) override;
+  bool visit(ASTRecordExpr *element) override;
+  bool visit(ASTFieldExpr *element) override;
+  bool visit(ASTAccessExpr *element) override;
+  bool visit(ASTDeclStmt *element) override;
+  bool visit(ASTAssignStmt *element) override;
+  bool visit(ASTBlockStmt *element) override;
+  bool visit(ASTUpdateStmt *element) override;
+  bool visit(ASTWhileStmt *element) override;
+  bool visit(ASTForStmt *element) override;
+  bool visit(ASTIfStmt *element) override;
+  bool visit(ASTOutputStmt *element) override;
+  bool visit(ASTErrorStmt *element) override;
+  bool visit(ASTReturnStmt *element) override;
+
+private:
+  // What the interpreter keeps for a function, which is its function value
+  struct FunctionInfo {
+    ASTFunction *function;
+    int arity;
+    int frameSize;
+    int64_t heat = 0;
+    bool hot = false;
+  };
+
+  // The locals of a running function and the records it created
+  struct Frame {
+    FunctionInfo *info;
+    std::vector<int64_t> slots;
+    std::vector<std::unique_ptr<int64_t[]>> records;
+  };
+
+  std::vector<FunctionInfo> functions;
+  std::unordered_map<ASTFunction *, int> functionIndex;
+  std::map<std::string, int> fieldIndex;
+
+  /*
+   * A variable is either a local of the function it occurs in, stored at
+   * slot s >= 0, or the function with index i, stored as -1 - i.
+   */
+  std::unordered_map<ASTVariableExpr *, int> variables;
+
+  Frame *frame = nullptr;
+  int64_t value = 0;
+  bool lValue = false;
+  bool allocating = false;
+
+  Compiler compiler;
+  int64_t threshold;
+  std::thread compilation;
+  bool compiling = false;
+  std::atomic<bool> compiled{false};
+  std::unique_ptr<JIT> nativeCode;
+  std::vector<void *> nativeFunctions;
+
+  int64_t eval(ASTExpr *e);
+  int64_t *address(ASTExpr *e);
+  int64_t *element(int64_t array, int64_t index);
+  int64_t *newArray(int64_t length);
+  void tick();
+  void promote(FunctionInfo &info);
+  void fail(int64_t code);
+};
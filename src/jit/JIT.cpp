@@ -0,0 +1,132 @@
+#include "JIT.h"
+#include "RuntimeLibrary.h"
+#include "loguru.hpp"
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+// Reports a JIT error, returning whether there was one
+bool failed(Error error) {
+  if (error) {
+    LOG_S(ERROR) << "tipc: error: " << toString(std::move(error));
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Moves the module into a context of its own, which the JIT takes ownership
+ * of.  The context of the generated code is shared with the code generator.
+ */
+Expected<ThreadSafeModule> ownModule(Module *m) {
+  SmallVector<char, 0> bitcode;
+  raw_svector_ostream stream(bitcode);
+  WriteBitcodeToFile(*m, stream);
+
+  auto context = std::make_unique<LLVMContext>();
+  auto module = parseBitcodeFile(
+      MemoryBufferRef(StringRef(bitcode.data(), bitcode.size()),
+                      m->getModuleIdentifier()),
+      *context);
+  if (!module) {
+    return module.takeError();
+  }
+  return ThreadSafeModule(std::move(*module), std::move(context));
+}
+
+} // namespace
+
+JIT::JIT(std::unique_ptr<LLJIT> jit) : jit(std::move(jit)) {}
+
+JIT::~JIT() = default;
+
+std::unique_ptr<JIT> JIT::compile(Module *m) {
+  LOG_S(1) << "Compiling program " << m->getName().str();
+
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+
+  auto jit = LLJITBuilder().create();
+  if (!jit) {
+    failed(jit.takeError());
+    return nullptr;
+  }
+
+  // Calls to the runtime library go to the copy linked into tipc, and any
+  // other external functions are looked up in the tipc process
+  auto &library = (*jit)->getMainJITDylib();
+  SymbolMap runtime;
+  auto define = [&](const char *name, auto *function) {
+    runtime[(*jit)->mangleAndIntern(name)] = ExecutorSymbolDef(
+        ExecutorAddr::fromPtr(function), JITSymbolFlags::Exported);
+  };
+  define("_tip_input", &_tip_input);
+  define("_tip_output", &_tip_output);
+  define("_tip_error", &_tip_error);
+  define("_tip_main_undefined", &_tip_main_undefined);
+  define("_tip_alloc", &_tip_alloc);
+  define("_tip_fill", &_tip_fill);
+  if (failed(library.define(absoluteSymbols(std::move(runtime))))) {
+    return nullptr;
+  }
+  auto process = DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      (*jit)->getDataLayout().getGlobalPrefix());
+  if (!process) {
+    failed(process.takeError());
+    return nullptr;
+  }
+  library.addGenerator(std::move(*process));
+
+  auto module = ownModule(m);
+  if (!module) {
+    failed(module.takeError());
+    return nullptr;
+  }
+  if (failed((*jit)->addIRModule(std::move(*module)))) {
+    return nullptr;
+  }
+  return std::unique_ptr<JIT>(new JIT(std::move(*jit)));
+}
+
+void *JIT::lookup(const std::string &name) {
+  auto symbol = jit->lookup(name);
+  if (!symbol) {
+    failed(symbol.takeError());
+    return nullptr;
+  }
+  return symbol->toPtr<void *>();
+}
+
+int JIT::run(Module *m, const std::vector<std::string> &args) {
+  LOG_S(1) << "Running program " << m->getName().str();
+
+  auto jit = compile(m);
+  if (!jit) {
+    return EXIT_FAILURE;
+  }
+
+  auto numInputs = static_cast<int64_t *>(jit->lookup("_tip_num_inputs"));
+  auto inputs = static_cast<int64_t *>(jit->lookup("_tip_input_array"));
+  auto tipMain = reinterpret_cast<int64_t (*)()>(jit->lookup("_tip_main"));
+  if (numInputs == nullptr || inputs == nullptr || tipMain == nullptr) {
+    return EXIT_FAILURE;
+  }
+
+  return rtlib::runMain(args, *numInputs,
+                        [&](const std::vector<int64_t> &values) {
+                          std::copy(values.begin(), values.end(), inputs);
+                          return tipMain();
+                        });
+}
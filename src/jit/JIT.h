@@ -0,0 +1,52 @@
+#pragma once
+
+#include "llvm/IR/Module.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm::orc {
+class LLJIT;
+}
+
+/*! \class JIT
+ *  \brief Routines to run generated code in process.
+ *
+ * The calls to the runtime library from the compiled code go to the copy of
+ * it that is linked into tipc, see RuntimeLibrary.h.
+ */
+class JIT {
+public:
+  ~JIT();
+
+  /*! \brief Compile a program.
+   *
+   * Adds the module to an ORC LLJIT, which compiles its functions when they
+   * are first looked up.
+   * \param m the LLVM module holding the generated program
+   * \return the compiled program, or nothing if the JIT could not be set up
+   */
+  static std::unique_ptr<JIT> compile(llvm::Module *m);
+
+  /*! \brief Look up the address of a symbol of the compiled program.
+   * \param name the name of the symbol, e.g., "_tip_main"
+   * \return the address, or nothing if there is no such symbol
+   */
+  void *lookup(const std::string &name);
+
+  /*! \brief Run a program.
+   *
+   * Compiles the module and runs its main function, like an executable
+   * linked with the runtime library would.
+   * \param m the LLVM module holding the generated program
+   * \param args the arguments of the TIP main function
+   * \return the exit code of the program
+   */
+  static int run(llvm::Module *m, const std::vector<std::string> &args);
+
+private:
+  explicit JIT(std::unique_ptr<llvm::orc::LLJIT> jit);
+
+  std::unique_ptr<llvm::orc::LLJIT> jit;
+};
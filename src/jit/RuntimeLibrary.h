@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/*
+ * The runtime library functions called by generated code, see
+ * rtlib/tip_rtlib.c.  tipc links in a copy of them for the programs it runs.
+ */
+extern "C" {
+int64_t _tip_input();
+void _tip_output(int64_t x);
+void _tip_error(int64_t x);
+void _tip_main_undefined();
+void _tip_flush();
+void *_tip_alloc(int64_t size);
+void _tip_free(void *object, int64_t size);
+void _tip_fill(int64_t *elements, int64_t count, int64_t value);
+int64_t _tip_alloc_bytes();
+int64_t _tip_alloc_objects();
+int64_t _tip_gc_count();
+void _tip_gc_disable();
+}
+
+namespace rtlib {
+
+/*
+ * Runs main on the program arguments as the main function of the runtime
+ * library does: it checks that there is one argument for each of the expected
+ * parameters, converts them to integers, and outputs the result of main.
+ * Returns the exit status of the program.
+ */
+template <typename Main>
+int runMain(const std::vector<std::string> &args, int64_t expected,
+            Main main) {
+  if (static_cast<int64_t>(args.size()) != expected) {
+    printf("expected %" PRId64 " integer arguments\n", expected);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<int64_t> inputs;
+  for (auto &arg : args) {
+    inputs.push_back(strtoll(arg.c_str(), nullptr, 10));
+  }
+
+  _tip_output(main(inputs));
+  _tip_flush();
+  return EXIT_SUCCESS;
+}
+
+// Arithmetic wraps around like it does in the generated code
+inline int64_t wrap(uint64_t x) { return static_cast<int64_t>(x); }
+
+} // namespace rtlib
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <optional>
 #include "Optimizer.h"
 
 #include "llvm/Passes/PassBuilder.h"
@@ -19,6 +20,14 @@
 #include "llvm/Transforms/IPO/ModuleInliner.h"
 #include "llvm/Transforms/IPO/GlobalDCE.h"
 #include "llvm/Transforms/IPO/ConstantMerge.h"
+#include "llvm/Transforms/Vectorize/LoopVectorize.h"
+#include "llvm/Transforms/Vectorize/SLPVectorizer.h"
+
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/TargetParser/Host.h"
 
 
 #include "loguru.hpp"
@@ -30,14 +39,114 @@ namespace {
     }
     return false;
   }
+
+  llvm::OptimizationLevel llvmLevel(OptLevel level) {
+    switch (level) {
+    case O1:
+      return llvm::OptimizationLevel::O1;
+    case O2:
+      return llvm::OptimizationLevel::O2;
+    case O3:
+      return llvm::OptimizationLevel::O3;
+    case Os:
+      return llvm::OptimizationLevel::Os;
+    case Oz:
+      return llvm::OptimizationLevel::Oz;
+    default:
+      return llvm::OptimizationLevel::O0;
+    }
+  }
+
+  /*
+   * Targets the functions of the module at the host CPU and returns a
+   * machine for it, so that the vectorizers see the actual vector registers
+   * and costs.  Returns null if the host target is not available.
+   */
+  std::unique_ptr<llvm::TargetMachine> targetHost(llvm::Module *theModule) {
+    std::string cpu = llvm::sys::getHostCPUName().str();
+    std::string features;
+    llvm::StringMap<bool> hostFeatures;
+    if (llvm::sys::getHostCPUFeatures(hostFeatures)) {
+      for (auto &feature : hostFeatures) {
+        features += (features.empty() ? "" : ",");
+        features += (feature.second ? "+" : "-") + feature.first().str();
+      }
+    }
+
+    for (auto &function : *theModule) {
+      if (!function.isDeclaration()) {
+        function.addFnAttr("target-cpu", cpu);
+        function.addFnAttr("target-features", features);
+      }
+    }
+
+    llvm::InitializeNativeTarget();
+    std::string error;
+    std::string triple = theModule->getTargetTriple();
+    auto target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (target == nullptr) {
+      LOG_S(1) << "No target machine for " << triple << ": " << error;
+      return nullptr;
+    }
+    return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+        triple, cpu, features, llvm::TargetOptions(), std::nullopt));
+  }
+
+  // Prints the remarks of the vectorizers
+  class VectorizationRemarks : public llvm::DiagnosticHandler {
+  public:
+    bool isAnalysisRemarkEnabled(llvm::StringRef passName) const override {
+      return isVectorizer(passName);
+    }
+    bool isMissedOptRemarkEnabled(llvm::StringRef passName) const override {
+      return isVectorizer(passName);
+    }
+    bool isPassedOptRemarkEnabled(llvm::StringRef passName) const override {
+      return isVectorizer(passName);
+    }
+
+    bool handleDiagnostics(const llvm::DiagnosticInfo &info) override {
+      auto remark = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info);
+      if (remark == nullptr || !remark->isEnabled()) {
+        return false;
+      }
+      llvm::errs() << "tipc: remark: " << remark->getFunction().getName()
+                   << ": " << remark->getPassName() << ": "
+                   << remark->getMsg() << "\n";
+      return true;
+    }
+
+  private:
+    static bool isVectorizer(llvm::StringRef passName) {
+      return passName == "loop-vectorize" || passName == "slp-vectorizer";
+    }
+  };
 }
 
 //  Minimal optimization pass using LLVM pass managers
-void Optimizer::optimize(llvm::Module *theModule, llvm::cl::list<Optimization> &enabledOpts) {
+void Optimizer::optimize(llvm::Module *theModule,
+                         llvm::cl::list<Optimization> &enabledOpts,
+                         OptLevel level, bool printRemarks) {
   LOG_S(1) << "Optimizing program " << theModule->getName().str();
 
+  // The higher optimization levels include vectorization
+  bool vectorize = contains(vectorization, enabledOpts) || level == O2 ||
+                   level == O3;
+  std::unique_ptr<llvm::TargetMachine> targetMachine;
+  llvm::PipelineTuningOptions tuningOptions;
+  if (vectorize) {
+    targetMachine = targetHost(theModule);
+    tuningOptions.LoopVectorization = true;
+    tuningOptions.SLPVectorization = true;
+  }
+
+  if (printRemarks) {
+    theModule->getContext().setDiagnosticHandler(
+        std::make_unique<VectorizationRemarks>());
+  }
+
   // New pass builder
-  llvm::PassBuilder passBuilder;
+  llvm::PassBuilder passBuilder(targetMachine.get(), tuningOptions);
 
   // Setting-up Analysis Managers for different granularities of optimizations
   llvm::FunctionAnalysisManager functionAnalysisManager;
@@ -63,23 +172,33 @@ void Optimizer::optimize(llvm::Module *theModule, llvm::cl::list<Optimization> &
 
   // Adding passes to the pipeline
 
-  // Constructs SSA and is a pre-requisite for many other passes
-  functionPassManager.addPass(llvm::PromotePass());
+  if (level == Obasic) {
+    // Constructs SSA and is a pre-requisite for many other passes
+    functionPassManager.addPass(llvm::PromotePass());
 
-  // Instruction combine pass scans for a variety of patterns and replaces bitcodes matched with improvements.
-  functionPassManager.addPass(llvm::InstCombinePass());
+    // Instruction combine pass scans for a variety of patterns and replaces bitcodes matched with improvements.
+    functionPassManager.addPass(llvm::InstCombinePass());
 
-  // Reassociate expressions.
-  functionPassManager.addPass(llvm::ReassociatePass());
+    // Reassociate expressions.
+    functionPassManager.addPass(llvm::ReassociatePass());
 
-  // Eliminate Common SubExpressions using the Global Value Numbering (GVN) algorithm.
-  functionPassManager.addPass(llvm::GVNPass());
+    // Eliminate Common SubExpressions using the Global Value Numbering (GVN) algorithm.
+    functionPassManager.addPass(llvm::GVNPass());
 
-  // Simplify the control flow graph (deleting unreachable blocks, etc).
-  functionPassManager.addPass(llvm::SimplifyCFGPass());
+    // Simplify the control flow graph (deleting unreachable blocks, etc).
+    functionPassManager.addPass(llvm::SimplifyCFGPass());
+  } else if (level == O0) {
+    modulePassManager =
+        passBuilder.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+  } else {
+    // The enabled optimizations run after the default pipeline
+    modulePassManager =
+        passBuilder.buildPerModuleDefaultPipeline(llvmLevel(level));
+  }
 
-  // Rotate loops for better locality
-  if(contains(looprotate, enabledOpts)) {
+  // Rotate loops for better locality, the loop vectorizer needs them rotated
+  bool vectorizeHere = vectorize && (level == Obasic || level == O0);
+  if(contains(looprotate, enabledOpts) || vectorizeHere) {
     loopPassManager.addPass(llvm::LoopRotatePass());
   }
   
@@ -95,6 +214,14 @@ void Optimizer::optimize(llvm::Module *theModule, llvm::cl::list<Optimization> &
   functionPassManager.addPass(
     createFunctionToLoopPassAdaptor(std::move(loopPassManager), true));
 
+  // Vectorize loops and straight-line code, unless the pipeline of the
+  // optimization level already does.
+  if (vectorizeHere) {
+    functionPassManager.addPass(llvm::LoopVectorizePass());
+    functionPassManager.addPass(llvm::SLPVectorizerPass());
+    functionPassManager.addPass(llvm::InstCombinePass());
+  }
+
 
   // Passing the function pass manager to the modulePassManager using a function
   // adaptor, then passing theModule to the ModulePassManager along with
@@ -4,7 +4,16 @@
 #include "llvm/Support/CommandLine.h"
 
 enum Optimization {
-licm, unroll, ivs, inliner, gdce, constmerge, looprotate
+licm, unroll, ivs, inliner, gdce, constmerge, looprotate, vectorization
+};
+
+/*! \brief Optimization levels.
+ *
+ * Obasic is the basic pipeline used when no level is given.  The others run
+ * the corresponding default pipeline of LLVM.
+ */
+enum OptLevel {
+Obasic, O0, O1, O2, O3, Os, Oz
 };
 
 /*! \class Optimizer
@@ -14,9 +23,14 @@ class Optimizer {
 public:
   /*! \brief optimize LLVM module.
    *
-   * Apply a series of basic optimization passes to the given LLVM module.
+   * Apply the pipeline of the given optimization level to the given LLVM
+   * module, followed by the enabled optimizations.
    * \param theModule an LLVM module to be optimized
    * \param enabledOpts the list of enabled optimizations
+   * \param level the optimization level
+   * \param printRemarks whether to print the remarks of the vectorizers
    */
-  static void optimize(llvm::Module *theModule, llvm::cl::list<Optimization> &enabledOpts);
+  static void optimize(llvm::Module *theModule,
+                       llvm::cl::list<Optimization> &enabledOpts,
+                       OptLevel level = Obasic, bool printRemarks = false);
 };
@@ -2,12 +2,13 @@
 #include "CheckAssignable.h"
 
 std::shared_ptr<SemanticAnalysis> SemanticAnalysis::analyze(ASTProgram *ast,
-                                                            bool polyInf) {
+                                                            bool polyInf,
+                                                            int jobs) {
   auto symTable = SymbolTable::build(ast);
   CheckAssignable::check(ast);
   auto callGraph = CallGraph::build(ast, symTable.get());
-  auto typeResults =
-      TypeInference::run(ast, polyInf, callGraph.get(), symTable.get());
+  auto typeResults = TypeInference::run(ast, polyInf, callGraph.get(),
+                                        symTable.get(), jobs);
   return std::make_shared<SemanticAnalysis>(symTable, typeResults, callGraph);
 }
 
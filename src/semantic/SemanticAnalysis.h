@@ -35,10 +35,11 @@ public:
    * semantic analysis results are transferred to caller. \sa SemanticError
    * \param ast The program AST
    * \param polyInf Indicate whether polymorphic type inference should be
-   * performed. \return The unique pointer to the semantic analysis structure.
+   * performed. \param jobs The number of threads used by polymorphic type
+   * inference. \return The unique pointer to the semantic analysis structure.
    */
   static std::shared_ptr<SemanticAnalysis> analyze(ASTProgram *ast,
-                                                   bool polyInf);
+                                                   bool polyInf, int jobs = 1);
 
   /*! \fn getSymbolTable
    *  \brief Returns the symbol table computed for the program.
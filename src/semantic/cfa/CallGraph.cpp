@@ -33,7 +33,12 @@ std::vector<std::pair<ASTFunction *, ASTFunction *>> CallGraph::getEdges() {
 } // LCOV_EXCL_LINE
 
 std::set<ASTFunction *> CallGraph::getCalledFuns(ASTFunAppExpr *e) {
-  return mayCall[e];
+  // Lookups must not insert, the call graph is shared by parallel inference
+  auto it = mayCall.find(e);
+  if (it == mayCall.end()) {
+    return std::set<ASTFunction *>();
+  }
+  return it->second;
 }
 
 std::set<ASTFunction *> CallGraph::getCallees(ASTFunction *f) {
@@ -75,6 +80,84 @@ std::set<ASTFunction *> CallGraph::getCallers(ASTFunction *f) {
   return callers;
 }
 
+/*
+ * Iterative version of Tarjan's algorithm, so that long call chains do not
+ * exhaust the stack.  Each frame records the callees of a function that are
+ * still to be visited.
+ */
+std::vector<std::vector<ASTFunction *>> CallGraph::getSCCs() {
+  std::vector<std::vector<ASTFunction *>> sccs;
+  std::map<ASTFunction *, int> index;
+  std::map<ASTFunction *, int> low;
+  std::set<ASTFunction *> onStack;
+  std::vector<ASTFunction *> stack;
+
+  struct Frame {
+    ASTFunction *f;
+    std::set<ASTFunction *>::iterator next;
+    std::set<ASTFunction *>::iterator end;
+  };
+  std::vector<Frame> frames;
+  std::set<ASTFunction *> noCallees;
+
+  auto push = [&](ASTFunction *f) {
+    int i = index.size();
+    index[f] = i;
+    low[f] = i;
+    stack.push_back(f);
+    onStack.insert(f);
+    auto callees = callGraph.find(f);
+    if (callees == callGraph.end()) {
+      frames.push_back(Frame{f, noCallees.begin(), noCallees.end()});
+    } else {
+      frames.push_back(
+          Frame{f, callees->second.begin(), callees->second.end()});
+    }
+  };
+
+  for (auto root = vertices.rbegin(); root != vertices.rend(); root++) {
+    if (index.find(*root) != index.end()) {
+      continue;
+    }
+
+    push(*root);
+    while (!frames.empty()) {
+      auto &frame = frames.back();
+      if (frame.next != frame.end) {
+        auto f = frame.f;
+        auto c = *frame.next++;
+        if (index.find(c) == index.end()) {
+          push(c);
+        } else if (onStack.count(c)) {
+          low[f] = std::min(low[f], index[c]);
+        }
+        continue;
+      }
+
+      auto f = frame.f;
+      frames.pop_back();
+      if (!frames.empty()) {
+        auto caller = frames.back().f;
+        low[caller] = std::min(low[caller], low[f]);
+      }
+
+      if (low[f] == index[f]) {
+        std::vector<ASTFunction *> scc;
+        ASTFunction *member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          onStack.erase(member);
+          scc.push_back(member);
+        } while (member != f);
+        sccs.push_back(scc);
+      }
+    }
+  }
+
+  return sccs;
+}
+
 void CallGraph::print(std::ostream &str) {
   str << "digraph CFG{\n";
   std::map<ASTFunction *, int> inds;
@@ -78,6 +78,15 @@ public:
   std::set<ASTFunction *> getCallers(ASTFunction *f);
   std::set<std::string> getCallers(std::string callee);
 
+  /*! \brief Returns the strongly connected components of the call graph.
+   *
+   * Components are computed with Tarjan's algorithm in a single pass over the
+   * graph.  They are listed in reverse topological order of the condensation,
+   * i.e., each component comes after all of the components it calls into.
+   * \return The components, each a list of its function nodes
+   */
+  std::vector<std::vector<ASTFunction *>> getSCCs();
+
   //! Print call graph contents to output stream
   void print(std::ostream &os);
 
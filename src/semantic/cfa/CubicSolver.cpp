@@ -1,36 +1,55 @@
 #include "CubicSolver.h"
 #include "loguru.hpp"
-#include <map>
-#include <queue>
+#include <algorithm>
+#include <unordered_set>
 
-CubicSolverNode::CubicSolverNode(int count) {
-  bitvector.resize(count);
-  conditionalConstraints.resize(count);
-  for (int i = 0; i < count; i++) {
-    bitvector[i] = false;
-  }
-  size = count;
-}
+CubicSolverNode::CubicSolverNode(int count)
+    : parent(-1), bits((count + 63) / 64, 0), delta((count + 63) / 64, 0) {}
 
 CubicSolver::CubicSolver(std::vector<ASTFunction *> functions) {
   for (int i = 0; i < functions.size(); i++) {
     fmapping[functions[i]] = i;
   }
+  words = (functions.size() + 63) / 64;
 }
 
-void CubicSolver::addEmptyVariableIfNecessary(ASTNode *node) {
-  if (dagmapping.find(node) != dagmapping.end()) {
-    return;
+int CubicSolver::getVariable(ASTNode *node) {
+  auto it = variables.find(node);
+  if (it != variables.end()) {
+    return it->second;
+  }
+  int n = nodes.size();
+  nodes.emplace_back(fmapping.size());
+  nodes.back().parent = n;
+  variables[node] = n;
+  return n;
+}
+
+/*! \fn find
+ *  \brief Returns the node a variable has been collapsed into.
+ */
+int CubicSolver::find(int n) {
+  int root = n;
+  while (nodes[root].parent != root) {
+    root = nodes[root].parent;
+  }
+  while (nodes[n].parent != root) {
+    int next = nodes[n].parent;
+    nodes[n].parent = root;
+    n = next;
   }
-  dagmapping[node] = std::make_shared<CubicSolverNode>(fmapping.size());
+  return root;
+}
+
+bool CubicSolver::contains(int n, int token) {
+  return (nodes[n].bits[token / 64] >> (token % 64)) & 1;
 }
 
 void CubicSolver::addElementofConstraint(ASTFunction *fn, ASTNode *node) {
   LOG_S(1) << "Generating control flow constraint: " << fn->getName()
            << " \u2208 \u27e6" << *node << "\u27e7";
-  addEmptyVariableIfNecessary(node);
-  dagmapping[node]->bitvector[fmapping[fn]] = true;
-  propagateNodeChanges(dagmapping[node]);
+  addToken(getVariable(node), fmapping[fn]);
+  propagate();
 }
 
 void CubicSolver::addConditionalConstraint(ASTFunction *condition, ASTNode *in,
@@ -38,189 +57,258 @@ void CubicSolver::addConditionalConstraint(ASTFunction *condition, ASTNode *in,
   LOG_S(1) << "Generating control flow constraint: " << condition->getName()
            << " \u2208 \u27e6" << *in << "\u27e7 \u21d2 \u27e6" << *from
            << "\u27e7 \u2286 \u27e6" << *to << "\u27e7";
-  addEmptyVariableIfNecessary(in);
-  addEmptyVariableIfNecessary(from);
-  addEmptyVariableIfNecessary(to);
-  dagmapping[in]->conditionalConstraints[fmapping[condition]].push_back(
-      std::pair(from, to));
-  propagateNodeChanges(dagmapping[in]);
+  int n = find(getVariable(in));
+  int f = getVariable(from);
+  int t = getVariable(to);
+  int token = fmapping[condition];
+  if (contains(n, token)) {
+    addEdge(f, t);
+  } else {
+    nodes[n].conditionalConstraints[token].push_back(std::pair(from, to));
+  }
+  propagate();
 }
 
 void CubicSolver::addSubseteqConstraint(ASTNode *from, ASTNode *to) {
   LOG_S(1) << "Generating control flow constraint: "
            << "\u27e6" << *from << "\u27e7 \u2286 \u27e6" << *to << "\u27e7";
-  addEmptyVariableIfNecessary(from);
-  addEmptyVariableIfNecessary(to);
-  if (dagmapping[from] == dagmapping[to]) {
+  addEdge(getVariable(from), getVariable(to));
+  propagate();
+}
+
+void CubicSolver::addToken(int n, int token) {
+  n = find(n);
+  if (contains(n, token)) {
     return;
   }
-  dagmapping[from]->supsets.insert(dagmapping[to]);
-  dagmapping[to]->subsets.insert(dagmapping[from]);
-  killCyclesAt(dagmapping[from]);
-  propagateNodeChanges(dagmapping[from]);
+  uint64_t mask = uint64_t(1) << (token % 64);
+  nodes[n].bits[token / 64] |= mask;
+  nodes[n].delta[token / 64] |= mask;
+  worklist.push_back(n);
 }
 
-void CubicSolver::propagateNodeChanges(std::shared_ptr<CubicSolverNode> node) {
-  for (int i = 0; i < node->size; i++) {
-    if (node->bitvector[i]) {
-      auto constraints = node->conditionalConstraints[i];
-      node->conditionalConstraints[i].clear();
-      for (auto pair : constraints) {
-        activateConditionalConstraint(pair.first, pair.second);
-      }
-    }
+/*! \fn addEdge
+ *  \brief Adds the subset edge from -> to.
+ *
+ * A new edge pushes all of the tokens of from, not just its delta, to the
+ * target.  When that makes no difference the edge is a candidate for cycle
+ * detection.
+ */
+void CubicSolver::addEdge(int from, int to) {
+  from = find(from);
+  to = find(to);
+  if (from == to || !nodes[from].supsets.insert(to).second) {
+    return;
   }
-  for (std::shared_ptr<CubicSolverNode> sups : node->supsets) {
-    for (int i = 0; i < node->size; i++) {
-      sups->bitvector[i] = sups->bitvector[i] || node->bitvector[i];
+
+  bool changed = false;
+  for (int w = 0; w < words; w++) {
+    uint64_t added = nodes[from].bits[w] & ~nodes[to].bits[w];
+    if (added != 0) {
+      nodes[to].bits[w] |= added;
+      nodes[to].delta[w] |= added;
+      changed = true;
     }
-    assert(sups != node);
-    propagateNodeChanges(sups);
   }
-}
 
-void CubicSolver::activateConditionalConstraint(ASTNode *from, ASTNode *to) {
-  if (dagmapping[from] == dagmapping[to]) {
-    return;
+  if (changed) {
+    worklist.push_back(to);
+  } else if (nodes[from].bits == nodes[to].bits &&
+             checkedEdges.insert(std::pair(from, to)).second) {
+    cycleCandidates.push_back(from);
   }
-  dagmapping[from]->supsets.insert(dagmapping[to]);
-  dagmapping[to]->subsets.insert(dagmapping[from]);
-  killCyclesAt(dagmapping[from]);
-  propagateNodeChanges(dagmapping[from]);
 }
 
-std::shared_ptr<CubicSolverNode>
-CubicSolver::killCyclesAt(std::shared_ptr<CubicSolverNode> n) {
-  bool collapsed;
-  do {
-    collapsed = false;
-    for (std::shared_ptr<CubicSolverNode> t : n->supsets) {
-      auto path = findPath(t, n);
-      if (path.size() == 0) {
-        continue;
+/*! \fn propagate
+ *  \brief Processes the worklist until no node has unpropagated tokens.
+ *
+ * For every token a node gained its pending conditional constraints are
+ * activated and the gained tokens are pushed to its supersets.  Cycle
+ * detection runs once the worklist has drained.
+ */
+void CubicSolver::propagate() {
+  while (!worklist.empty() || !cycleCandidates.empty()) {
+    if (worklist.empty()) {
+      int n = find(cycleCandidates.back());
+      cycleCandidates.pop_back();
+      detectCycleAt(n);
+      continue;
+    }
+
+    int n = find(worklist.front());
+    worklist.pop_front();
+
+    std::vector<uint64_t> d(words, 0);
+    std::swap(d, nodes[n].delta);
+    if (std::all_of(d.begin(), d.end(), [](uint64_t w) { return w == 0; })) {
+      continue;
+    }
+
+    // Activate the conditional constraints of the tokens that were added
+    for (int w = 0; w < words; w++) {
+      for (uint64_t word = d[w]; word != 0; word &= word - 1) {
+        int token = w * 64 + __builtin_ctzll(word);
+        auto it = nodes[n].conditionalConstraints.find(token);
+        if (it == nodes[n].conditionalConstraints.end()) {
+          continue;
+        }
+        auto constraints = std::move(it->second);
+        nodes[n].conditionalConstraints.erase(it);
+        for (auto &pair : constraints) {
+          addEdge(getVariable(pair.first), getVariable(pair.second));
+        }
       }
-      n = mergePath(path);
-      collapsed = true;
-      break;
     }
-  } while (collapsed);
-  return n;
-} // LCOV_EXCL_LINE
-
-std::shared_ptr<CubicSolverNode>
-CubicSolver::mergePath(std::vector<std::shared_ptr<CubicSolverNode>> &path) {
-  assert(path.size() != 0);
-  while (true) {
-    if (path.size() == 1) {
-      return path[0];
+
+    // Push the added tokens to the supersets
+    for (int s : nodes[n].supsets) {
+      s = find(s);
+      if (s == n) {
+        continue;
+      }
+      bool changed = false;
+      for (int w = 0; w < words; w++) {
+        uint64_t added = d[w] & ~nodes[s].bits[w];
+        if (added != 0) {
+          nodes[s].bits[w] |= added;
+          nodes[s].delta[w] |= added;
+          changed = true;
+        }
+      }
+      if (changed) {
+        worklist.push_back(s);
+      } else if (nodes[n].bits == nodes[s].bits &&
+                 checkedEdges.insert(std::pair(n, s)).second) {
+        cycleCandidates.push_back(n);
+      }
     }
-    std::shared_ptr<CubicSolverNode> a = path.back();
-    path.pop_back();
-    std::shared_ptr<CubicSolverNode> b = path.back();
-    path.pop_back();
-    path.push_back(mergeNodes(a, b));
   }
 }
 
-std::shared_ptr<CubicSolverNode>
-CubicSolver::mergeNodes(std::shared_ptr<CubicSolverNode> n1,
-                        std::shared_ptr<CubicSolverNode> n2) {
-  for (auto &pair : dagmapping) {
-    if (pair.second == n2) {
-      pair.second = n1;
-    }
-  }
-  for (int i = 0; i < n1->size; i++) {
-    n1->bitvector[i] = n1->bitvector[i] || n2->bitvector[i];
-    for (auto a : n2->conditionalConstraints[i]) {
-      n1->conditionalConstraints[i].push_back(a);
+/*! \fn detectCycleAt
+ *  \brief Collapses the cycles of subset edges reachable from n.
+ *
+ * Uses an iterative version of Tarjan's algorithm so that long chains of
+ * subset constraints do not exhaust the stack.
+ */
+void CubicSolver::detectCycleAt(int n) {
+  std::unordered_map<int, int> index;
+  std::unordered_map<int, int> low;
+  std::unordered_set<int> onStack;
+  std::vector<int> stack;
+  std::vector<std::vector<int>> cycles;
+
+  struct Frame {
+    int node;
+    std::vector<int> succs;
+    std::size_t next;
+  };
+  std::vector<Frame> frames;
+
+  auto push = [&](int v) {
+    int i = index.size();
+    index[v] = i;
+    low[v] = i;
+    stack.push_back(v);
+    onStack.insert(v);
+    std::vector<int> succs;
+    for (int s : nodes[v].supsets) {
+      s = find(s);
+      if (s != v) {
+        succs.push_back(s);
+      }
     }
-  }
-  for (auto a : n2->supsets) {
-    if (n1 == a) {
+    frames.push_back(Frame{v, std::move(succs), 0});
+  };
+
+  push(n);
+  while (!frames.empty()) {
+    Frame &frame = frames.back();
+    if (frame.next < frame.succs.size()) {
+      int v = frame.node;
+      int w = frame.succs[frame.next++];
+      if (index.find(w) == index.end()) {
+        push(w);
+      } else if (onStack.count(w)) {
+        low[v] = std::min(low[v], index[w]);
+      }
       continue;
     }
-    a->subsets.erase(a->subsets.find(n2));
-    a->subsets.insert(n1);
-    n1->supsets.insert(a);
-  }
-  for (auto a : n2->subsets) {
-    if (n1 == a) {
-      continue;
+
+    int v = frame.node;
+    frames.pop_back();
+    if (!frames.empty()) {
+      int u = frames.back().node;
+      low[u] = std::min(low[u], low[v]);
     }
-    a->supsets.erase(a->supsets.find(n2));
-    a->supsets.insert(n1);
-    n1->subsets.insert(a);
-  }
-  if (n1->supsets.find(n2) != n1->supsets.end()) {
-    n1->supsets.erase(n1->supsets.find(n2));
-  }
-  if (n1->subsets.find(n2) != n1->subsets.end()) {
-    n1->subsets.erase(n1->subsets.find(n2));
-  }
-  return n1;
-}
 
-std::vector<std::shared_ptr<CubicSolverNode>>
-CubicSolver::findPath(std::shared_ptr<CubicSolverNode> source,
-                      std::shared_ptr<CubicSolverNode> target) {
-  std::map<std::shared_ptr<CubicSolverNode>, int> distances;
-  distances[source] = 0;
-  std::queue<std::shared_ptr<CubicSolverNode>> q;
-
-  auto populateDistances = [&](std::shared_ptr<CubicSolverNode> node) {
-    assert(node != NULL);
-    for (std::shared_ptr<CubicSolverNode> n : node->supsets) {
-      if (distances.find(n) != distances.end()) {
-        continue;
+    if (low[v] == index[v]) {
+      std::vector<int> scc;
+      int w;
+      do {
+        w = stack.back();
+        stack.pop_back();
+        onStack.erase(w);
+        scc.push_back(w);
+      } while (w != v);
+      if (scc.size() > 1) {
+        cycles.push_back(std::move(scc));
       }
-      distances[n] = distances[node] + 1;
-      q.push(n);
     }
-  };
-
-  populateDistances(source);
+  }
 
-  while (!q.empty()) {
-    std::shared_ptr<CubicSolverNode> curr = q.front();
-    populateDistances(curr);
-    q.pop();
-    if (distances.find(target) != distances.end()) {
-      break;
+  for (auto &cycle : cycles) {
+    LOG_S(2) << "Collapsing cycle of " << cycle.size()
+             << " control flow variables";
+    for (std::size_t i = 1; i < cycle.size(); i++) {
+      mergeNodes(cycle[0], cycle[i]);
     }
   }
+}
 
-  std::vector<std::shared_ptr<CubicSolverNode>> out;
+/*! \fn mergeNodes
+ *  \brief Collapses node n2 into node n1.
+ *
+ * The merged node is queued with all of its tokens as delta so that both
+ * sets of supersets and pending conditional constraints see the union.
+ */
+void CubicSolver::mergeNodes(int n1, int n2) {
+  nodes[n2].parent = n1;
 
-  if (distances.find(target) == distances.end()) {
-    return out;
-  } else {
-    std::shared_ptr<CubicSolverNode> curr = target;
-    out.push_back(target);
-    while (curr != source) {
-      for (std::shared_ptr<CubicSolverNode> n : curr->subsets) {
-        if (distances.find(n) == distances.end()) {
-          continue;
-        }
-        if (distances[n] == distances[curr] - 1) {
-          curr = n;
-        }
-        break;
-      }
-      out.push_back(curr);
-    }
-    return out;
+  for (int w = 0; w < words; w++) {
+    nodes[n1].bits[w] |= nodes[n2].bits[w];
   }
+  nodes[n1].delta = nodes[n1].bits;
+
+  for (auto &pair : nodes[n2].conditionalConstraints) {
+    auto &constraints = nodes[n1].conditionalConstraints[pair.first];
+    constraints.insert(constraints.end(), pair.second.begin(),
+                       pair.second.end());
+  }
+
+  nodes[n1].supsets.insert(nodes[n2].supsets.begin(), nodes[n2].supsets.end());
+  nodes[n1].supsets.erase(n1);
+  nodes[n1].supsets.erase(n2);
+
+  // The collapsed node only forwards to n1 from now on
+  nodes[n2].supsets.clear();
+  nodes[n2].conditionalConstraints.clear();
+  std::vector<uint64_t>().swap(nodes[n2].bits);
+  std::vector<uint64_t>().swap(nodes[n2].delta);
+
+  worklist.push_back(n1);
 }
 
 std::vector<ASTFunction *>
 CubicSolver::getPossibleFunctionsForExpr(ASTNode *n) {
   std::vector<ASTFunction *> out;
-  if (dagmapping.find(n) == dagmapping.end()) {
+  auto it = variables.find(n);
+  if (it == variables.end()) {
     return out;
   }
+  int node = find(it->second);
   for (auto pair : fmapping) {
-    if (dagmapping[n]->bitvector[pair.second]) {
+    if (contains(node, pair.second)) {
       out.push_back(pair.first);
     }
   }
@@ -1,26 +1,47 @@
 #include "ASTFunction.h"
 #include "ASTNode.h"
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 class CubicSolver;
 
+/*! \class CubicSolverNode
+ * \brief A set variable of the cubic solver.
+ *
+ * The tokens (functions) in the set are packed into 64-bit words.  Tokens
+ * that were added since the node was last processed are additionally
+ * recorded in the delta, so that only those are pushed along the subset
+ * edges.  A node that has been collapsed into another one as part of a cycle
+ * forwards to it through its parent.
+ */
 class CubicSolverNode {
 public:
   CubicSolverNode(int count);
 
 private:
   friend CubicSolver;
-  std::set<std::shared_ptr<CubicSolverNode>> supsets;
-  std::set<std::shared_ptr<CubicSolverNode>> subsets;
-  std::vector<bool> bitvector;
-  int size;
-  std::vector<std::vector<std::pair<ASTNode *, ASTNode *>>>
+  int parent;
+  std::set<int> supsets;
+  std::vector<uint64_t> bits;
+  std::vector<uint64_t> delta;
+  std::unordered_map<int, std::vector<std::pair<ASTNode *, ASTNode *>>>
       conditionalConstraints;
 };
 
+/*! \class CubicSolver
+ * \brief Worklist solver for the cubic control-flow constraints.
+ *
+ * Constraints are solved as they are added.  Changes are propagated with a
+ * worklist, only pushing the tokens a node gained along its edges, and cycles
+ * of subset constraints are collapsed into single nodes when they are
+ * detected.  Cycle detection is lazy: it is triggered when propagating along
+ * an edge makes no difference because both ends already hold the same tokens.
+ */
 class CubicSolver {
 public:
   CubicSolver(std::vector<ASTFunction *> functions);
@@ -31,19 +52,19 @@ public:
   std::vector<ASTFunction *> getPossibleFunctionsForExpr(ASTNode *);
 
 private:
-  void activateConditionalConstraint(ASTNode *from, ASTNode *to);
-  void addEmptyVariableIfNecessary(ASTNode *node);
-  std::shared_ptr<CubicSolverNode>
-  killCyclesAt(std::shared_ptr<CubicSolverNode> n);
-  std::vector<std::shared_ptr<CubicSolverNode>>
-  findPath(std::shared_ptr<CubicSolverNode> source,
-           std::shared_ptr<CubicSolverNode> target);
-  std::shared_ptr<CubicSolverNode>
-  mergePath(std::vector<std::shared_ptr<CubicSolverNode>> &path);
-  std::shared_ptr<CubicSolverNode>
-  mergeNodes(std::shared_ptr<CubicSolverNode> n1,
-             std::shared_ptr<CubicSolverNode> n2);
-  void propagateNodeChanges(std::shared_ptr<CubicSolverNode> node);
+  int getVariable(ASTNode *node);
+  int find(int n);
+  bool contains(int n, int token);
+  void addToken(int n, int token);
+  void addEdge(int from, int to);
+  void propagate();
+  void detectCycleAt(int n);
+  void mergeNodes(int n1, int n2);
   std::map<ASTFunction *, int> fmapping;
-  std::map<ASTNode *, std::shared_ptr<CubicSolverNode>> dagmapping;
+  std::unordered_map<ASTNode *, int> variables;
+  std::vector<CubicSolverNode> nodes;
+  std::deque<int> worklist;
+  std::vector<int> cycleCandidates;
+  std::set<std::pair<int, int>> checkedEdges;
+  int words;
 };
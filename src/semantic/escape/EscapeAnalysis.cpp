@@ -0,0 +1,373 @@
+#include "EscapeAnalysis.h"
+#include "ASTVisitor.h"
+#include "loguru.hpp"
+
+#include <algorithm>
+
+namespace {
+
+/*
+ * The values of a function are the allocation sites of the function and the
+ * declarations of its parameters, which stand for the values of the callers.
+ */
+using Values = std::set<ASTNode *>;
+
+// What the analysis needs to know about the statements of a function
+struct FunctionFacts {
+  std::vector<ASTExpr *> sites;
+  std::set<ASTExpr *> repeated;
+  std::map<ASTNode *, ASTExpr *> contents;
+  std::vector<std::pair<std::string, ASTExpr *>> assignments;
+  std::vector<ASTExpr *> escaping;
+  std::vector<ASTFunAppExpr *> calls;
+  std::set<std::string> addressTaken;
+  std::vector<ASTExpr *> writtenArrays;
+};
+
+// Collects the facts about the statements of a function
+class FactCollector : public ASTVisitor {
+public:
+  FunctionFacts facts;
+
+  bool visit(ASTWhileStmt *element) override {
+    loops++;
+    return true;
+  }
+  void endVisit(ASTWhileStmt *element) override { loops--; }
+
+  bool visit(ASTForStmt *element) override {
+    loops++;
+    return true;
+  }
+
+  // The loop assigns its item on each iteration
+  void endVisit(ASTForStmt *element) override {
+    loops--;
+    addWrite(element->getItem());
+  }
+
+  // The element is evaluated once for each element of the array
+  bool visit(ASTArrayOfExpr *element) override {
+    addSite(element);
+    element->getE1()->accept(this);
+    loops++;
+    element->getE2()->accept(this);
+    loops--;
+    facts.escaping.push_back(element->getE2().get());
+    return false;
+  }
+
+  void endVisit(ASTArrayExpr *element) override {
+    addSite(element);
+    for (auto &e : element->getElements()) {
+      facts.escaping.push_back(e.get());
+    }
+  }
+
+  void endVisit(ASTRecordExpr *element) override {
+    for (auto field : element->getFields()) {
+      facts.escaping.push_back(field->getInitializer());
+    }
+  }
+
+  void endVisit(ASTAllocExpr *element) override {
+    addSite(element);
+    facts.contents[element] = element->getInitializer();
+    if (auto record = dynamic_cast<ASTRecordExpr *>(element->getInitializer())) {
+      addSite(record);
+    }
+  }
+
+  void endVisit(ASTAssignStmt *element) override {
+    if (auto var = dynamic_cast<ASTVariableExpr *>(element->getLHS())) {
+      facts.assignments.emplace_back(var->getName(), element->getRHS());
+    } else {
+      facts.escaping.push_back(element->getRHS());
+    }
+    addWrite(element->getLHS());
+  }
+
+  void endVisit(ASTUpdateStmt *element) override {
+    addWrite(element->getArg());
+  }
+
+  void endVisit(ASTReturnStmt *element) override {
+    facts.escaping.push_back(element->getArg());
+  }
+
+  void endVisit(ASTFunAppExpr *element) override {
+    facts.calls.push_back(element);
+  }
+
+  void endVisit(ASTRefExpr *element) override {
+    if (auto var = dynamic_cast<ASTVariableExpr *>(element->getVar())) {
+      facts.addressTaken.insert(var->getName());
+    }
+    addWrite(element->getVar());
+  }
+
+private:
+  int loops = 0;
+
+  // Elements are written by assignments, updates, loops and their addresses
+  void addWrite(ASTExpr *e) {
+    if (auto indexing = dynamic_cast<ASTIndexingExpr *>(e)) {
+      facts.writtenArrays.push_back(indexing->getArr());
+    }
+  }
+
+  void addSite(ASTExpr *site) {
+    facts.sites.push_back(site);
+    if (loops > 0) {
+      facts.repeated.insert(site);
+    }
+  }
+};
+
+} // namespace
+
+/*
+ * Computes the values that escape each function, starting from no escaping
+ * parameters and adding them until the parameters that escape agree with
+ * the values passed to them.
+ */
+class EscapeSolver {
+public:
+  EscapeSolver(EscapeAnalysis *results, CallGraph *callGraph)
+      : results(results), callGraph(callGraph) {}
+
+  void solve(ASTProgram *program) {
+    auto functions = program->getFunctions();
+    for (auto f : functions) {
+      FactCollector collector;
+      f->accept(&collector);
+      facts[f] = collector.facts;
+      results->escapingParameters[f] =
+          std::vector<bool>(f->getFormals().size(), false);
+    }
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (auto f : functions) {
+        auto escaped = escaping(f);
+        auto formals = f->getFormals();
+        for (std::size_t i = 0; i < formals.size(); i++) {
+          if (escaped.count(formals[i]) != 0 &&
+              !results->escapingParameters[f][i]) {
+            results->escapingParameters[f][i] = true;
+            changed = true;
+          }
+        }
+      }
+    }
+
+    for (auto f : functions) {
+      auto escaped = escaping(f);
+      auto &fn = facts[f];
+
+      Values written;
+      for (auto e : fn.writtenArrays) {
+        auto arrays = values(e, fn);
+        written.insert(arrays.begin(), arrays.end());
+      }
+      for (auto call : fn.calls) {
+        for (auto actual : call->getActuals()) {
+          auto passed = values(actual, fn);
+          written.insert(passed.begin(), passed.end());
+        }
+      }
+
+      for (auto site : fn.sites) {
+        results->total++;
+        if (escaped.count(site) != 0) {
+          continue;
+        }
+        if (fn.repeated.count(site) == 0) {
+          results->stackAllocatable.insert(site);
+        }
+        if (dynamic_cast<ASTArrayExpr *>(site) && written.count(site) == 0) {
+          results->readOnly.insert(site);
+        }
+      }
+    }
+  }
+
+private:
+  EscapeAnalysis *results;
+  CallGraph *callGraph;
+  std::map<ASTFunction *, FunctionFacts> facts;
+
+  // The values each variable of the function being solved may hold
+  std::map<std::string, Values> variables;
+
+  // Returns the values the expression may evaluate to
+  Values values(ASTExpr *e, const FunctionFacts &fn) {
+    Values result;
+    if (auto ref = dynamic_cast<ASTRefExpr *>(e)) {
+      // The address of an element or a field keeps its array or record alive
+      if (auto indexing = dynamic_cast<ASTIndexingExpr *>(ref->getVar())) {
+        result = values(indexing->getArr(), fn);
+      } else if (auto access =
+                     dynamic_cast<ASTAccessExpr *>(ref->getVar())) {
+        result = values(access->getRecord(), fn);
+      }
+    } else if (auto var = dynamic_cast<ASTVariableExpr *>(e)) {
+      auto it = variables.find(var->getName());
+      if (it != variables.end()) {
+        result = it->second;
+      }
+    } else if (auto ternary = dynamic_cast<ASTTernaryExpr *>(e)) {
+      result = values(ternary->getThen(), fn);
+      auto other = values(ternary->getElse(), fn);
+      result.insert(other.begin(), other.end());
+    } else if (auto deref = dynamic_cast<ASTDeRefExpr *>(e)) {
+      for (auto cell : values(deref->getPtr(), fn)) {
+        auto contents = fn.contents.find(cell);
+        if (contents != fn.contents.end()) {
+          auto held = values(contents->second, fn);
+          result.insert(held.begin(), held.end());
+        }
+      }
+    } else if (dynamic_cast<ASTAllocExpr *>(e) ||
+               dynamic_cast<ASTArrayExpr *>(e) ||
+               dynamic_cast<ASTArrayOfExpr *>(e) ||
+               (dynamic_cast<ASTRecordExpr *>(e) &&
+                std::find(fn.sites.begin(), fn.sites.end(), e) !=
+                    fn.sites.end())) {
+      result.insert(e);
+    }
+    return result;
+  }
+
+  /*
+   * Returns the function a call always calls, which is when it names a
+   * function that no local shadows, or nullptr.  The call graph does not
+   * follow function values through memory, so the callees it finds for other
+   * calls may be incomplete.
+   */
+  ASTFunction *namedCallee(ASTFunction *f, ASTFunAppExpr *call) {
+    auto name = dynamic_cast<ASTVariableExpr *>(call->getFunction());
+    auto callees = callGraph->getCalledFuns(call);
+    if (name == nullptr || callees.size() != 1 ||
+        (*callees.begin())->getName() != name->getName()) {
+      return nullptr;
+    }
+
+    for (auto formal : f->getFormals()) {
+      if (formal->getName() == name->getName()) {
+        return nullptr;
+      }
+    }
+    for (auto declaration : f->getDeclarations()) {
+      for (auto local : declaration->getVars()) {
+        if (local->getName() == name->getName()) {
+          return nullptr;
+        }
+      }
+    }
+    return *callees.begin();
+  }
+
+  // Returns the values that escape the function
+  Values escaping(ASTFunction *f) {
+    auto &fn = facts[f];
+
+    variables.clear();
+    for (auto formal : f->getFormals()) {
+      variables[formal->getName()].insert(formal);
+    }
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (auto &assignment : fn.assignments) {
+        auto &held = variables[assignment.first];
+        auto size = held.size();
+        auto assigned = values(assignment.second, fn);
+        held.insert(assigned.begin(), assigned.end());
+        changed |= held.size() != size;
+      }
+    }
+
+    Values escaped;
+    std::vector<ASTNode *> worklist;
+    auto escape = [&](const Values &vs) {
+      for (auto v : vs) {
+        if (escaped.insert(v).second) {
+          worklist.push_back(v);
+        }
+      }
+    };
+
+    for (auto e : fn.escaping) {
+      escape(values(e, fn));
+    }
+    for (auto &name : fn.addressTaken) {
+      escape(variables[name]);
+    }
+
+    /*
+     * The callee may reach what an alloc'd cell holds by dereferencing it,
+     * which is not tracked across calls, so that escapes with any cell
+     * passed.  The arguments of calls that do not name their callee escape.
+     */
+    for (auto call : fn.calls) {
+      auto callee = namedCallee(f, call);
+      auto actuals = call->getActuals();
+      for (std::size_t i = 0; i < actuals.size(); i++) {
+        auto passed = values(actuals[i], fn);
+        for (auto cell : passed) {
+          auto contents = fn.contents.find(cell);
+          if (contents != fn.contents.end()) {
+            escape(values(contents->second, fn));
+          }
+        }
+
+        bool escapes = callee == nullptr;
+        if (callee != nullptr) {
+          auto &parameters = results->escapingParameters[callee];
+          escapes = parameters.size() != actuals.size() || parameters[i];
+        }
+        if (escapes) {
+          escape(passed);
+        }
+      }
+    }
+
+    // What an escaping cell holds escapes with it
+    while (!worklist.empty()) {
+      auto v = worklist.back();
+      worklist.pop_back();
+      auto contents = fn.contents.find(v);
+      if (contents != fn.contents.end()) {
+        escape(values(contents->second, fn));
+      }
+    }
+    return escaped;
+  }
+};
+
+std::shared_ptr<EscapeAnalysis>
+EscapeAnalysis::analyze(ASTProgram *program, CallGraph *callGraph) {
+  auto results = std::make_shared<EscapeAnalysis>();
+  EscapeSolver solver(results.get(), callGraph);
+  solver.solve(program);
+
+  LOG_S(1) << "Stack allocation: " << results->getStackAllocatable() << " of "
+           << results->getTotal() << " allocation sites";
+  return results;
+}
+
+bool EscapeAnalysis::isStackAllocatable(ASTExpr *site) const {
+  return stackAllocatable.count(site) != 0;
+}
+
+bool EscapeAnalysis::isReadOnly(ASTExpr *site) const {
+  return readOnly.count(site) != 0;
+}
+
+bool EscapeAnalysis::parameterEscapes(ASTFunction *f, std::size_t i) const {
+  auto it = escapingParameters.find(f);
+  return it == escapingParameters.end() || i >= it->second.size() ||
+         it->second[i];
+}
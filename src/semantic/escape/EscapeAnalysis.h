@@ -0,0 +1,71 @@
+#pragma once
+
+#include "AST.h"
+#include "ASTProgram.h"
+#include "CallGraph.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+/*! \class EscapeAnalysis
+ *  \brief Finds the allocation sites whose values never escape their function.
+ *
+ * The allocation sites are the alloc, array and array-of expressions and the
+ * records created by alloc.  The value of a site escapes when it may be
+ * returned, stored in memory, placed in an array or record, assigned to a
+ * variable whose address is taken, or passed to a function whose parameter
+ * escapes.  The address of an element or a field escapes with its array or
+ * record.  The parameters that escape are computed over the call graph, but
+ * the calls it finds through function values may miss callees, so a call
+ * that does not name its function lets its arguments escape.
+ *
+ * The analysis is insensitive to the order of statements.  A variable holds
+ * every site assigned to it, and dereferencing an alloc'd cell yields the
+ * site it was initialized with, which are the only sites that reach memory
+ * without escaping.
+ *
+ * A site whose value does not escape, and that is evaluated at most once per
+ * call because it is not within a loop, can be allocated in the frame of its
+ * function.  An array whose value does not escape and is neither written nor
+ * passed to a function is read-only.  A read-only array may be shared by
+ * every evaluation of its site, including those in loops, since only
+ * comparing references to it could tell its copies apart.
+ */
+class EscapeAnalysis {
+public:
+  /*! \brief Analyze the allocation sites of a program.
+   * \param program The program AST
+   * \param callGraph The call graph of the program
+   * \return The analysis results
+   */
+  static std::shared_ptr<EscapeAnalysis> analyze(ASTProgram *program,
+                                                 CallGraph *callGraph);
+
+  /*! \brief Returns whether the site can be allocated in the frame of its
+   * function.
+   */
+  bool isStackAllocatable(ASTExpr *site) const;
+
+  /*! \brief Returns whether the elements of the array are never written.
+   */
+  bool isReadOnly(ASTExpr *site) const;
+
+  /*! \brief Returns whether the value of a parameter may escape the function.
+   */
+  bool parameterEscapes(ASTFunction *f, std::size_t i) const;
+
+  //! The number of allocation sites in the program
+  int getTotal() const { return total; }
+
+  //! The number of allocation sites that can be allocated in the frame
+  int getStackAllocatable() const { return stackAllocatable.size(); }
+
+private:
+  friend class EscapeSolver;
+
+  int total = 0;
+  std::set<ASTExpr *> stackAllocatable;
+  std::set<ASTExpr *> readOnly;
+  std::map<ASTFunction *, std::vector<bool>> escapingParameters;
+};
@@ -0,0 +1,319 @@
+#include "RangeAnalysis.h"
+#include "ASTVisitor.h"
+#include "loguru.hpp"
+
+#include <algorithm>
+#include <optional>
+
+namespace {
+
+/*
+ * Bounds of the values of an expression.  The upper bound is relative to the
+ * length of the upper array if there is one.
+ */
+struct Bounds {
+  bool hasLower = false;
+  int64_t lower = 0;
+  bool hasUpper = false;
+  std::string upperArray;
+  int64_t upper = 0;
+};
+
+// Collects the names of the variables assigned in a subtree
+class AssignedNames : public ASTVisitor {
+public:
+  std::set<std::string> names;
+
+  void endVisit(ASTAssignStmt *element) override { add(element->getLHS()); }
+  void endVisit(ASTUpdateStmt *element) override { add(element->getArg()); }
+  void endVisit(ASTForStmt *element) override { add(element->getItem()); }
+
+private:
+  void add(ASTExpr *e) {
+    if (auto ve = dynamic_cast<ASTVariableExpr *>(e)) {
+      names.insert(ve->getName());
+    }
+  }
+};
+
+// Collects the names of the variables whose address is taken in a subtree
+class AddressTakenNames : public ASTVisitor {
+public:
+  std::set<std::string> names;
+
+  void endVisit(ASTRefExpr *element) override {
+    if (auto ve = dynamic_cast<ASTVariableExpr *>(element->getVar())) {
+      names.insert(ve->getName());
+    }
+  }
+};
+
+// Collects the indexing expressions and loops in a subtree
+class LoopContents : public ASTVisitor {
+public:
+  std::vector<ASTIndexingExpr *> accesses;
+  bool hasLoops = false;
+
+  void endVisit(ASTIndexingExpr *element) override {
+    accesses.push_back(element);
+  }
+  void endVisit(ASTForStmt *element) override { hasLoops = true; }
+};
+
+// Returns the value of a positive constant increment, one if there is none
+std::optional<int64_t> constantIncrement(ASTForStmt *loop) {
+  if (loop->getIncrement() == nullptr) {
+    return 1;
+  }
+  auto number = dynamic_cast<ASTNumberExpr *>(loop->getIncrement());
+  if (number == nullptr || number->getValue() <= 0) {
+    return std::nullopt;
+  }
+  return number->getValue();
+}
+
+// Returns c if the expression is "v", "v + c", "c + v" or "v - c"
+std::optional<int64_t> offsetFrom(ASTExpr *e, const std::string &v) {
+  auto isVar = [&v](ASTExpr *e) {
+    auto ve = dynamic_cast<ASTVariableExpr *>(e);
+    return ve != nullptr && ve->getName() == v;
+  };
+
+  if (isVar(e)) {
+    return 0;
+  }
+  auto binary = dynamic_cast<ASTBinaryExpr *>(e);
+  if (binary == nullptr) {
+    return std::nullopt;
+  }
+  auto left = dynamic_cast<ASTNumberExpr *>(binary->getLeft());
+  auto right = dynamic_cast<ASTNumberExpr *>(binary->getRight());
+  if (binary->getOp() == "+" && isVar(binary->getLeft()) && right != nullptr) {
+    return right->getValue();
+  } else if (binary->getOp() == "+" && left != nullptr &&
+             isVar(binary->getRight())) {
+    return left->getValue();
+  } else if (binary->getOp() == "-" && isVar(binary->getLeft()) &&
+             right != nullptr) {
+    return -static_cast<int64_t>(right->getValue());
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+/*
+ * Computes the bounds of expressions from the facts about the enclosing
+ * loops, recording the indexing expressions that are in bounds and the
+ * guards of the innermost loops.
+ */
+class RangeVisitor : public ASTVisitor {
+public:
+  explicit RangeVisitor(RangeAnalysis *results) : results(results) {}
+
+  bool visit(ASTFunction *element) override {
+    AddressTakenNames taken;
+    element->accept(&taken);
+    addressTaken = taken.names;
+    facts.clear();
+    return true;
+  }
+
+  // The fact about the loop variable only holds within the body
+  bool visit(ASTForStmt *element) override {
+    auto fact = loopFact(element);
+    for (auto child : element->getChildren()) {
+      if (child.get() != element->getBody()) {
+        child->accept(this);
+      }
+    }
+    facts.push_back(fact);
+    element->getBody()->accept(this);
+    return false;
+  }
+
+  void endVisit(ASTForStmt *element) override {
+    addGuards(element, facts.back());
+    facts.pop_back();
+  }
+
+  void endVisit(ASTIndexingExpr *element) override {
+    results->total++;
+    auto array = dynamic_cast<ASTVariableExpr *>(element->getArr());
+    if (array == nullptr || addressTaken.count(array->getName()) != 0) {
+      return;
+    }
+
+    auto index = bounds(element->getIdx());
+    if (index.hasLower && index.lower >= 0 && index.hasUpper &&
+        index.upperArray == array->getName() && index.upper <= -1) {
+      results->inBounds.insert(element);
+    }
+  }
+
+private:
+  // What is known about the variable of an enclosing loop
+  struct LoopFact {
+    std::string var;
+    Bounds range;
+    std::set<std::string> assigned;
+  };
+
+  RangeAnalysis *results;
+  std::set<std::string> addressTaken;
+  std::vector<LoopFact> facts;
+
+  /*
+   * The variable of a range loop stays within the range if it is not
+   * assigned in the body and the increment is positive.  Bounds relative to
+   * the length of an array only hold while the array is not assigned.
+   */
+  LoopFact loopFact(ASTForStmt *loop) {
+    LoopFact fact;
+    AssignedNames assigned;
+    loop->getBody()->accept(&assigned);
+    fact.assigned = assigned.names;
+
+    auto var = dynamic_cast<ASTVariableExpr *>(loop->getItem());
+    if (loop->getRangeStart() == nullptr || var == nullptr ||
+        !constantIncrement(loop) || fact.assigned.count(var->getName()) != 0 ||
+        addressTaken.count(var->getName()) != 0) {
+      return fact;
+    }
+    fact.var = var->getName();
+
+    auto start = bounds(loop->getRangeStart());
+    fact.range.hasLower = start.hasLower;
+    fact.range.lower = start.lower;
+
+    auto end = bounds(loop->getRangeEnd());
+    if (end.hasUpper && fact.assigned.count(end.upperArray) == 0) {
+      fact.range.hasUpper = true;
+      fact.range.upperArray = end.upperArray;
+      fact.range.upper = end.upper - 1;
+    }
+    return fact;
+  }
+
+  Bounds bounds(ASTExpr *e) {
+    Bounds b;
+    if (auto number = dynamic_cast<ASTNumberExpr *>(e)) {
+      b.hasLower = b.hasUpper = true;
+      b.lower = b.upper = number->getValue();
+    } else if (auto var = dynamic_cast<ASTVariableExpr *>(e)) {
+      for (auto fact = facts.rbegin(); fact != facts.rend(); ++fact) {
+        if (fact->var == var->getName()) {
+          return fact->range;
+        }
+      }
+    } else if (auto length = dynamic_cast<ASTArrayLenExpr *>(e)) {
+      b.hasLower = true;
+      auto array = dynamic_cast<ASTVariableExpr *>(length->getPtr());
+      if (array != nullptr && addressTaken.count(array->getName()) == 0) {
+        b.hasUpper = true;
+        b.upperArray = array->getName();
+      }
+    } else if (auto binary = dynamic_cast<ASTBinaryExpr *>(e)) {
+      auto l = bounds(binary->getLeft());
+      auto r = bounds(binary->getRight());
+      if (binary->getOp() == "+") {
+        b.hasLower = l.hasLower && r.hasLower;
+        b.lower = l.lower + r.lower;
+        b.hasUpper = l.hasUpper && r.hasUpper &&
+                     (l.upperArray.empty() || r.upperArray.empty());
+        b.upperArray = l.upperArray + r.upperArray;
+        b.upper = l.upper + r.upper;
+      } else if (binary->getOp() == "-") {
+        b.hasLower = l.hasLower && r.hasUpper && r.upperArray.empty();
+        b.lower = l.lower - r.upper;
+        b.hasUpper = l.hasUpper && r.hasLower;
+        b.upperArray = l.upperArray;
+        b.upper = l.upper - r.lower;
+      }
+    }
+    return b;
+  }
+
+  /*
+   * An innermost loop is versioned for the indexing of arrays that are not
+   * assigned in the loop at offsets of the loop variable.
+   */
+  void addGuards(ASTForStmt *loop, const LoopFact &fact) {
+    if (fact.var.empty()) {
+      return;
+    }
+
+    LoopContents contents;
+    loop->getBody()->accept(&contents);
+    if (contents.hasLoops) {
+      return;
+    }
+
+    std::map<std::string, RangeAnalysis::ArrayGuard> arrays;
+    std::set<ASTIndexingExpr *> guarded;
+    for (auto access : contents.accesses) {
+      auto array = dynamic_cast<ASTVariableExpr *>(access->getArr());
+      if (results->inBounds.count(access) != 0 || array == nullptr ||
+          fact.assigned.count(array->getName()) != 0 ||
+          addressTaken.count(array->getName()) != 0) {
+        continue;
+      }
+      auto offset = offsetFrom(access->getIdx(), fact.var);
+      if (!offset) {
+        continue;
+      }
+
+      auto known = arrays.find(array->getName());
+      if (known == arrays.end()) {
+        arrays[array->getName()] =
+            RangeAnalysis::ArrayGuard{array->getName(), *offset, *offset};
+      } else {
+        known->second.minOffset = std::min(known->second.minOffset, *offset);
+        known->second.maxOffset = std::max(known->second.maxOffset, *offset);
+      }
+      guarded.insert(access);
+    }
+
+    if (guarded.empty()) {
+      return;
+    }
+    for (auto &array : arrays) {
+      results->guards[loop].push_back(array.second);
+    }
+    results->guardedAccesses[loop] = guarded;
+    results->hoisted += guarded.size();
+  }
+};
+
+std::shared_ptr<RangeAnalysis> RangeAnalysis::analyze(ASTProgram *program) {
+  auto results = std::make_shared<RangeAnalysis>();
+  RangeVisitor visitor(results.get());
+  program->accept(&visitor);
+
+  LOG_S(1) << "Bounds checks: " << results->getEliminated() << " of "
+           << results->getTotal() << " eliminated, "
+           << results->getHoisted() << " hoisted into loop guards";
+  return results;
+}
+
+bool RangeAnalysis::isInBounds(ASTIndexingExpr *e) const {
+  return inBounds.count(e) != 0;
+}
+
+std::vector<RangeAnalysis::ArrayGuard>
+RangeAnalysis::getGuards(ASTForStmt *loop) const {
+  auto it = guards.find(loop);
+  if (it == guards.end()) {
+    return {};
+  }
+  return it->second;
+}
+
+std::set<ASTIndexingExpr *>
+RangeAnalysis::getGuardedAccesses(ASTForStmt *loop) const {
+  auto it = guardedAccesses.find(loop);
+  if (it == guardedAccesses.end()) {
+    return {};
+  }
+  return it->second;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ASTProgram.h"
+#include "AST.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+/*! \class RangeAnalysis
+ *  \brief Interval analysis of array indexing in range loops.
+ *
+ * The loop variable of "for (i : lo .. hi)" ranges over [lo, hi - 1] when the
+ * loop body does not change it and the increment is a positive constant.
+ * Intervals are computed for the index expressions from these facts, where
+ * upper bounds may be relative to the length of an array variable, e.g.,
+ * "#a - 1".  An indexing expression whose interval lies within the array is
+ * in bounds and needs no check.
+ *
+ * The remaining indexing of an array variable at offsets of the variable of an
+ * innermost range loop, e.g., "a[i + 1]", can be checked once before the loop
+ * for all of its iterations.  Such a loop gets a guard for each of those
+ * arrays, so that a version of the loop without those checks can be used when
+ * the guards hold.
+ */
+class RangeAnalysis {
+public:
+  /*! \struct ArrayGuard
+   *  \brief The offsets from the loop variable at which an array is indexed.
+   */
+  struct ArrayGuard {
+    std::string array;
+    int64_t minOffset;
+    int64_t maxOffset;
+  };
+
+  /*! \brief Analyze the indexing expressions of a program.
+   * \param program The program AST
+   * \return The analysis results
+   */
+  static std::shared_ptr<RangeAnalysis> analyze(ASTProgram *program);
+
+  /*! \brief Returns whether the index is always within the array.
+   */
+  bool isInBounds(ASTIndexingExpr *e) const;
+
+  /*! \brief Returns the guards under which the loop needs no checks for the
+   * guarded indexing expressions, or nothing if the loop is not versioned.
+   */
+  std::vector<ArrayGuard> getGuards(ASTForStmt *loop) const;
+
+  /*! \brief Returns the indexing expressions covered by the loop guards.
+   */
+  std::set<ASTIndexingExpr *> getGuardedAccesses(ASTForStmt *loop) const;
+
+  //! The number of indexing expressions in the program
+  int getTotal() const { return total; }
+
+  //! The number of indexing expressions that are always in bounds
+  int getEliminated() const { return inBounds.size(); }
+
+  //! The number of indexing expressions covered by loop guards
+  int getHoisted() const { return hoisted; }
+
+private:
+  friend class RangeVisitor;
+
+  int total = 0;
+  int hoisted = 0;
+  std::set<ASTIndexingExpr *> inBounds;
+  std::map<ASTForStmt *, std::vector<ArrayGuard>> guards;
+  std::map<ASTForStmt *, std::set<ASTIndexingExpr *>> guardedAccesses;
+};
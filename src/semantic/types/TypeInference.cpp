@@ -1,120 +1,326 @@
 #include "TypeInference.h"
+#include "ASTVisitor.h"
 #include "AbsentFieldChecker.h"
 #include "PolyTypeConstraintCollectVisitor.h"
+#include "TipTypeFactory.h"
 #include "TypeConstraint.h"
 #include "TypeConstraintCollectVisitor.h"
 #include "Unifier.h"
 #include "loguru.hpp"
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <thread>
 
-/* Local name space for DFS visit variables */
-namespace {
-std::deque<ASTFunction *> sorted;
-std::vector<ASTFunction *> unmarked;
-} // namespace
-
-/* DFS to compute call dependence assuming that the graph
- * does not have cycles.  The DFS updates the unmarked vector
- * which records the functions whose dependences have been computed.
+/* Filters the call graph to eliminate any functions that call, either
+ * directly or indirectly, a recursive function.
+ * Returns a topological ordering of functions in the filtered graph.
+ *
+ * The strongly connected components of the call graph are computed once.  A
+ * function is recursive if its component has more than one member or if it
+ * calls itself.  Components are listed callees first, so by the time a
+ * function is considered it is already known whether any of its callees may
+ * reach a recursive function, and the functions that are kept are already in
+ * topological order.
  */
-void topoVisit(CallGraph *cg, ASTFunction *f) {
-  // If f is marked, i.e., not in unmarked, then backtrack DFS
-  if (std::find(unmarked.begin(), unmarked.end(), f) == unmarked.end()) {
-    return;
-  }
+std::deque<ASTFunction *> topoSortNonRecursive(CallGraph *cg) {
+  std::deque<ASTFunction *> sorted;
+  std::set<ASTFunction *> filtered;
 
-  // remove it from unmarked
-  auto fPosition = std::find(unmarked.begin(), unmarked.end(), f);
-  assert(fPosition != unmarked.end()); // f must be in the unmarked list
-  unmarked.erase(fPosition);
+  for (auto &scc : cg->getSCCs()) {
+    auto f = scc.front();
+    auto callees = cg->getCallees(f);
+
+    bool filter = scc.size() > 1 || callees.count(f) != 0;
+    for (auto c : callees) {
+      filter = filter || filtered.count(c) != 0;
+    }
 
-  // visit called functions
-  for (auto c : cg->getCallees(f)) {
-    topoVisit(cg, c);
+    if (filter) {
+      filtered.insert(scc.begin(), scc.end());
+    } else {
+      sorted.push_back(f);
+    }
   }
 
-  // add it to sorted
-  sorted.push_back(f);
+  return sorted;
 }
 
-/* Determine whether there is a call chain from function f to g.
- * To determine if a function is recursive call with f==g.
+namespace { // Anonymous namespace for the parallel polymorphic inference
+
+/* Collects the functions whose type variable may appear in the constraints of
+ * a function, i.e., the functions that it names.  Direct calls of polymorphic
+ * functions are skipped, since their constraints refer to an instantiated copy
+ * of the generic type of the callee rather than to its type variable.
  */
-bool mayIndirectlyCall(CallGraph *cg, ASTFunction *f, ASTFunction *g) {
-  bool result = false;
-  auto callees = cg->getCallees(f);
-  for (auto c : callees) {
-    if (c == g) {
-      return true;
-    } else {
-      result = result || mayIndirectlyCall(cg, c, g);
+class FunctionRefVisitor : public ASTVisitor {
+public:
+  FunctionRefVisitor(SymbolTable *st, ASTDeclNode *f) : symbols(st), scope(f) {}
+
+  bool visit(ASTFunAppExpr *element) override {
+    auto callee = dynamic_cast<ASTVariableExpr *>(element->getFunction());
+    if (callee != nullptr && resolve(callee) != nullptr &&
+        symbols->getPoly(callee->getName())) {
+      polyCallees.insert(callee);
+    }
+    return true;
+  }
+
+  void endVisit(ASTVariableExpr *element) override {
+    auto decl = resolve(element);
+    if (decl != nullptr && polyCallees.count(element) == 0) {
+      refs.insert(decl);
     }
   }
-  return result;
-}
 
-// Topologically sort the set of functions based on the call graph.
-std::deque<ASTFunction *> topoSort(CallGraph *cg,
-                                   std::vector<ASTFunction *> funcs) {
-  /* Initialize globals for sort DFS */
-  sorted = std::deque<ASTFunction *>();
-  unmarked = funcs;
+  std::set<ASTDeclNode *> refs;
 
-  while (!unmarked.empty()) {
-    auto f = unmarked.back();
-    topoVisit(cg, f);
+private:
+  ASTDeclNode *resolve(ASTVariableExpr *ve) {
+    if (symbols->getLocal(ve->getName(), scope) != nullptr) {
+      return nullptr;
+    }
+    return symbols->getFunction(ve->getName());
   }
-  return sorted;
+
+  SymbolTable *symbols;
+  ASTDeclNode *scope;
+  std::set<ASTVariableExpr *> polyCallees;
+};
+
+// A function subjected to polymorphic inference, in topological order
+struct PolyTask {
+  ASTFunction *f;
+  int group;
+  std::vector<TypeConstraint> constraints;
+
+  // Generic types of the polymorphic callees solved in other groups
+  std::map<ASTDeclNode *, std::shared_ptr<TipType>> generics;
+
+  // Groups that must have solved every function preceding this one
+  std::set<int> waitsFor;
+};
+
+// Functions whose constraints share type variables, solved by one unifier
+struct PolyGroup {
+  std::vector<int> members;
+  std::size_t next = 0;
+  bool busy = false;
+  std::shared_ptr<Unifier> unifier = std::make_shared<Unifier>();
+
+  // Generic types other groups need, as (task, callee), by task position
+  std::vector<std::pair<int, ASTDeclNode *>> requests;
+  std::size_t served = 0;
+
+  int nextPosition() const {
+    return next < members.size() ? members[next] : INT_MAX;
+  }
+};
+
+int findGroup(std::vector<int> &parent, int i) {
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
 }
 
-std::vector<ASTFunction *> recursiveFuncs(CallGraph *cg) {
-  auto funcs = cg->getVertices();
-  auto recursiveFuncs = std::vector<ASTFunction *>();
-  for (auto f : funcs) {
-    if (mayIndirectlyCall(cg, f, f)) {
-      recursiveFuncs.push_back(f);
+/* Partitions the functions subjected to polymorphic inference into groups
+ * whose constraints share no type variables.
+ *
+ * Two functions share type variables only if one of them names the other,
+ * or if both name the same function.  A function that calls a polymorphic
+ * function of another group depends on the generic type of the callee, which
+ * is recorded as a request to the group of the callee.
+ */
+std::vector<PolyGroup> partition(std::vector<PolyTask> &tasks,
+                                 SymbolTable *symbols, CallGraph *cg) {
+  std::map<ASTDeclNode *, int> index;
+  for (auto f : cg->getVertices()) {
+    index.emplace(f->getDecl(), index.size());
+  }
+  std::vector<int> parent(index.size());
+  std::iota(parent.begin(), parent.end(), 0);
+
+  for (auto &t : tasks) {
+    FunctionRefVisitor visitor(symbols, t.f->getDecl());
+    t.f->accept(&visitor);
+    for (auto ref : visitor.refs) {
+      parent[findGroup(parent, index[ref])] =
+          findGroup(parent, index[t.f->getDecl()]);
+    }
+  }
+
+  std::map<int, int> groupOf;
+  std::map<ASTDeclNode *, int> positions;
+  std::vector<PolyGroup> groups;
+  for (int p = 0; p < tasks.size(); p++) {
+    int root = findGroup(parent, index[tasks[p].f->getDecl()]);
+    auto inserted = groupOf.emplace(root, groups.size());
+    if (inserted.second) {
+      groups.emplace_back();
     }
+    tasks[p].group = inserted.first->second;
+    groups[tasks[p].group].members.push_back(p);
+    positions[tasks[p].f->getDecl()] = p;
   }
-  return recursiveFuncs;
+
+  for (int p = 0; p < tasks.size(); p++) {
+    for (auto callee : cg->getCallees(tasks[p].f)) {
+      auto c = positions.find(callee->getDecl());
+      if (c == positions.end() || !symbols->getPoly(callee->getName()) ||
+          tasks[c->second].group == tasks[p].group) {
+        continue;
+      }
+      groups[tasks[c->second].group].requests.emplace_back(p, c->first);
+      tasks[p].waitsFor.insert(tasks[c->second].group);
+    }
+  }
+
+  return groups;
 }
 
-/* Filters the call graph to eliminate any functions that call, either
- * directly or indirectly, a recursive function.
- * Returns a topological ordering of functions in the filtered graph.
+/* Solves the polymorphic constraints of the functions in topological order
+ * using the given number of threads, recording the constraints collected for
+ * each function.
+ *
+ * Each group has its own unifier and its functions are solved one at a time,
+ * in topological order, exactly as they would be by the shared unifier of the
+ * sequential inference.  A function is ready once its predecessor in its
+ * group is solved and the groups of its polymorphic callees have solved all
+ * of the functions preceding it, so that the generic types of the callees are
+ * the ones the sequential inference would use.  The first unsolved function
+ * is always ready, and ready functions are picked in topological order.
  */
-std::deque<ASTFunction *> topoSortNonRecursive(CallGraph *cg) {
-  auto recFuncs = recursiveFuncs(cg);
+void solveParallel(std::vector<PolyTask> &tasks, SymbolTable *symbols,
+                   CallGraph *cg, int jobs) {
+  auto groups = partition(tasks, symbols, cg);
+  for (auto &g : groups) {
+    std::sort(g.requests.begin(), g.requests.end());
+  }
 
-  // Filter functions that directly or indirectly call a recursive function
-  auto nonRecursiveFuncs = std::vector<ASTFunction *>();
-  for (auto f : cg->getVertices()) {
-    bool filter = false;
-    for (auto r : recFuncs) {
-      if (f == r) {
-        filter = true;
-      } else {
-        filter = mayIndirectlyCall(cg, f, r);
+  LOG_S(1) << "Solving " << tasks.size() << " functions in " << groups.size()
+           << " independent groups using " << jobs << " threads";
+
+  std::mutex lock;
+  std::condition_variable changed;
+  int inFlight = 0;
+  int failedAt = INT_MAX;
+  std::exception_ptr failure;
+
+  auto ready = [&](int p) {
+    for (auto g : tasks[p].waitsFor) {
+      if (groups[g].nextPosition() < p) {
+        return false;
       }
-      if (filter)
-        break;
     }
+    return true;
+  };
+
+  auto worker = [&]() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+      int pick = -1;
+      for (int g = 0; g < groups.size(); g++) {
+        int p = groups[g].nextPosition();
+        if (!groups[g].busy && p < failedAt && ready(p) &&
+            (pick == -1 || p < groups[pick].nextPosition())) {
+          pick = g;
+        }
+      }
+      if (pick == -1) {
+        if (inFlight == 0) {
+          break;
+        }
+        changed.wait(guard);
+        continue;
+      }
+
+      auto &group = groups[pick];
+      auto &task = tasks[group.nextPosition()];
+      group.busy = true;
+      inFlight++;
+      guard.unlock();
+
+      std::vector<std::pair<int, std::shared_ptr<TipType>>> generics;
+      std::exception_ptr error;
+      try {
+        LOG_S(1) << "Generating Polymorphic Type Constraints for " << *task.f;
+
+        PolyTypeConstraintCollectVisitor polyVisitor(
+            symbols, cg, group.unifier, task.generics);
+        task.f->accept(&polyVisitor);
+        task.constraints = polyVisitor.getCollectedConstraints();
+
+        group.unifier->add(task.constraints);
+        group.unifier->solve();
+
+        // Hand out the generic types requested by the functions that
+        // precede the next function of this group
+        int upTo = group.next + 1 < group.members.size()
+                       ? group.members[group.next + 1]
+                       : INT_MAX;
+        for (; group.served < group.requests.size() &&
+               group.requests[group.served].first < upTo;
+             group.served++) {
+          auto &r = group.requests[group.served];
+          auto var = TipTypeFactory::getVar(r.second);
+          generics.emplace_back(r.first, group.unifier->inferred(var));
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
 
-    if (!filter) {
-      nonRecursiveFuncs.push_back(f);
+      guard.lock();
+      int p = group.nextPosition();
+      if (error) {
+        if (p < failedAt) {
+          failedAt = p;
+          failure = error;
+        }
+      } else {
+        for (std::size_t i = 0; i < generics.size(); i++) {
+          auto &r = group.requests[group.served - generics.size() + i];
+          tasks[generics[i].first].generics[r.second] = generics[i].second;
+        }
+        group.next++;
+      }
+      group.busy = false;
+      inFlight--;
+      changed.notify_all();
     }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < jobs; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto &t : threads) {
+    t.join();
   }
 
-  // Topologically sort the graph comprised of the non-recursive functions.
-  return topoSort(cg, nonRecursiveFuncs);
+  // Report the error the sequential inference would have reported
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
 }
 
+} // namespace
+
 /*
  * The returned unifier accounts for all of the program that is NOT
  * handled within the elements of the unifier map, i.e., is not
  * subjected to polymorphic type inference.
  */
 std::shared_ptr<TypeInference> runPoly(ASTProgram *ast, SymbolTable *symbols,
-                                       CallGraph *cg) {
+                                       CallGraph *cg, int jobs) {
   LOG_S(1) << "Generating Polymorphic Type Constraints";
 
   /* A single unifier is used for the staged polymorphic inference
@@ -128,14 +334,32 @@ std::shared_ptr<TypeInference> runPoly(ASTProgram *ast, SymbolTable *symbols,
    * in topological order for the call graph.
    */
   auto nonRecursiveFuncs = topoSortNonRecursive(cg);
-  for (auto f : nonRecursiveFuncs) {
-    LOG_S(1) << "Generating Polymorphic Type Constraints for " << *f;
+  std::set<ASTFunction *> polyFuncs(nonRecursiveFuncs.begin(),
+                                    nonRecursiveFuncs.end());
+  if (jobs > 1 && nonRecursiveFuncs.size() > 1) {
+    /* Functions that share no type variables are solved in parallel by
+     * separate unifiers.  Their constraints are then added to the shared
+     * unifier in topological order and solved along with the monomorphic
+     * constraints below.
+     */
+    std::vector<PolyTask> tasks;
+    for (auto f : nonRecursiveFuncs) {
+      tasks.push_back(PolyTask{f});
+    }
+    solveParallel(tasks, symbols, cg, jobs);
+    for (auto &t : tasks) {
+      unifier->add(t.constraints);
+    }
+  } else {
+    for (auto f : nonRecursiveFuncs) {
+      LOG_S(1) << "Generating Polymorphic Type Constraints for " << *f;
 
-    PolyTypeConstraintCollectVisitor polyVisitor(symbols, cg, unifier);
-    f->accept(&polyVisitor);
+      PolyTypeConstraintCollectVisitor polyVisitor(symbols, cg, unifier);
+      f->accept(&polyVisitor);
 
-    unifier->add(polyVisitor.getCollectedConstraints());
-    unifier->solve();
+      unifier->add(polyVisitor.getCollectedConstraints());
+      unifier->solve();
+    }
   }
 
   LOG_S(1) << "Generating Residual Monomorphic Type Constraints";
@@ -145,8 +369,7 @@ std::shared_ptr<TypeInference> runPoly(ASTProgram *ast, SymbolTable *symbols,
    */
   for (auto f : cg->getVertices()) {
     // Skip the functions for which polymorphic inference was applied
-    if (std::find(nonRecursiveFuncs.begin(), nonRecursiveFuncs.end(), f) ==
-        nonRecursiveFuncs.end()) {
+    if (polyFuncs.count(f) == 0) {
       TypeConstraintCollectVisitor monoVisitor(symbols);
       f->accept(&monoVisitor);
       unifier->add(monoVisitor.getCollectedConstraints());
@@ -189,15 +412,21 @@ std::shared_ptr<TypeInference> runMono(ASTProgram *ast, SymbolTable *symbols) {
  */
 std::shared_ptr<TypeInference> TypeInference::run(ASTProgram *ast, bool doPoly,
                                                   CallGraph *cg,
-                                                  SymbolTable *symbols) {
-  return (doPoly) ? runPoly(ast, symbols, cg) : runMono(ast, symbols);
+                                                  SymbolTable *symbols,
+                                                  int jobs) {
+  return (doPoly) ? runPoly(ast, symbols, cg, jobs) : runMono(ast, symbols);
 }
 
 std::shared_ptr<TipType> TypeInference::getInferredType(ASTDeclNode *node) {
-  auto var = std::make_shared<TipVar>(node);
+  auto var = TipTypeFactory::getVar(node);
   return unifier->inferred(var);
 };
 
+std::shared_ptr<TipType> TypeInference::getInferredExprType(ASTExpr *node) {
+  auto var = TipTypeFactory::getVar(node);
+  return unifier->inferred(var);
+}
+
 void TypeInference::print(std::ostream &s) {
   s << "\nFunctions : {\n";
   auto skip = true;
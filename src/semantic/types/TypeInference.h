@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ASTDeclNode.h"
+#include "ASTExpr.h"
 #include "ASTProgram.h"
 #include "CallGraph.h"
 #include "SymbolTable.h"
@@ -40,10 +41,12 @@ public:
    * \param ast The program AST
    * \param polyInf Flag indicating whether to perform polymorphic or
    * monomorphic inference \param cg The program call graph \param symbols The
-   * symbol table
+   * symbol table \param jobs The number of threads polymorphic inference may
+   * use to solve the constraints of independent functions
    */
-  static std::shared_ptr<TypeInference>
-  run(ASTProgram *ast, bool polyInf, CallGraph *cg, SymbolTable *symbols);
+  static std::shared_ptr<TypeInference> run(ASTProgram *ast, bool polyInf,
+                                            CallGraph *cg, SymbolTable *symbols,
+                                            int jobs = 1);
 
   /*! \fn getInferredType
    *  \brief Returns the type expression inferred for the given ASTDeclNode.
@@ -62,6 +65,19 @@ public:
    */
   std::shared_ptr<TipType> getInferredType(ASTDeclNode *node);
 
+  /*! \fn getInferredExprType
+   *  \brief Returns the type expression inferred for the given expression.
+   *
+   * The type variables of variable expressions are those of their
+   * declarations, so the types of variables must be looked up with
+   * getInferredType on the declaration instead.
+   *
+   * \sa getInferredType
+   * \param node An AST expression node other than a variable expression.
+   * \return A shared pointer to the inferred type for the AST node.
+   */
+  std::shared_ptr<TipType> getInferredExprType(ASTExpr *node);
+
   //! Print type inference results to output stream
   void print(std::ostream &os);
 };
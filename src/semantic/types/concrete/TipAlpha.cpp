@@ -2,6 +2,7 @@
 #include "TipTypeVisitor.h"
 #include "loguru.hpp"
 #include <sstream>
+#include <typeinfo>
 
 TipAlpha::TipAlpha(ASTNode *node) : TipVar(node), context(nullptr), name(""){};
 
@@ -27,6 +28,10 @@ std::ostream &TipAlpha::print(std::ostream &out) const {
 }
 
 bool TipAlpha::operator==(const TipType &other) const {
+  if (this == &other) {
+    return true;
+  }
+
   auto otherTipAlpha = dynamic_cast<const TipAlpha *>(&other);
   if (!otherTipAlpha) {
     return false;
@@ -41,6 +46,13 @@ bool TipAlpha::operator!=(const TipType &other) const {
   return !(*this == other);
 }
 
+std::size_t TipAlpha::hash() const {
+  auto h = hashCombine(typeid(TipAlpha).hash_code(),
+                       std::hash<ASTNode *>()(node));
+  h = hashCombine(h, std::hash<ASTNode *>()(context));
+  return hashCombine(h, std::hash<std::string>()(name));
+}
+
 ASTNode *TipAlpha::getContext() const { return context; }
 
 std::string const &TipAlpha::getName() const { return name; }
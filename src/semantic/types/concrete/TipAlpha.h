@@ -37,6 +37,7 @@ public:
 
   bool operator==(const TipType &other) const override;
   bool operator!=(const TipType &other) const override;
+  std::size_t hash() const override;
 
   void accept(TipTypeVisitor *visitor) override;
 
@@ -7,6 +7,10 @@ TipArray::TipArray(std::shared_ptr<TipType> of)
     : TipCons(std::move(std::vector<std::shared_ptr<TipType>>{of})) {}
 
 bool TipArray::operator==(const TipType &other) const {
+  if (this == &other) {
+    return true;
+  }
+
   auto otherTipArray = dynamic_cast<const TipArray *>(&other);
   if (!otherTipArray) {
     return false;
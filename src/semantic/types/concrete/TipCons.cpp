@@ -1,6 +1,8 @@
 #include "TipCons.h"
 #include "TipTypeVisitor.h"
 
+#include <typeinfo>
+
 int TipCons::arity() const { return arguments.size(); }
 
 namespace {
@@ -27,11 +29,23 @@ bool TipCons::doMatch(TipType const *t) const {
   return false;
 }
 
+std::size_t TipCons::hash() const {
+  if (!hashed) {
+    cachedHash = typeid(*this).hash_code();
+    for (auto &a : arguments) {
+      cachedHash = hashCombine(cachedHash, a->hash());
+    }
+    hashed = true;
+  }
+  return cachedHash;
+}
+
 TipCons::TipCons(std::vector<std::shared_ptr<TipType>> arguments)
     : arguments(std::move(arguments)) {}
 
 void TipCons::setArguments(std::vector<std::shared_ptr<TipType>> &a) {
   arguments = a;
+  hashed = false;
 }
 
 const std::vector<std::shared_ptr<TipType>> &TipCons::getArguments() const {
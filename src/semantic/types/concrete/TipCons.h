@@ -20,9 +20,21 @@ public:
   virtual int arity() const;
   bool doMatch(TipType const *t) const;
 
+  /*! \brief Hash of the constructor and its arguments.
+   *
+   * Record field names are not part of the hash since TipRecord equality
+   * only compares the field types.  The hash is computed on first use and
+   * cached until the arguments are replaced.
+   */
+  std::size_t hash() const override;
+
   // delegate the obligation to override accept to subtypes
 
 protected:
   TipCons(std::vector<std::shared_ptr<TipType>> arguments);
   std::vector<std::shared_ptr<TipType>> arguments;
+
+private:
+  mutable std::size_t cachedHash = 0;
+  mutable bool hashed = false;
 };
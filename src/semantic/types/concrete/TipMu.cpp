@@ -2,6 +2,7 @@
 #include "TipTypeVisitor.h"
 
 #include <iostream>
+#include <typeinfo>
 
 TipMu::TipMu(std::shared_ptr<TipVar> v, std::shared_ptr<TipType> t)
     : v(std::move(v)), t(std::move(t)) {}
@@ -11,6 +12,10 @@ const std::shared_ptr<TipVar> &TipMu::getV() const { return v; }
 const std::shared_ptr<TipType> &TipMu::getT() const { return t; }
 
 bool TipMu::operator==(const TipType &other) const {
+  if (this == &other) {
+    return true;
+  }
+
   auto mu = dynamic_cast<const TipMu *>(&other);
   if (!mu) {
     return false;
@@ -20,6 +25,11 @@ bool TipMu::operator==(const TipType &other) const {
 
 bool TipMu::operator!=(const TipType &other) const { return !(*this == other); }
 
+std::size_t TipMu::hash() const {
+  auto h = hashCombine(typeid(TipMu).hash_code(), v->hash());
+  return hashCombine(h, t->hash());
+}
+
 std::ostream &TipMu::print(std::ostream &out) const {
   out << "\u03bc" << *v << "." << *t;
   return out;
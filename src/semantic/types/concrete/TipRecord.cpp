@@ -23,6 +23,10 @@ std::ostream &TipRecord::print(std::ostream &out) const {
 
 // This does not obey the semantics of alpha init values
 bool TipRecord::operator==(const TipType &other) const {
+  if (this == &other) {
+    return true;
+  }
+
   auto tipRecord = dynamic_cast<const TipRecord *>(&other);
   if (!tipRecord) {
     return false;
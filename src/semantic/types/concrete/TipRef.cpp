@@ -7,6 +7,10 @@ TipRef::TipRef(std::shared_ptr<TipType> of)
     : TipCons(std::move(std::vector<std::shared_ptr<TipType>>{of})) {}
 
 bool TipRef::operator==(const TipType &other) const {
+  if (this == &other) {
+    return true;
+  }
+
   auto otherTipRef = dynamic_cast<const TipRef *>(&other);
   if (!otherTipRef) {
     return false;
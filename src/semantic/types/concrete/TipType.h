@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <ostream>
 
@@ -9,7 +10,8 @@ class TipTypeVisitor;
 /*! \class TipType
  * \brief Abstract base class of all types
  *
- * Defines equality comparisons, output operator, and accept for visitor.
+ * Defines equality comparisons, hashing, output operator, and accept for
+ * visitor.
  * Type variables and operators, like mu, directly subtype TipType.
  * All other types, e.g., ints, functions, etc., are subtypes of TipCons,
  * since this allows type unification to just handle TipCons.  Consequently,
@@ -20,6 +22,15 @@ class TipType {
 public:
   virtual bool operator==(const TipType &other) const = 0;
   virtual bool operator!=(const TipType &other) const = 0;
+
+  /*! \brief Structural hash of the type.
+   *
+   * Must agree with operator==, i.e., types that compare equal produce the
+   * same hash.  This lets solvers index terms in hashed containers instead
+   * of scanning them with deep comparisons.
+   */
+  virtual std::size_t hash() const = 0;
+
   virtual ~TipType() = default;
   friend std::ostream &operator<<(std::ostream &os, const TipType &obj) {
     return obj.print(os);
@@ -29,4 +40,8 @@ public:
 
 protected:
   virtual std::ostream &print(std::ostream &out) const = 0;
+
+  static std::size_t hashCombine(std::size_t seed, std::size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+  }
 };
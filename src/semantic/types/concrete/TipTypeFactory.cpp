@@ -0,0 +1,170 @@
+#include "TipTypeFactory.h"
+#include "InternalError.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace { // Anonymous namespace for the intern table
+
+// Interned types keyed by their structural hash
+std::unordered_multimap<std::size_t, std::weak_ptr<TipType>> table;
+
+// Guards the table so that independent analyses may build types concurrently
+std::mutex tableLock;
+
+// Number of entries at which the next sweep of expired entries happens
+std::size_t sweepThreshold = 1024;
+
+/*! \brief Check that two equal types are interchangeable.
+ *
+ * TipRecord equality ignores the field names, but a record must only be
+ * shared with records that print the same way.
+ */
+bool sameNames(TipType const *t1, TipType const *t2) {
+  auto r1 = dynamic_cast<TipRecord const *>(t1);
+  auto r2 = dynamic_cast<TipRecord const *>(t2);
+  if (r1 == nullptr || r2 == nullptr) {
+    return r1 == r2;
+  }
+  return r1->getNames() == r2->getNames();
+}
+
+void sweep() {
+  for (auto it = table.begin(); it != table.end();) {
+    if (it->second.expired()) {
+      it = table.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  sweepThreshold = std::max(sweepThreshold, 2 * table.size());
+}
+
+std::shared_ptr<TipType> internType(std::shared_ptr<TipType> t) {
+  std::lock_guard<std::mutex> guard(tableLock);
+
+  // Computing the hash here, under the lock, fills the hash cache of the
+  // node before it can be shared with other threads.
+  auto h = t->hash();
+
+  auto range = table.equal_range(h);
+  for (auto it = range.first; it != range.second;) {
+    auto existing = it->second.lock();
+    if (existing == nullptr) {
+      it = table.erase(it);
+      continue;
+    }
+    if (*existing == *t && sameNames(existing.get(), t.get())) {
+      return existing;
+    }
+    ++it;
+  }
+
+  if (table.size() >= sweepThreshold) {
+    sweep();
+  }
+
+  table.emplace(h, t);
+  return t;
+}
+
+template <typename T> std::shared_ptr<T> intern(std::shared_ptr<T> t) {
+  return std::static_pointer_cast<T>(internType(std::move(t)));
+}
+
+} // namespace
+
+std::shared_ptr<TipInt> TipTypeFactory::getInt() {
+  return intern(std::make_shared<TipInt>());
+}
+
+std::shared_ptr<TipBool> TipTypeFactory::getBool() {
+  return intern(std::make_shared<TipBool>());
+}
+
+std::shared_ptr<TipAbsentField> TipTypeFactory::getAbsentField() {
+  return intern(std::make_shared<TipAbsentField>());
+}
+
+std::shared_ptr<TipVar> TipTypeFactory::getVar(ASTNode *node) {
+  return intern(std::make_shared<TipVar>(node));
+}
+
+std::shared_ptr<TipAlpha> TipTypeFactory::getAlpha(ASTNode *node) {
+  return intern(std::make_shared<TipAlpha>(node));
+}
+
+std::shared_ptr<TipAlpha> TipTypeFactory::getAlpha(ASTNode *node,
+                                                   std::string const &name) {
+  return intern(std::make_shared<TipAlpha>(node, name));
+}
+
+std::shared_ptr<TipAlpha> TipTypeFactory::getAlpha(ASTNode *node,
+                                                   ASTNode *context,
+                                                   std::string const &name) {
+  return intern(std::make_shared<TipAlpha>(node, context, name));
+}
+
+std::shared_ptr<TipRef> TipTypeFactory::getRef(std::shared_ptr<TipType> of) {
+  return intern(std::make_shared<TipRef>(std::move(of)));
+}
+
+std::shared_ptr<TipArray>
+TipTypeFactory::getArray(std::shared_ptr<TipType> of) {
+  return intern(std::make_shared<TipArray>(std::move(of)));
+}
+
+std::shared_ptr<TipFunction>
+TipTypeFactory::getFunction(std::vector<std::shared_ptr<TipType>> params,
+                            std::shared_ptr<TipType> ret) {
+  return intern(
+      std::make_shared<TipFunction>(std::move(params), std::move(ret)));
+}
+
+std::shared_ptr<TipRecord>
+TipTypeFactory::getRecord(std::vector<std::shared_ptr<TipType>> inits,
+                          std::vector<std::string> names) {
+  return intern(
+      std::make_shared<TipRecord>(std::move(inits), std::move(names)));
+}
+
+std::shared_ptr<TipMu> TipTypeFactory::getMu(std::shared_ptr<TipVar> v,
+                                             std::shared_ptr<TipType> t) {
+  return intern(std::make_shared<TipMu>(std::move(v), std::move(t)));
+}
+
+std::shared_ptr<TipCons>
+TipTypeFactory::getCons(TipCons const *c,
+                        std::vector<std::shared_ptr<TipType>> args) {
+  if (dynamic_cast<TipInt const *>(c)) {
+    return getInt();
+  } else if (dynamic_cast<TipBool const *>(c)) {
+    return getBool();
+  } else if (dynamic_cast<TipAbsentField const *>(c)) {
+    return getAbsentField();
+  } else if (dynamic_cast<TipRef const *>(c)) {
+    return getRef(args.front());
+  } else if (dynamic_cast<TipArray const *>(c)) {
+    return getArray(args.front());
+  } else if (auto r = dynamic_cast<TipRecord const *>(c)) {
+    return getRecord(std::move(args), r->getNames());
+  } else if (dynamic_cast<TipFunction const *>(c)) {
+    auto ret = args.back();
+    args.pop_back();
+    return getFunction(std::move(args), std::move(ret));
+  }
+
+  throw InternalError("unknown type constructor"); // LCOV_EXCL_LINE
+}
+
+std::size_t TipTypeFactory::size() {
+  std::lock_guard<std::mutex> guard(tableLock);
+  std::size_t live = 0;
+  for (auto &entry : table) {
+    if (!entry.second.expired()) {
+      live++;
+    }
+  }
+  return live;
+}
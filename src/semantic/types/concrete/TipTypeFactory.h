@@ -0,0 +1,71 @@
+#pragma once
+
+#include "TipAbsentField.h"
+#include "TipAlpha.h"
+#include "TipArray.h"
+#include "TipBool.h"
+#include "TipCons.h"
+#include "TipFunction.h"
+#include "TipInt.h"
+#include "TipMu.h"
+#include "TipRecord.h"
+#include "TipRef.h"
+#include "TipType.h"
+#include "TipVar.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*!
+ * \class TipTypeFactory
+ *
+ * \brief Hash-consing factory for TipTypes.
+ *
+ * Every type produced by the factory is interned: structurally equal types
+ * built through the factory share a single node.  Since the arguments of an
+ * interned constructor are themselves interned, equality checks on those types
+ * are resolved by the pointer comparison at the top of operator== and their
+ * hashes are computed once.
+ *
+ * The intern table only holds weak references, so types are reclaimed as soon
+ * as the last analysis referring to them is gone.  Interned types are shared
+ * and must never be mutated, e.g., through TipCons::setArguments.
+ */
+class TipTypeFactory {
+public:
+  static std::shared_ptr<TipInt> getInt();
+  static std::shared_ptr<TipBool> getBool();
+  static std::shared_ptr<TipAbsentField> getAbsentField();
+
+  static std::shared_ptr<TipVar> getVar(ASTNode *node);
+  static std::shared_ptr<TipAlpha> getAlpha(ASTNode *node);
+  static std::shared_ptr<TipAlpha> getAlpha(ASTNode *node,
+                                            std::string const &name);
+  static std::shared_ptr<TipAlpha>
+  getAlpha(ASTNode *node, ASTNode *context, std::string const &name);
+
+  static std::shared_ptr<TipRef> getRef(std::shared_ptr<TipType> of);
+  static std::shared_ptr<TipArray> getArray(std::shared_ptr<TipType> of);
+  static std::shared_ptr<TipFunction>
+  getFunction(std::vector<std::shared_ptr<TipType>> params,
+              std::shared_ptr<TipType> ret);
+  static std::shared_ptr<TipRecord>
+  getRecord(std::vector<std::shared_ptr<TipType>> inits,
+            std::vector<std::string> names);
+  static std::shared_ptr<TipMu> getMu(std::shared_ptr<TipVar> v,
+                                      std::shared_ptr<TipType> t);
+
+  /*! \brief Rebuild a type constructor with new arguments.
+   *
+   * Produces the interned type with the same constructor (and field names,
+   * for records) as c whose arguments are args.
+   * \throws InternalError if c is not a known subtype of TipCons.
+   */
+  static std::shared_ptr<TipCons>
+  getCons(TipCons const *c, std::vector<std::shared_ptr<TipType>> args);
+
+  /*! \brief Returns the number of live interned types.
+   */
+  static std::size_t size();
+};
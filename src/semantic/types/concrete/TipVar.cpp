@@ -4,10 +4,15 @@
 
 #include <iostream>
 #include <sstream>
+#include <typeinfo>
 
 TipVar::TipVar(ASTNode *node) : node(node){};
 
 bool TipVar::operator==(const TipType &other) const {
+  if (this == &other) {
+    return true;
+  }
+
   auto otherTipVar = dynamic_cast<TipVar const *>(&other);
   auto otherTipAlpha = dynamic_cast<TipAlpha const *>(&other);
   if (!otherTipVar || otherTipAlpha) {
@@ -21,6 +26,10 @@ bool TipVar::operator!=(const TipType &other) const {
   return !(*this == other);
 }
 
+std::size_t TipVar::hash() const {
+  return hashCombine(typeid(TipVar).hash_code(), std::hash<ASTNode *>()(node));
+}
+
 std::ostream &TipVar::print(std::ostream &out) const {
   out << "\u27E6" << *node << "@" << node->getLine() << ":" << node->getColumn()
       << "\u27E7";
@@ -17,6 +17,7 @@ public:
 
   bool operator==(const TipType &other) const override;
   bool operator!=(const TipType &other) const override;
+  std::size_t hash() const override;
 
   ASTNode *getNode() const { return node; }
 
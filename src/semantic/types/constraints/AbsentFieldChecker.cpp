@@ -1,7 +1,7 @@
 #include "AbsentFieldChecker.h"
 #include "SemanticError.h"
 #include "TipAbsentField.h"
-#include "TipVar.h"
+#include "TipTypeFactory.h"
 
 #include <sstream>
 
@@ -18,7 +18,7 @@ void AbsentFieldChecker::check(ASTProgram *p, Unifier *u) {
  */
 void AbsentFieldChecker::endVisit(ASTAccessExpr *element) {
   // Generate a new type variable for the access expression
-  auto typeVar = std::make_shared<TipVar>(element);
+  auto typeVar = TipTypeFactory::getVar(element);
 
   // Look up the inferred type for this variable in the type judgements
   auto inferredType = unifier->inferred(typeVar);
@@ -6,6 +6,13 @@ PolyTypeConstraintCollectVisitor::PolyTypeConstraintCollectVisitor(
     : PolyTypeConstraintVisitor(pTable, callGraph, u,
                                 std::move(buildConstraintHandler())) {}
 
+PolyTypeConstraintCollectVisitor::PolyTypeConstraintCollectVisitor(
+    SymbolTable *pTable, CallGraph *callGraph, std::shared_ptr<Unifier> u,
+    std::map<ASTDeclNode *, std::shared_ptr<TipType>> generics)
+    : PolyTypeConstraintVisitor(pTable, callGraph, u,
+                                std::move(buildConstraintHandler()),
+                                std::move(generics)) {}
+
 std::unique_ptr<ConstraintHandler>
 PolyTypeConstraintCollectVisitor::buildConstraintHandler() {
   return std::make_unique<ConstraintCollector>();
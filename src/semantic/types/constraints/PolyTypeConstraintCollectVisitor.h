@@ -6,6 +6,7 @@
 #include "SymbolTable.h"
 #include "TipType.h"
 #include "TypeConstraint.h"
+#include <map>
 #include <memory>
 #include <set>
 #include <stack>
@@ -21,6 +22,9 @@ public:
   explicit PolyTypeConstraintCollectVisitor(SymbolTable *pTable,
                                             CallGraph *callGraph,
                                             std::shared_ptr<Unifier> u);
+  PolyTypeConstraintCollectVisitor(
+      SymbolTable *pTable, CallGraph *callGraph, std::shared_ptr<Unifier> u,
+      std::map<ASTDeclNode *, std::shared_ptr<TipType>> generics);
   std::vector<TypeConstraint> &getCollectedConstraints();
 
 private:
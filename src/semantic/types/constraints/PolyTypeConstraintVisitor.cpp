@@ -1,13 +1,15 @@
 #include "PolyTypeConstraintVisitor.h"
 #include "FreshAlphaCopier.h"
+#include "TipTypeFactory.h"
 #include "TypeVars.h"
 #include "loguru.hpp"
 
 PolyTypeConstraintVisitor::PolyTypeConstraintVisitor(
     SymbolTable *st, CallGraph *cg, std::shared_ptr<Unifier> u,
-    std::unique_ptr<ConstraintHandler> handler)
+    std::unique_ptr<ConstraintHandler> handler,
+    std::map<ASTDeclNode *, std::shared_ptr<TipType>> generics)
     : TypeConstraintVisitor(st, std::move(handler)), callGraph(cg),
-      unifier(u){};
+      unifier(u), generics(std::move(generics)){};
 
 /*! \brief Polymorphic type constraints for function application.
  *
@@ -51,7 +53,10 @@ void PolyTypeConstraintVisitor::endVisit(ASTFunAppExpr *element) {
     auto isPoly = symbolTable->getPoly(fName);
 
     if (isPoly) {
-      auto genericType = unifier->inferred(astToVar(fDecl));
+      auto known = generics.find(fDecl);
+      auto genericType = (known != generics.end())
+                             ? known->second
+                             : unifier->inferred(astToVar(fDecl));
       auto copyType = FreshAlphaCopier::copy(genericType.get(), element);
 
       auto instantiatedType = std::dynamic_pointer_cast<TipFunction>(copyType);
@@ -64,12 +69,12 @@ void PolyTypeConstraintVisitor::endVisit(ASTFunAppExpr *element) {
       // Polymorphic function application
       constraintHandler->handle(
           instantiatedType,
-          std::make_shared<TipFunction>(actuals, astToVar(element)));
+          TipTypeFactory::getFunction(actuals, astToVar(element)));
     } else {
       // Monomorphic function application
       constraintHandler->handle(
           astToVar(element->getFunction()),
-          std::make_shared<TipFunction>(actuals, astToVar(element)));
+          TipTypeFactory::getFunction(actuals, astToVar(element)));
     }
   }
 }
@@ -3,6 +3,7 @@
 #include "CallGraph.h"
 #include "TypeConstraintVisitor.h"
 #include "Unifier.h"
+#include <map>
 
 /*! \class PolyTypeConstraintVisitor
  *
@@ -10,16 +11,22 @@
  *  This visitor is called for a function with the requirement that all
  *  called functions already have a generalized type computed in the given
  *  function polymorphic type inference map.
+ *
+ *  Generic types are normally looked up in the given unifier.  Those of
+ *  callees whose constraints were solved by a different unifier can be
+ *  provided up front in the generics map instead.
  */
 class PolyTypeConstraintVisitor : public TypeConstraintVisitor {
 public:
   explicit PolyTypeConstraintVisitor(
       SymbolTable *pTable, CallGraph *callGraph, std::shared_ptr<Unifier> u,
-      std::unique_ptr<ConstraintHandler> handler);
+      std::unique_ptr<ConstraintHandler> handler,
+      std::map<ASTDeclNode *, std::shared_ptr<TipType>> generics = {});
 
   virtual void endVisit(ASTFunAppExpr *element) override;
 
 private:
   CallGraph *callGraph;
   std::shared_ptr<Unifier> unifier;
+  std::map<ASTDeclNode *, std::shared_ptr<TipType>> generics;
 };
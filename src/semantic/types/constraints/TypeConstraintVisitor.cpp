@@ -7,6 +7,7 @@
 #include "TipInt.h"
 #include "TipRecord.h"
 #include "TipRef.h"
+#include "TipTypeFactory.h"
 #include "TipVar.h"
 
 TypeConstraintVisitor::TypeConstraintVisitor(
@@ -25,13 +26,13 @@ std::shared_ptr<TipType> TypeConstraintVisitor::astToVar(ASTNode *n) {
   if (auto ve = dynamic_cast<ASTVariableExpr *>(n)) {
     ASTDeclNode *canonical;
     if ((canonical = symbolTable->getLocal(ve->getName(), scope.top()))) {
-      return std::make_shared<TipVar>(canonical);
+      return TipTypeFactory::getVar(canonical);
     } else if ((canonical = symbolTable->getFunction(ve->getName()))) {
-      return std::make_shared<TipVar>(canonical);
+      return TipTypeFactory::getVar(canonical);
     }
   } // LCOV_EXCL_LINE
 
-  return std::make_shared<TipVar>(n);
+  return TipTypeFactory::getVar(n);
 }
 
 bool TypeConstraintVisitor::visit(ASTFunction *element) {
@@ -54,17 +55,17 @@ void TypeConstraintVisitor::endVisit(ASTFunction *element) {
     for (auto &f : element->getFormals()) {
       formals.push_back(astToVar(f));
       // all formals are int
-      constraintHandler->handle(astToVar(f), std::make_shared<TipInt>());
+      constraintHandler->handle(astToVar(f), TipTypeFactory::getInt());
     }
 
     // Return is the last statement and must be int
     auto ret = dynamic_cast<ASTReturnStmt *>(element->getStmts().back());
     constraintHandler->handle(astToVar(ret->getArg()),
-                              std::make_shared<TipInt>());
+                              TipTypeFactory::getInt());
 
     constraintHandler->handle(
         astToVar(element->getDecl()),
-        std::make_shared<TipFunction>(formals, astToVar(ret->getArg())));
+        TipTypeFactory::getFunction(formals, astToVar(ret->getArg())));
   } else {
     std::vector<std::shared_ptr<TipType>> formals;
     for (auto &f : element->getFormals()) {
@@ -76,7 +77,7 @@ void TypeConstraintVisitor::endVisit(ASTFunction *element) {
 
     constraintHandler->handle(
         astToVar(element->getDecl()),
-        std::make_shared<TipFunction>(formals, astToVar(ret->getArg())));
+        TipTypeFactory::getFunction(formals, astToVar(ret->getArg())));
   }
 }
 
@@ -86,7 +87,7 @@ void TypeConstraintVisitor::endVisit(ASTFunction *element) {
  *   [[I]] = int
  */
 void TypeConstraintVisitor::endVisit(ASTNumberExpr *element) {
-  constraintHandler->handle(astToVar(element), std::make_shared<TipInt>());
+  constraintHandler->handle(astToVar(element), TipTypeFactory::getInt());
 }
 
 
@@ -96,7 +97,7 @@ void TypeConstraintVisitor::endVisit(ASTNumberExpr *element) {
  *   [[B]] = bool
  */
 void TypeConstraintVisitor::endVisit(ASTBoolExpr *element) {
-  constraintHandler->handle(astToVar(element), std::make_shared<TipBool>());
+  constraintHandler->handle(astToVar(element), TipTypeFactory::getBool());
 }
 
 /*! \brief Type constraints for binary operator.
@@ -113,8 +114,8 @@ void TypeConstraintVisitor::endVisit(ASTBoolExpr *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTBinaryExpr *element) {
   auto op = element->getOp();
-  auto intType = std::make_shared<TipInt>();
-  auto boolType = std::make_shared<TipBool>();
+  auto intType = TipTypeFactory::getInt();
+  auto boolType = TipTypeFactory::getBool();
 
   if (op == "+" || op == "-" || op == "*" || op == "/" || op == "%") {
     // result type is integer
@@ -144,7 +145,7 @@ void TypeConstraintVisitor::endVisit(ASTBinaryExpr *element) {
  *  [[input]] = int
  */
 void TypeConstraintVisitor::endVisit(ASTInputExpr *element) {
-  constraintHandler->handle(astToVar(element), std::make_shared<TipInt>());
+  constraintHandler->handle(astToVar(element), TipTypeFactory::getInt());
 }
 
 /*! \brief Type constraints for function application.
@@ -159,7 +160,7 @@ void TypeConstraintVisitor::endVisit(ASTFunAppExpr *element) {
   }
   constraintHandler->handle(
       astToVar(element->getFunction()),
-      std::make_shared<TipFunction>(actuals, astToVar(element)));
+      TipTypeFactory::getFunction(actuals, astToVar(element)));
 }
 
 /*! \brief Type constraints for heap allocation.
@@ -170,7 +171,7 @@ void TypeConstraintVisitor::endVisit(ASTFunAppExpr *element) {
 void TypeConstraintVisitor::endVisit(ASTAllocExpr *element) {
   constraintHandler->handle(
       astToVar(element),
-      std::make_shared<TipRef>(astToVar(element->getInitializer())));
+      TipTypeFactory::getRef(astToVar(element->getInitializer())));
 }
 
 /*! \brief Type constraints for address of.
@@ -180,7 +181,7 @@ void TypeConstraintVisitor::endVisit(ASTAllocExpr *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTRefExpr *element) {
   constraintHandler->handle(
-      astToVar(element), std::make_shared<TipRef>(astToVar(element->getVar())));
+      astToVar(element), TipTypeFactory::getRef(astToVar(element->getVar())));
 }
 
 /*! \brief Type constraints for pointer dereference.
@@ -190,7 +191,7 @@ void TypeConstraintVisitor::endVisit(ASTRefExpr *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTDeRefExpr *element) {
   constraintHandler->handle(astToVar(element->getPtr()),
-                            std::make_shared<TipRef>(astToVar(element)));
+                            TipTypeFactory::getRef(astToVar(element)));
 }
 
 /*! \brief Type constraints for null literal.
@@ -201,7 +202,7 @@ void TypeConstraintVisitor::endVisit(ASTDeRefExpr *element) {
 void TypeConstraintVisitor::endVisit(ASTNullExpr *element) {
   constraintHandler->handle(
       astToVar(element),
-      std::make_shared<TipRef>(std::make_shared<TipAlpha>(element)));
+      TipTypeFactory::getRef(TipTypeFactory::getAlpha(element)));
 }
 
 /*! \brief Type rules for assignments.
@@ -221,7 +222,7 @@ void TypeConstraintVisitor::endVisit(ASTAssignStmt *element) {
   if (auto lptr = dynamic_cast<ASTDeRefExpr *>(element->getLHS())) {
     constraintHandler->handle(
         astToVar(lptr->getPtr()),
-        std::make_shared<TipRef>(astToVar(element->getRHS())));
+        TipTypeFactory::getRef(astToVar(element->getRHS())));
   } else {
     constraintHandler->handle(astToVar(element->getLHS()),
                               astToVar(element->getRHS()));
@@ -235,7 +236,7 @@ void TypeConstraintVisitor::endVisit(ASTAssignStmt *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTWhileStmt *element) {
   constraintHandler->handle(astToVar(element->getCondition()),
-                            std::make_shared<TipBool>());
+                            TipTypeFactory::getBool());
 }
 
 /*! \brief Type constraints for if statement.
@@ -245,7 +246,7 @@ void TypeConstraintVisitor::endVisit(ASTWhileStmt *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTIfStmt *element) {
   constraintHandler->handle(astToVar(element->getCondition()),
-                            std::make_shared<TipBool>());
+                            TipTypeFactory::getBool());
 }
 
 /*! \brief Type constraints for output statement.
@@ -255,7 +256,7 @@ void TypeConstraintVisitor::endVisit(ASTIfStmt *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTOutputStmt *element) {
   constraintHandler->handle(astToVar(element->getArg()),
-                            std::make_shared<TipInt>());
+                            TipTypeFactory::getInt());
 }
 
 /*! \brief Type constraints for record expression.
@@ -280,10 +281,10 @@ void TypeConstraintVisitor::endVisit(ASTRecordExpr *element) {
     if (matched)
       continue;
 
-    fieldTypes.push_back(std::make_shared<TipAbsentField>());
+    fieldTypes.push_back(TipTypeFactory::getAbsentField());
   }
   constraintHandler->handle(astToVar(element),
-                            std::make_shared<TipRecord>(fieldTypes, allFields));
+                            TipTypeFactory::getRecord(fieldTypes, allFields));
 }
 
 
@@ -301,11 +302,11 @@ void TypeConstraintVisitor::endVisit(ASTAccessExpr *element) {
     if (f == element->getField()) {
       fieldTypes.push_back(astToVar(element));
     } else {
-      fieldTypes.push_back(std::make_shared<TipAlpha>(element, f));
+      fieldTypes.push_back(TipTypeFactory::getAlpha(element, f));
     }
   }
   constraintHandler->handle(astToVar(element->getRecord()),
-                            std::make_shared<TipRecord>(fieldTypes, allFields));
+                            TipTypeFactory::getRecord(fieldTypes, allFields));
 }
 
 /*! \brief Type constraints for error statement.
@@ -315,7 +316,7 @@ void TypeConstraintVisitor::endVisit(ASTAccessExpr *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTErrorStmt *element) {
   constraintHandler->handle(astToVar(element->getArg()),
-                            std::make_shared<TipInt>());
+                            TipTypeFactory::getInt());
 }
 
 /*! \brief Type constraints for update statements.
@@ -325,7 +326,7 @@ void TypeConstraintVisitor::endVisit(ASTErrorStmt *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTUpdateStmt *element) {
   constraintHandler->handle(astToVar(element->getArg()),
-                            std::make_shared<TipInt>());
+                            TipTypeFactory::getInt());
 }
 
 /*! \brief Type constraints for ternary expressions.
@@ -336,7 +337,7 @@ void TypeConstraintVisitor::endVisit(ASTUpdateStmt *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTTernaryExpr *element) {
   constraintHandler->handle(astToVar(element->getCondition()),
-                            std::make_shared<TipBool>());
+                            TipTypeFactory::getBool());
   constraintHandler->handle(astToVar(element->getThen()),
                             astToVar(element->getElse()));
   constraintHandler->handle(astToVar(element),
@@ -365,7 +366,7 @@ void TypeConstraintVisitor::endVisit(ASTArrayExpr *element) {
 
   if (!elementTypes.empty()) {
     constraintHandler->handle(astToVar(element),
-                              std::make_shared<TipArray>(elementTypes.front()));
+                              TipTypeFactory::getArray(elementTypes.front()));
   }
 }
 
@@ -378,9 +379,9 @@ void TypeConstraintVisitor::endVisit(ASTArrayExpr *element) {
  */  
 void TypeConstraintVisitor::endVisit(ASTIndexingExpr *element) {
   constraintHandler->handle(astToVar(element->getIdx()),
-                            std::make_shared<TipInt>());
+                            TipTypeFactory::getInt());
   constraintHandler->handle(astToVar(element->getArr()),
-                          std::make_shared<TipArray>(astToVar(element)));
+                          TipTypeFactory::getArray(astToVar(element)));
 
 
 }
@@ -392,9 +393,9 @@ void TypeConstraintVisitor::endVisit(ASTIndexingExpr *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTArrayLenExpr *element) {
   constraintHandler->handle(astToVar(element),
-                            std::make_shared<TipInt>());
+                            TipTypeFactory::getInt());
   constraintHandler->handle(astToVar(element->getPtr()),
-                            std::make_shared<TipArray>(std::make_shared<TipAlpha>(element->getPtr())));
+                            TipTypeFactory::getArray(TipTypeFactory::getAlpha(element->getPtr())));
 }
 
 /*! \brief Type constraints for array of constructor.
@@ -405,9 +406,9 @@ void TypeConstraintVisitor::endVisit(ASTArrayLenExpr *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTArrayOfExpr *element) {
   constraintHandler->handle(astToVar(&*element->getE1()),
-                            std::make_shared<TipInt>());
+                            TipTypeFactory::getInt());
   constraintHandler->handle(astToVar(element),
-                            std::make_shared<TipArray>(astToVar(&*element->getE2())));
+                            TipTypeFactory::getArray(astToVar(&*element->getE2())));
 }
 
 
@@ -419,7 +420,7 @@ void TypeConstraintVisitor::endVisit(ASTArrayOfExpr *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTNotExpr *element) {
   constraintHandler->handle(astToVar(element->getArg()),
-                            std::make_shared<TipBool>());
+                            TipTypeFactory::getBool());
   
 }
 
@@ -430,7 +431,7 @@ void TypeConstraintVisitor::endVisit(ASTNotExpr *element) {
  */
 void TypeConstraintVisitor::endVisit(ASTNegExpr *element) {
   constraintHandler->handle(astToVar(element->getArg()),
-                            std::make_shared<TipInt>());
+                            TipTypeFactory::getInt());
   
 }
 
@@ -446,17 +447,17 @@ void TypeConstraintVisitor::endVisit(ASTNegExpr *element) {
 void TypeConstraintVisitor::endVisit(ASTForStmt *element) {
   if(element->getIterator()) {
     constraintHandler->handle(astToVar(element->getIterator()),
-                              std::make_shared<TipArray>(astToVar(element->getItem())));
+                              TipTypeFactory::getArray(astToVar(element->getItem())));
   } else {
     constraintHandler->handle(astToVar(element->getItem()),
-                            std::make_shared<TipInt>());
+                            TipTypeFactory::getInt());
     constraintHandler->handle(astToVar(element->getRangeStart()),
-                        std::make_shared<TipInt>());
+                        TipTypeFactory::getInt());
     constraintHandler->handle(astToVar(element->getRangeEnd()),
-                    std::make_shared<TipInt>());
+                    TipTypeFactory::getInt());
     if(element->getIncrement()) {
       constraintHandler->handle(astToVar(element->getIncrement()),
-                std::make_shared<TipInt>());
+                TipTypeFactory::getInt());
     }
   }
 }
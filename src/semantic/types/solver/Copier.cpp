@@ -1,4 +1,5 @@
 #include "Copier.h"
+#include "TipTypeFactory.h"
 
 /*
  * The Copier inherits all of the methods above from Substituter, but
@@ -11,10 +12,10 @@ std::shared_ptr<TipType> Copier::copy(std::shared_ptr<TipType> t) {
 }
 
 void Copier::endVisit(TipVar *element) {
-  visitedTypes.push_back(std::make_shared<TipVar>(element->getNode()));
+  visitedTypes.push_back(TipTypeFactory::getVar(element->getNode()));
 }
 
 void Copier::endVisit(TipAlpha *element) {
   visitedTypes.push_back(
-      std::make_shared<TipAlpha>(element->getNode(), element->getName()));
+      TipTypeFactory::getAlpha(element->getNode(), element->getName()));
 }
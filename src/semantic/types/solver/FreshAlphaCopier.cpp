@@ -1,4 +1,5 @@
 #include "FreshAlphaCopier.h"
+#include "TipTypeFactory.h"
 
 /*
  * The Copier inherits all of the methods above from Substituter, but
@@ -12,6 +13,6 @@ std::shared_ptr<TipType> FreshAlphaCopier::copy(TipType *t, ASTNode *c) {
 }
 
 void FreshAlphaCopier::endVisit(TipAlpha *element) {
-  visitedTypes.push_back(std::make_shared<TipAlpha>(element->getNode(), context,
+  visitedTypes.push_back(TipTypeFactory::getAlpha(element->getNode(), context,
                                                     element->getName()));
 }
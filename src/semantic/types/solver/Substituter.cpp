@@ -1,5 +1,6 @@
 #include "Substituter.h"
 #include "Copier.h"
+#include "TipTypeFactory.h"
 
 #include <algorithm>
 #include <iterator>
@@ -28,12 +29,12 @@ void Substituter::endVisit(TipFunction *element) {
 
   std::shared_ptr<TipType> retType = argTypes.back();
   argTypes.pop_back();
-  visitedTypes.push_back(std::make_shared<TipFunction>(argTypes, retType));
+  visitedTypes.push_back(TipTypeFactory::getFunction(argTypes, retType));
 }
 
 void Substituter::endVisit(TipInt *element) {
   // Zero element in visitedTypes (a special case of Cons)
-  visitedTypes.push_back(std::make_shared<TipInt>());
+  visitedTypes.push_back(TipTypeFactory::getInt());
 }
 
 void Substituter::endVisit(TipMu *element) {
@@ -45,7 +46,7 @@ void Substituter::endVisit(TipMu *element) {
   auto vType = std::dynamic_pointer_cast<TipVar>(visitedTypes.back());
   visitedTypes.pop_back();
 
-  visitedTypes.push_back(std::make_shared<TipMu>(vType, tType));
+  visitedTypes.push_back(TipTypeFactory::getMu(vType, tType));
 }
 
 void Substituter::endVisit(TipRecord *element) {
@@ -60,19 +61,19 @@ void Substituter::endVisit(TipRecord *element) {
   std::reverse(initTypes.begin(), initTypes.end());
 
   visitedTypes.push_back(
-      std::make_shared<TipRecord>(initTypes, element->getNames()));
+      TipTypeFactory::getRecord(initTypes, element->getNames()));
 }
 
 void Substituter::endVisit(TipAbsentField *element) {
   // Zero element in visitedTypes (a special case of Cons)
-  visitedTypes.push_back(std::make_shared<TipAbsentField>());
+  visitedTypes.push_back(TipTypeFactory::getAbsentField());
 }
 
 void Substituter::endVisit(TipRef *element) {
   // One element in visitedTypes (a special case of Cons)
   auto pointedToType = visitedTypes.back();
   visitedTypes.pop_back();
-  visitedTypes.push_back(std::make_shared<TipRef>(pointedToType));
+  visitedTypes.push_back(TipTypeFactory::getRef(pointedToType));
 }
 
 /*! \brief Substitute if variable is the target.
@@ -82,7 +83,7 @@ void Substituter::endVisit(TipVar *element) {
     auto copy = Copier::copy(substitution);
     visitedTypes.push_back(copy);
   } else {
-    visitedTypes.push_back(std::make_shared<TipVar>(element->getNode()));
+    visitedTypes.push_back(TipTypeFactory::getVar(element->getNode()));
   }
 }
 
@@ -92,7 +93,7 @@ void Substituter::endVisit(TipAlpha *element) {
     visitedTypes.push_back(copy);
   } else {
     visitedTypes.push_back(
-        std::make_shared<TipAlpha>(element->getNode(), element->getName()));
+        TipTypeFactory::getAlpha(element->getNode(), element->getName()));
   }
 }
 
@@ -100,10 +101,10 @@ void Substituter::endVisit(TipArray *element) {
   // One element in visitedTypes (a special case of Cons)
   auto pointedToType = visitedTypes.back();
   visitedTypes.pop_back();
-  visitedTypes.push_back(std::make_shared<TipArray>(pointedToType));
+  visitedTypes.push_back(TipTypeFactory::getArray(pointedToType));
 }
 
 void Substituter::endVisit(TipBool *element) {
   // Zero element in visitedTypes (a special case of Cons)
-  visitedTypes.push_back(std::make_shared<TipBool>());
+  visitedTypes.push_back(TipTypeFactory::getBool());
 }
\ No newline at end of file
@@ -1,14 +1,15 @@
 #include "Unifier.h"
 
-#include "Copier.h"
 #include "InternalError.h"
 #include "Substituter.h"
 #include "TipAlpha.h"
 #include "TipCons.h"
 #include "TipMu.h"
+#include "TipTypeFactory.h"
 #include "TypeVars.h"
 #include "UnificationError.h"
 #include "loguru.hpp"
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <utility>
@@ -94,9 +95,14 @@ void Unifier::add(std::vector<TypeConstraint> constrs) {
 }
 
 void Unifier::solve() {
+  auto start = std::chrono::steady_clock::now();
   for (TypeConstraint &constraint : constraints) {
     unify(constraint.lhs, constraint.rhs);
   }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  LOG_S(1) << "Unified " << constraints.size() << " type constraints in "
+           << elapsed.count() << " s";
 }
 
 /*! \fn unify
@@ -193,7 +199,7 @@ Unifier::close(std::shared_ptr<TipType> type,
 
       // If the variable is an alpha, then reuse it else create a new alpha with
       // the node.
-      auto newV = (isAlpha(v)) ? v : std::make_shared<TipAlpha>(v->getNode());
+      auto newV = (isAlpha(v)) ? v : TipTypeFactory::getAlpha(v->getNode());
 
       LOG_S(3) << "Close var " << *v << " using new var " << *newV
                << " and closed var " << *closedV;
@@ -208,7 +214,7 @@ Unifier::close(std::shared_ptr<TipType> type,
         LOG_S(3) << "Close var " << *v << " making mu with " << *newV
                  << " and subst closed " << *substClosedV;
 
-        auto mu = std::make_shared<TipMu>(newV, substClosedV);
+        auto mu = TipTypeFactory::getMu(newV, substClosedV);
 
         LOG_S(3) << "Close making " << *mu << " to end var " << *v;
         return mu;
@@ -221,7 +227,7 @@ Unifier::close(std::shared_ptr<TipType> type,
     } else {
       // Unconstrained type variable - should we start with fresh names to make
       // output cleaner?
-      auto alpha = std::make_shared<TipAlpha>(v->getNode());
+      auto alpha = TipTypeFactory::getAlpha(v->getNode());
 
       LOG_S(3) << "Close making " << *alpha << " to end var " << *v;
       return alpha;
@@ -229,7 +235,6 @@ Unifier::close(std::shared_ptr<TipType> type,
 
   } else if (isCons(type)) {
     auto c = std::dynamic_pointer_cast<TipCons>(type);
-    auto copy = Copier::copy(c);
 
     LOG_S(3) << "Close starting cons " << *c << " with visited "
              << print(visited);
@@ -254,14 +259,9 @@ Unifier::close(std::shared_ptr<TipType> type,
     }
 
     // Perform the argument substitutions, if any, to form a new type, then add
-    // it and return it.
-    auto consCopy = std::dynamic_pointer_cast<TipCons>(copy); // fails
-
-    // TODO: Fix consCopy is a nullptr
-    if(consCopy == nullptr) {
-      throw InternalError("consCopy is a nullptr");
-    }
-    consCopy->setArguments(current);
+    // it and return it.  Interned types are shared, so the new type is built
+    // by the factory rather than by updating the arguments of a copy.
+    auto consCopy = TipTypeFactory::getCons(c.get(), current);
     std::vector<std::shared_ptr<TipType>> newTypes{consCopy};
     unionFind->add(newTypes);
 
@@ -276,7 +276,7 @@ Unifier::close(std::shared_ptr<TipType> type,
              << print(visited);
 
     auto closedMu =
-        std::make_shared<TipMu>(m->getV(), close(m->getT(), visited));
+        TipTypeFactory::getMu(m->getV(), close(m->getT(), visited));
 
     LOG_S(3) << "Close making " << *closedMu << " to end mu " << *m;
 
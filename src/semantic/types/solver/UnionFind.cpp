@@ -1,54 +1,32 @@
 #include "UnionFind.h"
-#include "Copier.h"
 
 #include "loguru.hpp"
-#include <algorithm>
+#include <cassert>
 #include <set>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 
-namespace { // Anonymous namespace for local helpers
-bool verbose = false;
-
-bool equalType(std::shared_ptr<TipType> t1, std::shared_ptr<TipType> t2) {
-  return *(t1.get()) == *(t2.get());
-}
-} // namespace
-
 // Check Union-Find data structure invariants
-void UnionFind::invariant() {
-    // No two edges in the Union-Find structure should the same originating
-    // TipType
-    for(auto outerIter = edges.begin(); outerIter != edges.end(); outerIter++) {
-        const auto& edge1 = *outerIter;
-        auto innerIter = outerIter;
-        innerIter++;
-        for(; innerIter != edges.end(); innerIter++) {
-            const auto& edge2 = *innerIter;
-            if(equalType(edge1.first, edge2.first)) {
-                LOG_S(3) << "UnionFind invariant violated found pair of edges: "
-                         << *edge1.first << "(" << edge1.first.get() << ") => "
-                         << *edge1.second << " and " << *edge2.first << "("
-                         << edge2.first.get() << ") => " << *edge2.second;
-                assert(!equalType(edge1.first, edge2.first));
-            }
-        }
-    }
+void UnionFind::invariant() const {
+  // Every interned term has exactly one index and one slot in the forest.
+  // Distinctness of the interned terms is guaranteed by the structural index.
+  assert(index.size() == terms.size());
+  assert(parent.size() == terms.size());
+  assert(rank.size() == terms.size());
+  assert(representative.size() == terms.size());
 }
 
-std::shared_ptr<TipType> UnionFind::lookup(std::shared_ptr<TipType> t) {
-  for (auto const &edge : edges) {
-    if (equalType(t, edge.first)) {
-      return edge.second;
-    }
+int UnionFind::lookup(std::shared_ptr<TipType> t) const {
+  auto it = index.find(t);
+  if (it == index.end()) {
+    return -1;
   }
-  return nullptr;
+  return it->second;
 }
 
 UnionFind::UnionFind(std::vector<std::shared_ptr<TipType>> seed) {
-  for (auto &term : seed) {
-    smart_insert(term);
-  }
-  invariant();
+  add(std::move(seed));
 }
 
 void UnionFind::add(std::vector<std::shared_ptr<TipType>> seed) {
@@ -64,10 +42,15 @@ std::ostream &operator<<(std::ostream &os, const UnionFind &obj) {
 
 std::ostream &UnionFind::print(std::ostream &out) const {
   std::set<std::string> edgeSet;
-  for (auto edge : edges) {
+  for (int i = 0; i < terms.size(); i++) {
+    // Walk without compressing, printing must not mutate the forest
+    int r = i;
+    while (parent[r] != r) {
+      r = parent[r];
+    }
     std::stringstream edgeStr;
-    edgeStr << "  " << *edge.first << "(" << edge.first.get() << ")"
-            << " => " << *edge.second;
+    edgeStr << "  " << *terms[i] << "(" << terms[i].get() << ")"
+            << " => " << *terms[representative[r]];
     edgeSet.insert(edgeStr.str());
   }
   out << "UnionFind edges {\n";
@@ -78,43 +61,62 @@ std::ostream &UnionFind::print(std::ostream &out) const {
   return out;
 }
 
-std::shared_ptr<TipType> UnionFind::find(std::shared_ptr<TipType> t) {
-  LOG_S(3) << "UnionFind looking for representive of " << *t;
-
-  t = smart_insert(t);
+int UnionFind::root(int i) {
+  int r = i;
+  while (parent[r] != r) {
+    r = parent[r];
+  }
 
-  auto parent = t;
-  while (!equalType(get_parent(parent), parent)) {
-    parent = get_parent(parent);
+  // Path compression
+  while (parent[i] != r) {
+    int next = parent[i];
+    parent[i] = r;
+    i = next;
   }
 
-  LOG_S(3) << "UnionFind found representative " << *parent;
+  return r;
+}
+
+std::shared_ptr<TipType> UnionFind::find(std::shared_ptr<TipType> t) {
+  LOG_S(3) << "UnionFind looking for representive of " << *t;
 
-  invariant();
+  auto rep = terms[representative[root(smart_insert(t))]];
+
+  LOG_S(3) << "UnionFind found representative " << *rep;
 
-  return parent;
+  return rep;
 }
 
+/*! \fn quick_union
+ *
+ * Merges the classes of the two terms.  The representative of t2's class
+ * becomes the representative of the merged class; the unifier relies on this
+ * to keep proper types as the canonical representatives.
+ */
 void UnionFind::quick_union(std::shared_ptr<TipType> t1,
                             std::shared_ptr<TipType> t2) {
-  t1 = smart_insert(t1);
-  t2 = smart_insert(t2);
-
-  auto t1_root = find(t1);
-  auto t2_root = find(t2);
-
-  // semantics-based insert
-  for (auto const &edge : edges) {
-    // THINK
-    if (equalType(t1_root, edge.first)) {
-      LOG_S(3) << "UnionFind replacing " << *edge.first << " => "
-               << *edge.second << " with " << *t1_root << " => " << *t2_root;
-      edges.erase(edge.first);
-      edges.insert(
-          std::pair<std::shared_ptr<TipType>, std::shared_ptr<TipType>>(
-              t1_root, t2_root));
-      break;
-    }
+  auto r1 = root(smart_insert(t1));
+  auto r2 = root(smart_insert(t2));
+
+  if (r1 == r2) {
+    return;
+  }
+
+  auto rep = representative[r2];
+  auto &t1_root = terms[representative[r1]];
+
+  LOG_S(3) << "UnionFind replacing " << *t1_root << " => " << *t1_root
+           << " with " << *t1_root << " => " << *terms[rep];
+
+  // Union by rank
+  if (rank[r1] < rank[r2]) {
+    parent[r1] = r2;
+  } else if (rank[r1] > rank[r2]) {
+    parent[r2] = r1;
+    representative[r1] = rep;
+  } else {
+    parent[r1] = r2;
+    rank[r2]++;
   }
 
   invariant();
@@ -122,45 +124,33 @@ void UnionFind::quick_union(std::shared_ptr<TipType> t1,
 
 bool UnionFind::connected(std::shared_ptr<TipType> t1,
                           std::shared_ptr<TipType> t2) {
-  return *find(t1) == *find(t2);
+  return root(smart_insert(t1)) == root(smart_insert(t2));
 } // LCOV_EXCL_LINE
 
-/*! \fn get_parent
- *
- * Unification ensures that the forest that includes all relevant type nodes.
- * A tree within the forest is traversed by directed edges to the parent.
- * During closure of terms, new type nodes may be generated by substitution.
- * When they are encountered they are added to the forest.
- */
-std::shared_ptr<TipType> UnionFind::get_parent(std::shared_ptr<TipType> t) {
-  auto parent = lookup(t);
-
-  if (parent != nullptr)
-    return parent;
-
-  auto inserted = smart_insert(t);
-
-  invariant();
-
-  return inserted;
-}
-
 /**
  * Inserts should be based on the dereferenced value.
+ *
+ * During closure of terms, new type nodes may be generated by substitution.
+ * When they are encountered they are added to the forest as singletons.
  */
-std::shared_ptr<TipType> UnionFind::smart_insert(std::shared_ptr<TipType> t) {
+int UnionFind::smart_insert(std::shared_ptr<TipType> t) {
   if (t == nullptr) {
     throw std::invalid_argument("Refusing to insert a nullptr into the map.");
   }
 
-  if (lookup(t) != nullptr)
-    return lookup(t);
+  auto i = lookup(t);
+  if (i != -1) {
+    return i;
+  }
 
   LOG_S(3) << "UnionFind adding " << *t << " to graph";
-  edges.insert(
-      std::pair<std::shared_ptr<TipType>, std::shared_ptr<TipType>>(t, t));
 
-  invariant();
+  i = terms.size();
+  terms.push_back(t);
+  index.emplace(t, i);
+  parent.push_back(i);
+  rank.push_back(0);
+  representative.push_back(i);
 
-  return t;
+  return i;
 }
@@ -2,7 +2,7 @@
 
 #include <TipType.h>
 #include <iostream>
-#include <map>
+#include <unordered_map>
 #include <vector>
 
 /*!
@@ -10,6 +10,14 @@
  *
  * \brief Specialized implementation of a union-find data structure tailored to
  * work with TipTypes wrapped in shared pointers.
+ *
+ * Terms are interned by structure: the first term inserted for a given
+ * structure is assigned an integer index, and every structurally equal term
+ * maps to that index through a hashed lookup.  The forest itself is kept over
+ * the indices and uses path compression and union by rank.  Since union by
+ * rank may pick either root as the tree root, each root additionally records
+ * the term that represents its class, so that quick_union(t1, t2) always makes
+ * the representative of t2 the representative of the merged class.
  */
 class UnionFind {
 public:
@@ -28,18 +36,43 @@ public:
   friend std::ostream &operator<<(std::ostream &os, const UnionFind &obj);
 
 private:
-  // A mapping from terms to parents.
-  std::map<std::shared_ptr<TipType>, std::shared_ptr<TipType>> edges;
+  struct StructuralHash {
+    std::size_t operator()(const std::shared_ptr<TipType> &t) const {
+      return t->hash();
+    }
+  };
+
+  struct StructuralEqual {
+    bool operator()(const std::shared_ptr<TipType> &t1,
+                    const std::shared_ptr<TipType> &t2) const {
+      return *t1 == *t2;
+    }
+  };
+
+  // Interned terms, indexed by their position in the forest.
+  std::vector<std::shared_ptr<TipType>> terms;
+
+  // A mapping from terms to their index, based on structural equality.
+  std::unordered_map<std::shared_ptr<TipType>, int, StructuralHash,
+                     StructuralEqual>
+      index;
+
+  // The forest: parent index, rank and (for roots) the representative term.
+  std::vector<int> parent;
+  std::vector<int> rank;
+  std::vector<int> representative;
 
-  std::shared_ptr<TipType> lookup(std::shared_ptr<TipType> t);
+  // Returns the index of the term, or -1 if it has not been inserted.
+  int lookup(std::shared_ptr<TipType> t) const;
 
-  std::shared_ptr<TipType> get_parent(std::shared_ptr<TipType> t);
+  // Returns the root index of the tree holding i, compressing the path to it.
+  int root(int i);
 
-  // Returns interred equivalent value or creates new interred value
-  std::shared_ptr<TipType> smart_insert(std::shared_ptr<TipType> t);
+  // Returns index of interred equivalent value or creates new interred value
+  int smart_insert(std::shared_ptr<TipType> t);
 
   // Assert datastructure invariants
-  void invariant();
+  void invariant() const;
 
   std::ostream &print(std::ostream &out) const;
 };
@@ -1,13 +1,19 @@
+#include "BytecodeError.h"
+#include "BytecodeGenerator.h"
 #include "CodeGenerator.h"
 #include "FrontEnd.h"
 #include "InternalError.h"
+#include "Interpreter.h"
+#include "JIT.h"
 #include "Optimizer.h"
 #include "ParseError.h"
 #include "SemanticAnalysis.h"
 #include "SemanticError.h"
+#include "VM.h"
 #include "loguru.hpp"
 #include "llvm/Support/CommandLine.h"
 
+#include <cstring>
 #include <fstream>
 
 using namespace llvm;
@@ -24,8 +30,44 @@ static cl::opt<bool>
 static cl::opt<bool> polyinf("pi",
                              cl::desc("perform polymorphic type inference"),
                              cl::cat(TIPcat));
+static cl::opt<int>
+    jobs("j", cl::value_desc("threads"), cl::init(1),
+         cl::desc("number of threads used by polymorphic type inference"),
+         cl::cat(TIPcat));
+static cl::opt<bool>
+    typedcg("typed",
+            cl::desc("generate code that represents values by their inferred "
+                     "types"),
+            cl::cat(TIPcat));
+static cl::opt<bool>
+    directcalls("dc",
+                cl::desc("call functions directly when the possible callees "
+                         "are known"),
+                cl::cat(TIPcat));
+static cl::opt<bool>
+    compactrecords("cr",
+                   cl::desc("give each record shape a compact layout"),
+                   cl::cat(TIPcat));
+static cl::opt<bool>
+    boundschecks("bce",
+                 cl::desc("eliminate array bounds checks that are provably "
+                          "unnecessary"),
+                 cl::cat(TIPcat));
+static cl::opt<bool>
+    stackalloc("sa",
+               cl::desc("allocate values that do not escape their function "
+                        "in its frame"),
+               cl::cat(TIPcat));
+static cl::opt<bool>
+    packbools("pack",
+              cl::desc("store the elements of arrays of booleans as bits "
+                       "(with --typed)"),
+              cl::cat(TIPcat));
 static cl::opt<bool> disopt("do", cl::desc("disable bitcode optimization"),
                             cl::cat(TIPcat));
+static cl::opt<bool>
+    vectorizeRemarks("pvr", cl::desc("print vectorization remarks"),
+                     cl::cat(TIPcat));
 static cl::opt<int> debug(
     "verbose",
     cl::desc("enable log messages (Levels 1-3) \n Level 1 - Basic logging for "
@@ -35,6 +77,41 @@ static cl::opt<int> debug(
 static cl::opt<bool>
     emitHrAsm("asm", cl::desc("emit human-readable LLVM assembly language"),
               cl::cat(TIPcat));
+static cl::opt<bool> emitObject("c", cl::desc("emit a native object file"),
+                                cl::cat(TIPcat));
+static cl::opt<bool>
+    emitExecutable("exe",
+                   cl::desc("emit an executable linked with the runtime "
+                            "library"),
+                   cl::cat(TIPcat));
+static cl::opt<bool>
+    runProgram("run",
+               cl::desc("run the program instead of emitting it, passing it "
+                        "the arguments after the source file"),
+               cl::cat(TIPcat));
+static cl::opt<bool>
+    emitBytecode("bytecode",
+                 cl::desc("emit the portable bytecode of the program (.tbc)"),
+                 cl::cat(TIPcat));
+static cl::opt<bool>
+    runVM("vm",
+          cl::desc("run the program in the bytecode VM, passing it the "
+                   "arguments after the source file, which may be a bytecode "
+                   "file"),
+          cl::cat(TIPcat));
+static cl::opt<bool> pbytecode("pbc", cl::desc("print the bytecode"),
+                               cl::cat(TIPcat));
+static cl::opt<bool>
+    runTiered("tiered",
+              cl::desc("run the program in an interpreter that compiles hot "
+                       "functions with optimizations while it runs, passing "
+                       "it the arguments after the source file"),
+              cl::cat(TIPcat));
+static cl::opt<int> tierThreshold(
+    "tier-threshold", cl::value_desc("count"), cl::init(1000),
+    cl::desc("number of calls and loop iterations that make a function hot "
+             "(with --tiered)"),
+    cl::cat(TIPcat));
 static cl::opt<std::string>
     cgFile("pcg", cl::value_desc("call graph output file"),
            cl::desc("print call graph to a file in dot syntax"),
@@ -49,6 +126,10 @@ static cl::opt<std::string>
 static cl::opt<std::string> sourceFile(cl::Positional,
                                        cl::desc("<tip source file>"),
                                        cl::Required, cl::cat(TIPcat));
+static cl::list<std::string>
+    programArgs(cl::Positional,
+                cl::desc("[-- <program arguments>...] (with --run, --tiered or --vm)"),
+                cl::cat(TIPcat));
 static cl::opt<std::string> outputfile("o", cl::value_desc("outputfile"),
                                        cl::desc("write output to <outputfile>"),
                                        cl::cat(TIPcat));
@@ -61,9 +142,19 @@ static cl::list<Optimization> OptimizationList(
       clEnumVal(inliner, "Module Inliner"),
       clEnumVal(gdce, "Global Dead Code Elimination"),
       clEnumVal(constmerge, "Constant Merge"),
-      clEnumVal(looprotate, "Loop Rotate")
+      clEnumVal(looprotate, "Loop Rotate"),
+      clEnumValN(vectorization, "vectorize", "Loop and SLP Vectorization")
     ),
 		cl::cat(TIPcat));
+static cl::opt<OptLevel> optLevel(
+    cl::desc("Optimization level (the enabled optimizations run after it):"),
+    cl::values(clEnumVal(O0, "No optimizations"),
+               clEnumVal(O1, "Optimize quickly"),
+               clEnumVal(O2, "Optimize for fast execution"),
+               clEnumVal(O3, "Optimize for fast execution aggressively"),
+               clEnumVal(Os, "Optimize for small code size"),
+               clEnumVal(Oz, "Optimize for small code size aggressively")),
+    cl::init(Obasic), cl::cat(TIPcat));
 
 /*! \brief tipc driver.
  *
@@ -93,6 +184,39 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (!programArgs.empty() && !runProgram && !runTiered && !runVM) {
+    LOG_S(ERROR) << "tipc: error: program arguments are only used with --run, "
+                    "--tiered or --vm";
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Bytecode files are run without the front end or LLVM
+  const std::string &sourceName = sourceFile.getValue();
+  std::size_t extLength = std::strlen(BYTECODE_EXT);
+  if (sourceName.size() > extLength &&
+      sourceName.compare(sourceName.size() - extLength, extLength,
+                         BYTECODE_EXT) == 0) {
+    std::ifstream bytecodeStream(sourceFile, std::ios::binary);
+    if (!bytecodeStream.good()) {
+      LOG_S(ERROR) << "tipc: error: no such file: '" << sourceFile << "'";
+      std::exit(EXIT_FAILURE);
+    }
+    try {
+      auto bytecode = BytecodeProgram::read(bytecodeStream);
+      if (pbytecode) {
+        bytecode->print(std::cout);
+      }
+      if (runVM) {
+        std::exit(VM::run(bytecode, programArgs));
+      }
+      std::exit(EXIT_SUCCESS);
+    } catch (BytecodeError &e) {
+      LOG_S(ERROR) << "tipc: " << e.what();
+      LOG_S(ERROR) << "tipc: bytecode error";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
   std::ifstream stream;
   stream.open(sourceFile);
   if (!stream.good()) {
@@ -110,7 +234,8 @@ int main(int argc, char *argv[]) {
     std::shared_ptr<ASTProgram> ast = FrontEnd::parse(stream);
 
     try {
-      auto analysisResults = SemanticAnalysis::analyze(ast.get(), polyinf);
+      auto analysisResults =
+          SemanticAnalysis::analyze(ast.get(), polyinf, jobs);
 
       if (ppretty) {
         FrontEnd::prettyprint(ast.get(), std::cout);
@@ -135,15 +260,81 @@ int main(int argc, char *argv[]) {
         analysisResults->getCallGraph()->print(cgStream);
       }
 
-      auto llvmModule =
-          CodeGenerator::generate(ast.get(), analysisResults.get(), sourceFile);
+      if (emitBytecode || runVM || pbytecode) {
+        auto bytecode =
+            BytecodeGenerator::generate(ast.get(), analysisResults.get());
+        if (pbytecode) {
+          bytecode->print(std::cout);
+        }
+        if (emitBytecode) {
+          std::string filename = outputfile.getValue();
+          if (filename.empty()) {
+            filename = sourceFile + BYTECODE_EXT;
+          }
+          std::ofstream bytecodeStream(filename, std::ios::binary);
+          bytecode->write(bytecodeStream);
+          if (!bytecodeStream.good()) {
+            LOG_S(ERROR) << "tipc: error: failed to write '" << filename
+                         << "'";
+            std::exit(EXIT_FAILURE);
+          }
+        }
+        if (runVM) {
+          std::exit(VM::run(bytecode, programArgs));
+        }
+        if (emitBytecode) {
+          std::exit(EXIT_SUCCESS);
+        }
+      }
+
+      /*
+       * The optimized tier is generated with the default representation of
+       * values, which the interpreter shares, and with the optimizations
+       * that keep it: --dc, --bce and --sa, at -O2 unless a level is given.
+       */
+      if (runTiered) {
+        auto compiler = [&]() {
+          CodeGenOptions options;
+          options.directCalls = true;
+          options.eliminateBoundsChecks = true;
+          options.stackAllocation = true;
+          auto llvmModule = CodeGenerator::generate(
+              ast.get(), analysisResults.get(), sourceFile, options);
+          Optimizer::optimize(llvmModule.get(), OptimizationList,
+                              optLevel == Obasic ? O2 : optLevel.getValue());
+          return llvmModule;
+        };
+        std::exit(Interpreter::run(ast.get(), analysisResults.get(),
+                                   programArgs, compiler, tierThreshold));
+      }
+
+      CodeGenOptions options;
+      options.typed = typedcg;
+      options.directCalls = directcalls;
+      options.compactRecords = compactrecords;
+      options.eliminateBoundsChecks = boundschecks;
+      options.stackAllocation = stackalloc;
+      options.packBooleans = packbools;
+      auto llvmModule = CodeGenerator::generate(
+          ast.get(), analysisResults.get(), sourceFile, options);
 
       if (!disopt) {
-        Optimizer::optimize(llvmModule.get(), OptimizationList);
+        Optimizer::optimize(llvmModule.get(), OptimizationList, optLevel,
+                            vectorizeRemarks);
       }
 
-      if (emitHrAsm) {
+      if (runProgram) {
+        std::exit(JIT::run(llvmModule.get(), programArgs));
+      } else if (emitHrAsm) {
         CodeGenerator::emitHumanReadableAssembly(llvmModule.get(), outputfile);
+      } else if (emitObject) {
+        if (!CodeGenerator::emitObject(llvmModule.get(), outputfile)) {
+          std::exit(EXIT_FAILURE);
+        }
+      } else if (emitExecutable) {
+        if (!CodeGenerator::emitExecutable(llvmModule.get(), outputfile)) {
+          std::exit(EXIT_FAILURE);
+        }
       } else {
         CodeGenerator::emit(llvmModule.get(), outputfile);
       }
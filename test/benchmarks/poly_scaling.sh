@@ -0,0 +1,77 @@
+#!/bin/bash
+# Measures polymorphic type inference time as the number of threads grows.
+#
+# Generates SIP programs made of independent chains of polymorphic functions,
+# all of them called from main, and times tipc --pi on each of them with an
+# increasing number of inference threads (-j).  Each time is followed by its
+# speedup over the time with -j 1.
+
+declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
+declare -r TIPC=${ROOT_DIR}/build/src/tipc
+declare -r SCRATCH_DIR=$(mktemp -d)
+
+# Number of independent chains and number of functions per chain
+declare -r CHAINS=${CHAINS:-"8 32"}
+declare -r LENGTH=${LENGTH:-50}
+
+# Thread counts to compare
+declare -r JOBS=${JOBS:-"1 2 4 8"}
+
+# Helper function to generate a program with the given number of chains.
+# Every function of a chain calls its predecessor at two different types, so
+# each one instantiates the generic type of the previous one twice.
+generate_program() {
+  local chains=$1
+  local file=$2
+
+  {
+    for ((c = 0; c < chains; c++)); do
+      echo "c${c}f0(x) poly { return x; }"
+      for ((i = 1; i < LENGTH; i++)); do
+        echo "c${c}f${i}(x) poly {"
+        echo "  var p, q;"
+        echo "  p = c${c}f$((i - 1))(&x);"
+        echo "  q = c${c}f$((i - 1))(x);"
+        echo "  return *p;"
+        echo "}"
+      done
+    done
+    echo "main() {"
+    echo "  var s;"
+    echo "  s = 0;"
+    for ((c = 0; c < chains; c++)); do
+      echo "  s = s + c${c}f$((LENGTH - 1))(${c});"
+    done
+    echo "  return s;"
+    echo "}"
+  } > ${file}
+}
+
+source ${ROOT_DIR}/test/benchmarks/timing.sh
+
+# Helper function to time a single tipc invocation (in seconds)
+time_tipc() {
+  time_command ${TIPC} --pi -j $1 -do -o /dev/null $2
+}
+
+printf "chains   functions"
+for j in ${JOBS}; do
+  printf "   -j %-4s speedup" $j
+done
+echo
+
+for c in ${CHAINS}; do
+  file=${SCRATCH_DIR}/poly_${c}.sip
+  generate_program $c $file
+
+  printf "%6d   %9d" $c $((c * LENGTH + 1))
+  single=$(time_tipc 1 $file)
+  for j in ${JOBS}; do
+    t=$([ $j -eq 1 ] && echo ${single} || time_tipc $j $file)
+    printf "   %7s %7s" $t $(awk -v a=${single} -v b=$t \
+      'BEGIN { if (b > 0) printf "%.2fx", a / b; else print "-" }')
+  done
+  echo
+done
+
+rm -rf ${SCRATCH_DIR}
@@ -3,13 +3,10 @@
 
 declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
 declare -r TIPC=${ROOT_DIR}/build/src/tipc
-declare -r RTLIB=${ROOT_DIR}/rtlib
 declare -r SCRATCH_DIR=$(mktemp -d)
 
-if [ -z "${TIPCLANG}" ]; then
-  echo error: TIPCLANG env var must be set
-  exit 1
-fi
+# Optimization levels at which each benchmark is reported
+declare -r LEVELS=${LEVELS:-"O0 O1 O2 O3 Os Oz"}
 
 curdir="$(basename `pwd`)"
 if [ "${curdir}" != "benchmarks" ]; then
@@ -39,30 +36,31 @@ measure_average_runtime() {
 #   $2: Optimized flag
 #   $3: Input
 #   $4: Number of trials
+#   $5: Unoptimized flag
+#   $6: Minimum speedup (defaults to any speedup)
 run_benchmark() {
   local name=$1
   local optimized_flag=$2
   local inp=$3
   local trials=$4
   local unoptimized_flag=$5
+  local threshold=${6:-1}
 
   # Unoptimized test.
   echo "Running ${name} without optimizations (${unoptimized_flag})"
   ${TIPC} -asm ${name}.sip
   mv ${name}.sip.ll ${name}_no_opt.sip.ll
-  ${TIPC} ${name}.sip
-  ${TIPCLANG} -w ${name}.sip.bc ${RTLIB}/tip_rtlib.bc -o ${name}_no_opt
+  ${TIPC} -exe ${name}.sip -o ${name}_no_opt
   local before_time=$(measure_average_runtime ./${name}_no_opt $inp $trials)
 
   # Optimized test.
   echo "Running ${name} with optimizations (${optimized_flag})"
   ${TIPC} -asm ${optimized_flag} ${name}.sip
-  ${TIPC} ${optimized_flag} ${name}.sip
-  ${TIPCLANG} -w ${name}.sip.bc ${RTLIB}/tip_rtlib.bc -o ${name}_opt
+  ${TIPC} -exe ${optimized_flag} ${name}.sip -o ${name}_opt
   local after_time=$(measure_average_runtime ./${name}_opt $inp $trials)
 
   # Compare average runtimes.
-  if (( $(echo "$after_time < $before_time" | bc -l) )); then
+  if (( $(echo "$after_time * $threshold < $before_time" | bc -l) )); then
     echo "${name}: passed (average before: $before_time s, after: $after_time s)"
   else
     echo "${name}: failed (average before: $before_time s, after: $after_time s)"
@@ -81,6 +79,26 @@ run_benchmark() {
   echo ""
 }
 
+# Helper function to report the average runtime of a benchmark at each
+# optimization level
+# Arguments:
+#   $1: Benchmark name
+#   $2: Input
+#   $3: Number of trials
+run_levels() {
+  local name=$1
+  local inp=$2
+  local trials=$3
+
+  printf "%-14s" ${name}
+  for level in ${LEVELS}; do
+    ${TIPC} -exe -${level} ${name}.sip -o ${name}_${level}
+    printf " %9s" $(measure_average_runtime ./${name}_${level} $inp $trials)
+    rm -f ${name}_${level}
+  done
+  echo
+}
+
 # Variables
 failed_benchmarks=0
 
@@ -92,6 +110,13 @@ run_benchmark "constmerge" "--constmerge" 100000000 100 ""
 run_benchmark "inliner" "--inliner" 10000000 50 ""
 run_benchmark "unroll" "--unroll" 10000000 50 ""
 run_benchmark "ivs" "--ivs" 10000000 50 ""
+run_benchmark "typed" "--typed" 100000 20 ""
+run_benchmark "directcalls" "--dc" 30 20 ""
+run_benchmark "records" "--cr" 2000000 20 ""
+run_benchmark "autovectorize" "--bce" 10000 20 ""
+run_benchmark "escape" "--sa" 10000000 20 ""
+run_benchmark "sieve" "--typed --pack" 10000000 20 ""
+run_benchmark "autovectorize" "--vectorize --bce" 10000 20 "" 1.5
 
 echo "Running bechmarks with all optimizations enabled"
 
@@ -102,5 +127,24 @@ run_benchmark "inliner" "--inliner --unroll --ivs --constmerge --looprotate" 100
 run_benchmark "unroll" "--unroll --inliner --ivs --constmerge --looprotate" 10000000 50 "--inliner --ivs --constmerge --looprotate"
 run_benchmark "ivs" "--ivs --inliner --unroll --constmerge --looprotate" 10000000 50 "--inliner --unroll --constmerge --looprotate"
 
+echo "Average runtime (s) of the benchmarks at each optimization level"
+
+printf "%-14s" "benchmark"
+for level in ${LEVELS}; do
+  printf " %9s" -${level}
+done
+echo
+
+run_levels "looprotate" 750 5
+run_levels "constmerge" 100000000 5
+run_levels "inliner" 10000000 5
+run_levels "unroll" 10000000 5
+run_levels "ivs" 10000000 5
+run_levels "typed" 100000 5
+run_levels "directcalls" 30 5
+run_levels "records" 2000000 5
+run_levels "autovectorize" 10000 5
+echo ""
+
 echo "Number of failed benchmarks: ${failed_benchmarks}"
 
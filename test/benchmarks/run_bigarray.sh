@@ -0,0 +1,26 @@
+#!/bin/bash
+# Measures the allocation of large arrays.
+#
+# Runs bigarray.sip, which creates an array of its first argument elements
+# (10^9 by default, 8 GB) and sums them, once with zero elements, which are
+# never written, and once with elements filled with seven.  Reports the time,
+# the page faults and the maximum resident set size of each run.
+
+declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
+declare -r TIPC=${ROOT_DIR}/build/src/tipc
+declare -r SCRATCH_DIR=$(mktemp -d)
+declare -r COUNT=${COUNT:-1000000000}
+
+# Helper function to report the time, page faults and maximum RSS of a command
+measure_command() {
+  /usr/bin/time -f "%e s, %R minor and %F major faults, %M KiB" "$@" 2>&1 \
+    >/dev/null | tail -n 1
+}
+
+${TIPC} -exe -O2 ${ROOT_DIR}/test/benchmarks/bigarray.sip -o ${SCRATCH_DIR}/bigarray
+
+echo "elements: ${COUNT}"
+echo "zero:  $(measure_command ${SCRATCH_DIR}/bigarray ${COUNT} 0)"
+echo "seven: $(measure_command ${SCRATCH_DIR}/bigarray ${COUNT} 7)"
+
+rm -rf ${SCRATCH_DIR}
@@ -0,0 +1,25 @@
+#!/bin/bash
+# Measures the cost and the benefit of the runtime library's collector.
+#
+# Runs test/system/leak/recordLeak.tip, which allocates a record on each of
+# its iterations and drops it, with and without collection (TIP_GC=1), and
+# reports the time and the maximum resident set size of each run.  Without
+# collection the program grows until it runs out of memory, so each run is
+# stopped after LIMIT seconds (10 by default).  It is compiled without
+# optimization, which would remove the allocations.
+
+declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
+declare -r TIPC=${ROOT_DIR}/build/src/tipc
+declare -r SCRATCH_DIR=$(mktemp -d)
+declare -r LIMIT=${LIMIT:-10}
+
+source ${ROOT_DIR}/test/benchmarks/timing.sh
+
+${TIPC} -exe -do ${ROOT_DIR}/test/system/leak/recordLeak.tip \
+  -o ${SCRATCH_DIR}/recordLeak
+
+echo "limit: ${LIMIT} s"
+echo "no collection: $(measure_command env TIP_GC=0 timeout ${LIMIT} ${SCRATCH_DIR}/recordLeak)"
+echo "collection:    $(measure_command env TIP_GC=1 timeout ${LIMIT} ${SCRATCH_DIR}/recordLeak)"
+
+rm -rf ${SCRATCH_DIR}
@@ -0,0 +1,31 @@
+#!/bin/bash
+# Measures the throughput of the input expression.
+#
+# Generates a file of about 100 MB holding 10^7 + 1 integers and runs
+# input.sip, which sums them, reading them interactively with a prompt each
+# (the default), in batch mode from stdin (TIP_INPUT_FILE=-) and in batch mode
+# from the mapped file (TIP_INPUT_FILE=<file>).
+
+declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
+declare -r TIPC=${ROOT_DIR}/build/src/tipc
+declare -r SCRATCH_DIR=$(mktemp -d)
+declare -r COUNT=10000001
+
+source ${ROOT_DIR}/test/benchmarks/timing.sh
+
+seq 100000000 110000000 > ${SCRATCH_DIR}/input.txt
+${TIPC} -exe -O2 ${ROOT_DIR}/test/benchmarks/input.sip -o ${SCRATCH_DIR}/input
+
+interactive=$(time_command bash -c \
+  "${SCRATCH_DIR}/input ${COUNT} < ${SCRATCH_DIR}/input.txt")
+stream=$(time_command bash -c \
+  "TIP_INPUT_FILE=- ${SCRATCH_DIR}/input ${COUNT} < ${SCRATCH_DIR}/input.txt")
+mapped=$(time_command env TIP_INPUT_FILE=${SCRATCH_DIR}/input.txt \
+  ${SCRATCH_DIR}/input ${COUNT})
+
+echo "input: $(du -m ${SCRATCH_DIR}/input.txt | cut -f1) MB, ${COUNT} values"
+echo "interactive:   ${interactive} s"
+echo "batch, stdin:  ${stream} s"
+echo "batch, mapped: ${mapped} s"
+
+rm -rf ${SCRATCH_DIR}
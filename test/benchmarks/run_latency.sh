@@ -0,0 +1,35 @@
+#!/bin/bash
+# Measures the time from source to result of running small programs.
+#
+# Runs every self-contained system test once built as an executable (tipc
+# -exe and running the executable), in process (tipc --run) and in the tiered
+# interpreter (tipc --tiered), and reports the total wall-clock time of each.
+
+declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
+declare -r TIPC=${ROOT_DIR}/build/src/tipc
+declare -r SCRATCH_DIR=$(mktemp -d)
+declare -r PROGRAMS=${PROGRAMS:-"${ROOT_DIR}/test/system/selftests/*.tip"}
+
+source ${ROOT_DIR}/test/benchmarks/timing.sh
+
+exe_time=0
+run_time=0
+tiered_time=0
+count=0
+for i in ${PROGRAMS}; do
+  exe=${SCRATCH_DIR}/$(basename $i .tip)
+  t=$(time_command bash -c "${TIPC} -exe $i -o ${exe} && ${exe}")
+  exe_time=$(echo "$exe_time + $t" | bc -l)
+  t=$(time_command ${TIPC} --run $i)
+  run_time=$(echo "$run_time + $t" | bc -l)
+  t=$(time_command ${TIPC} --tiered $i)
+  tiered_time=$(echo "$tiered_time + $t" | bc -l)
+  ((count++))
+done
+
+echo "programs: ${count}"
+echo "tipc -exe and run: ${exe_time} s"
+echo "tipc --run:        ${run_time} s"
+echo "tipc --tiered:     ${tiered_time} s"
+
+rm -rf ${SCRATCH_DIR}
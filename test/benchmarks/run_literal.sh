@@ -0,0 +1,30 @@
+#!/bin/bash
+# Measures the compilation of a large array literal.
+#
+# Generates a program indexing a literal of COUNT numbers (10^4 by default)
+# and reports the time tipc takes to compile it and the size of the module.
+
+declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
+declare -r TIPC=${ROOT_DIR}/build/src/tipc
+declare -r SCRATCH_DIR=$(mktemp -d)
+declare -r COUNT=${COUNT:-10000}
+
+{
+  echo "main(i) {"
+  echo "  var table;"
+  echo -n "  table = [0"
+  for ((n = 1; n < COUNT; n++)); do
+    echo -n ", $((n * 7 % 1000))"
+  done
+  echo "];"
+  echo "  return table[i];"
+  echo "}"
+} > ${SCRATCH_DIR}/literal.tip
+
+compile=$(/usr/bin/time -f "%e" ${TIPC} -O2 ${SCRATCH_DIR}/literal.tip 2>&1 | tail -n 1)
+
+echo "elements: ${COUNT}"
+echo "compile: ${compile} s"
+echo "module:  $(wc -c < ${SCRATCH_DIR}/literal.tip.bc) bytes"
+
+rm -rf ${SCRATCH_DIR}
@@ -0,0 +1,24 @@
+#!/bin/bash
+# Measures the throughput of the output statement.
+#
+# Runs output.sip, which outputs the integers up to its argument (10^8 by
+# default), with its output discarded, once with the "Program output: "
+# prefix and once in raw mode (TIP_RAW_OUTPUT=1).
+
+declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
+declare -r TIPC=${ROOT_DIR}/build/src/tipc
+declare -r SCRATCH_DIR=$(mktemp -d)
+declare -r COUNT=${COUNT:-100000000}
+
+source ${ROOT_DIR}/test/benchmarks/timing.sh
+
+${TIPC} -exe -O2 ${ROOT_DIR}/test/benchmarks/output.sip -o ${SCRATCH_DIR}/output
+
+prefixed=$(time_command ${SCRATCH_DIR}/output ${COUNT})
+raw=$(time_command env TIP_RAW_OUTPUT=1 ${SCRATCH_DIR}/output ${COUNT})
+
+echo "values: ${COUNT}"
+echo "prefixed: ${prefixed} s ($(echo "${COUNT} / ${prefixed}" | bc) values/s)"
+echo "raw:      ${raw} s ($(echo "${COUNT} / ${raw}" | bc) values/s)"
+
+rm -rf ${SCRATCH_DIR}
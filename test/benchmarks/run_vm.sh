@@ -0,0 +1,38 @@
+#!/bin/bash
+# Compares the bytecode VM with unoptimized native code.
+#
+# Runs every sip system test compiled with tipc -do as an executable, and from
+# its bytecode in the VM (tipc --bytecode, then tipc --vm on the bytecode
+# file).  Reports the total wall-clock time of compiling and of running the
+# programs for each.
+
+declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
+declare -r TIPC=${ROOT_DIR}/build/src/tipc
+declare -r SCRATCH_DIR=$(mktemp -d)
+declare -r PROGRAMS=${PROGRAMS:-"${ROOT_DIR}/test/system/siptests/*.sip"}
+
+source ${ROOT_DIR}/test/benchmarks/timing.sh
+
+native_compile=0
+native_run=0
+vm_compile=0
+vm_run=0
+count=0
+for i in ${PROGRAMS}; do
+  base=${SCRATCH_DIR}/$(basename $i .sip)
+  t=$(time_command ${TIPC} -do -exe $i -o ${base})
+  native_compile=$(echo "$native_compile + $t" | bc -l)
+  t=$(time_command ${base})
+  native_run=$(echo "$native_run + $t" | bc -l)
+  t=$(time_command ${TIPC} --bytecode $i -o ${base}.tbc)
+  vm_compile=$(echo "$vm_compile + $t" | bc -l)
+  t=$(time_command ${TIPC} --vm ${base}.tbc)
+  vm_run=$(echo "$vm_run + $t" | bc -l)
+  ((count++))
+done
+
+echo "programs: ${count}"
+echo "tipc -do -exe:    compile ${native_compile} s, run ${native_run} s"
+echo "tipc --bytecode:  compile ${vm_compile} s, run (--vm) ${vm_run} s"
+
+rm -rf ${SCRATCH_DIR}
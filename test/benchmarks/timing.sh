@@ -0,0 +1,12 @@
+# Helpers shared by the benchmark scripts, which source this file.
+
+# Helper function to time a command (in seconds)
+time_command() {
+  /usr/bin/time -f "%e" "$@" 2>&1 >/dev/null | tail -n 1
+}
+
+# Helper function to report the time (in seconds) and the maximum RSS (in KiB)
+# of a command
+measure_command() {
+  /usr/bin/time -f "%e s, %M KiB" "$@" 2>&1 >/dev/null | tail -n 1
+}
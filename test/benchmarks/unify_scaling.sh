@@ -0,0 +1,67 @@
+#!/bin/bash
+# Measures type unification time as the number of type constraints grows.
+#
+# Generates SIP programs whose type constraints grow linearly with the number
+# of locals and reports the number of constraints unified and the time spent
+# unifying them, which tipc logs with --verbose 1.  Set BASELINE_TIPC to a tipc
+# built from an earlier revision that logs them too to print before/after
+# timings side by side.
+
+declare -r ROOT_DIR=${TRAVIS_BUILD_DIR:-$(git rev-parse --show-toplevel)}
+declare -r TIPC=${ROOT_DIR}/build/src/tipc
+declare -r SCRATCH_DIR=$(mktemp -d)
+
+# Sizes (number of locals) of the generated programs
+declare -r SIZES=${SIZES:-"250 500 1000 2000 4000"}
+
+# Helper function to generate a program with the given number of locals.
+# Every local participates in an assignment, a reference and a dereference,
+# so the number of constraints is linear in the number of locals.
+generate_program() {
+  local n=$1
+  local file=$2
+
+  {
+    echo "main() {"
+    printf "  var x0"
+    for ((i = 1; i < n; i++)); do
+      printf ", x%d" $i
+    done
+    echo ", p;"
+    echo "  x0 = 0;"
+    for ((i = 1; i < n; i++)); do
+      echo "  p = &x$((i - 1));"
+      echo "  x$i = *p + $i;"
+    done
+    echo "  return x$((n - 1));"
+    echo "}"
+  } > ${file}
+}
+
+# Helper function to report the constraints unified by a single tipc
+# invocation and the time (in seconds) it spent unifying them, summed over
+# the unifiers it ran, or "- -" if it does not log them
+unify_tipc() {
+  local tipc=$1
+  local file=$2
+  ${tipc} -do --verbose 1 -o /dev/null ${file} 2>&1 >/dev/null |
+    sed -n 's/.*Unified \([0-9]*\) type constraints in \([0-9.e+-]*\) s.*/\1 \2/p' |
+    awk '{ n += $1; t += $2; found = 1 }
+         END { if (found) printf "%d %.4f\n", n, t; else print "- -" }'
+}
+
+echo "locals   constraints   unify (s)   baseline (s)"
+for n in ${SIZES}; do
+  file=${SCRATCH_DIR}/unify_${n}.sip
+  generate_program $n $file
+
+  read constraints after <<< "$(unify_tipc ${TIPC} $file)"
+  before="-"
+  if [ -n "${BASELINE_TIPC}" ]; then
+    read _ before <<< "$(unify_tipc ${BASELINE_TIPC} $file)"
+  fi
+
+  printf "%6d   %11s   %9s   %12s\n" $n $constraints $after $before
+done
+
+rm -rf ${SCRATCH_DIR}
@@ -36,8 +36,8 @@ entry:
   ret i64 %calltmp
 }
 
-; Function Attrs: nounwind
-declare noalias ptr @calloc(i64, i64) #1
+; Function Attrs: nounwind allockind("alloc,zeroed") allocsize(0)
+declare noalias nonnull ptr @_tip_alloc(i64) #1
 
 attributes #0 = { nocallback nofree nosync nounwind willreturn memory(none) }
-attributes #1 = { nounwind }
+attributes #1 = { nounwind allockind("alloc,zeroed") allocsize(0) "alloc-family"="_tip_alloc" }
@@ -24,6 +24,10 @@ initialize_test() {
   ((numtests++))
 }
 
+# The optional code generation strategies the self contained tests run with
+strategies=("--typed" "--dc" "--cr" "--bce" "--sa" "--typed --pack" "-O2"
+            "--typed --dc --cr --bce --sa --pack -O2")
+
 # Self contained test cases
 for i in selftests/*.tip
 do
@@ -62,6 +66,44 @@ do
     rm ${base}
   fi 
   rm $i.bc
+
+  # test program generated with each optional code generation strategy on
+  # its own, and with all of them together
+  for flags in "${strategies[@]}"; do
+    initialize_test
+    ${TIPC} -exe ${flags} $i -o $base
+
+    ./${base} &>/dev/null
+    exit_code=${?}
+    if [ ${exit_code} -ne 0 ]; then
+      echo -n "Test failure with ${flags} for : "
+      echo $i
+      ./${base}
+      ((numfailures++))
+    else
+      rm ${base}
+    fi
+  done
+
+  # test program run by the tiered interpreter, promoting functions early
+  initialize_test
+  ${TIPC} --tiered --tier-threshold 1 $i &>/dev/null
+  exit_code=${?}
+  if [ ${exit_code} -ne 0 ]; then
+    echo -n "Test failure for --tiered of : "
+    echo $i
+    ((numfailures++))
+  fi
+
+  # test program run by the bytecode VM
+  initialize_test
+  ${TIPC} --vm $i &>/dev/null
+  exit_code=${?}
+  if [ ${exit_code} -ne 0 ]; then
+    echo -n "Test failure for --vm of : "
+    echo $i
+    ((numfailures++))
+  fi
 done
 
 # Self contained sip test cases
@@ -102,6 +144,44 @@ do
     rm ${base}
   fi 
   rm $i.bc
+
+  # test program generated with each optional code generation strategy on
+  # its own, and with all of them together
+  for flags in "${strategies[@]}"; do
+    initialize_test
+    ${TIPC} -exe ${flags} $i -o $base
+
+    ./${base} &>/dev/null
+    exit_code=${?}
+    if [ ${exit_code} -ne 0 ]; then
+      echo -n "Test failure with ${flags} for : "
+      echo $i
+      ./${base}
+      ((numfailures++))
+    else
+      rm ${base}
+    fi
+  done
+
+  # test program run by the tiered interpreter, promoting functions early
+  initialize_test
+  ${TIPC} --tiered --tier-threshold 1 $i &>/dev/null
+  exit_code=${?}
+  if [ ${exit_code} -ne 0 ]; then
+    echo -n "Test failure for --tiered of : "
+    echo $i
+    ((numfailures++))
+  fi
+
+  # test program run by the bytecode VM
+  initialize_test
+  ${TIPC} --vm $i &>/dev/null
+  exit_code=${?}
+  if [ ${exit_code} -ne 0 ]; then
+    echo -n "Test failure for --vm of : "
+    echo $i
+    ((numfailures++))
+  fi
 done
 
 # IO related test cases
@@ -131,6 +211,43 @@ do
   rm iotests/$executable.tip.bc
   rm iotests/$executable.output
   rm $executable
+
+  # run the same program in process
+  initialize_test
+  ${TIPC} --run iotests/$executable.tip -- $input >${SCRATCH_DIR}/$executable.output 2>&1
+  diff ${SCRATCH_DIR}/$executable.output $i > ${SCRATCH_DIR}/$executable.diff
+  if [[ -s ${SCRATCH_DIR}/$executable.diff ]]
+  then
+    echo -n "Test differences for --run of : "
+    echo $i
+    cat ${SCRATCH_DIR}/$executable.diff
+    ((numfailures++))
+  fi
+
+  # run the same program in the tiered interpreter
+  initialize_test
+  ${TIPC} --tiered iotests/$executable.tip -- $input >${SCRATCH_DIR}/$executable.output 2>&1
+  diff ${SCRATCH_DIR}/$executable.output $i > ${SCRATCH_DIR}/$executable.diff
+  if [[ -s ${SCRATCH_DIR}/$executable.diff ]]
+  then
+    echo -n "Test differences for --tiered of : "
+    echo $i
+    cat ${SCRATCH_DIR}/$executable.diff
+    ((numfailures++))
+  fi
+
+  # run the same program from its bytecode file in the VM
+  initialize_test
+  ${TIPC} --bytecode iotests/$executable.tip -o ${SCRATCH_DIR}/$executable.tbc
+  ${TIPC} --vm ${SCRATCH_DIR}/$executable.tbc -- $input >${SCRATCH_DIR}/$executable.output 2>&1
+  diff ${SCRATCH_DIR}/$executable.output $i > ${SCRATCH_DIR}/$executable.diff
+  if [[ -s ${SCRATCH_DIR}/$executable.diff ]]
+  then
+    echo -n "Test differences for --vm of : "
+    echo $i
+    cat ${SCRATCH_DIR}/$executable.diff
+    ((numfailures++))
+  fi
 done
 
 # Tests to cover driver logic for error and argument handling
@@ -193,6 +310,20 @@ if [ ! -f $expected ]; then
 fi 
 rm $expected
 
+# Test object file output.
+initialize_test
+input=iotests/fib.tip
+output=${SCRATCH_DIR}/fib.tip.o
+${TIPC} -c $input -o $output
+${TIPCLANG} -w $output ${RTLIB}/tip_rtlib.bc -o ${SCRATCH_DIR}/fib
+${SCRATCH_DIR}/fib 7 > ${SCRATCH_DIR}/fib.output
+diff ${SCRATCH_DIR}/fib.output iotests/fib-7.expected > ${SCRATCH_DIR}/fib.diff
+if [ -s ${SCRATCH_DIR}/fib.diff ]; then
+  echo "Test differences for object file output of $input"
+  cat ${SCRATCH_DIR}/fib.diff
+  ((numfailures++))
+fi
+
 # Test human-readable assembly.
 initialize_test
 input=iotests/fib.tip
@@ -222,6 +353,214 @@ if [ -s $diffed_graph ]; then
   ((numfailures++))
 fi 
 
+# Test raw output, without the "Program output: " prefix.
+initialize_test
+TIP_RAW_OUTPUT=1 ${TIPC} --run iotests/fib.tip -- 7 > ${SCRATCH_DIR}/fib.output
+sed 's/^Program output: //' iotests/fib-7.expected | diff ${SCRATCH_DIR}/fib.output - > ${SCRATCH_DIR}/fib.diff
+if [ -s ${SCRATCH_DIR}/fib.diff ]; then
+  echo "Test differences for raw output of iotests/fib.tip"
+  cat ${SCRATCH_DIR}/fib.diff
+  ((numfailures++))
+fi
+
+# Test batch input from a file and from stdin.
+initialize_test
+echo "3 -4, 10" > ${SCRATCH_DIR}/batch.input
+cat > ${SCRATCH_DIR}/batch.tip <<'EOF'
+main() { return input * 100 + input * 10 + input; }
+EOF
+TIP_INPUT_FILE=${SCRATCH_DIR}/batch.input ${TIPC} --run ${SCRATCH_DIR}/batch.tip > ${SCRATCH_DIR}/batch.output
+TIP_INPUT_FILE=- ${TIPC} --run ${SCRATCH_DIR}/batch.tip < ${SCRATCH_DIR}/batch.input >> ${SCRATCH_DIR}/batch.output
+printf "Program output: 270\nProgram output: 270\n" | diff ${SCRATCH_DIR}/batch.output - > ${SCRATCH_DIR}/batch.diff
+if [ -s ${SCRATCH_DIR}/batch.diff ]; then
+  echo "Test differences for batch input"
+  cat ${SCRATCH_DIR}/batch.diff
+  ((numfailures++))
+fi
+
+# Test the allocation counters of the runtime library.
+initialize_test
+cat > ${SCRATCH_DIR}/alloc.tip <<'EOF'
+main() { var p, q; p = alloc 1; q = alloc {f: 2}; return *p + (*q).f; }
+EOF
+TIP_ALLOC_STATS=1 ${TIPC} -do --run ${SCRATCH_DIR}/alloc.tip 2> ${SCRATCH_DIR}/alloc.stats >/dev/null
+echo "Allocated 24 bytes in 3 objects" | diff ${SCRATCH_DIR}/alloc.stats - > ${SCRATCH_DIR}/alloc.diff
+if [ -s ${SCRATCH_DIR}/alloc.diff ]; then
+  echo "Test differences for allocation counters"
+  cat ${SCRATCH_DIR}/alloc.diff
+  ((numfailures++))
+fi
+
+# Test arrays filled with numbers, in the heap, mapped and in the frame.
+initialize_test
+cat > ${SCRATCH_DIR}/fill.tip <<'EOF'
+main() {
+  var a, b, c, d, i, s;
+  a = [1000000 of 0];
+  b = [1000001 of 7];
+  c = [5 of 3];
+  d = [3 of 0];
+  s = 0;
+  for (i : 0 .. #a) {
+    s = s + a[i] + b[i];
+  }
+  s = s + b[1000000];
+  for (i : c) {
+    s = s + i;
+  }
+  return s + d[0] + d[2];
+}
+EOF
+for flags in "" "--sa -do"; do
+  ${TIPC} -exe ${flags} ${SCRATCH_DIR}/fill.tip -o ${SCRATCH_DIR}/fill
+  ${SCRATCH_DIR}/fill > ${SCRATCH_DIR}/fill.output
+  echo "Program output: 7000022" | diff ${SCRATCH_DIR}/fill.output - > ${SCRATCH_DIR}/fill.diff
+  if [ -s ${SCRATCH_DIR}/fill.diff ]; then
+    echo "Test differences for array fills with ${flags}"
+    cat ${SCRATCH_DIR}/fill.diff
+    ((numfailures++))
+  fi
+done
+
+# Test array literals written through the item of a loop.
+initialize_test
+cat > ${SCRATCH_DIR}/foritem.tip <<'EOF'
+main() {
+  var a, s;
+  a = [1, 2, 3];
+  s = 0;
+  for (a[0] : 0 .. 5) {
+    s = s + a[0];
+  }
+  return s + a[1] + a[2];
+}
+EOF
+for flags in "" "--sa -do"; do
+  ${TIPC} -exe ${flags} ${SCRATCH_DIR}/foritem.tip -o ${SCRATCH_DIR}/foritem
+  ${SCRATCH_DIR}/foritem > ${SCRATCH_DIR}/foritem.output
+  echo "Program output: 15" | diff ${SCRATCH_DIR}/foritem.output - > ${SCRATCH_DIR}/foritem.diff
+  if [ -s ${SCRATCH_DIR}/foritem.diff ]; then
+    echo "Test differences for loop items in array literals with ${flags}"
+    cat ${SCRATCH_DIR}/foritem.diff
+    ((numfailures++))
+  fi
+done
+
+# Test arrays of booleans, packed as bits and not.
+initialize_test
+cat > ${SCRATCH_DIR}/packed.tip <<'EOF'
+sieve(n) {
+  var p, i, j, c, q;
+  p = [n of true];
+  p[0] = false;
+  p[1] = false;
+  for (i : 2 .. n) {
+    if (p[i]) {
+      j = i * i;
+      while (j < n) {
+        p[j] = false;
+        j = j + i;
+      }
+    }
+  }
+  c = 0;
+  for (q : p) {
+    if (q) c = c + 1;
+  }
+  return c;
+}
+
+main() {
+  var a, b, c, d, k, e, s;
+  a = [true, false, true, true, false];
+  b = [70 of false];
+  b[3] = true;
+  b[64] = true;
+  b[69] = true;
+  b[3] = false;
+  c = [a[0], a[1], b[64]];
+  d = [100 of a[2]];
+  s = sieve(1000) * 1000;
+  for (k : 0 .. #b) {
+    if (b[k]) s = s + k;
+  }
+  for (e : c) {
+    if (e) s = s + 1;
+  }
+  if (d[99]) s = s + #d * 1000000;
+  return s + #a;
+}
+EOF
+for flags in "" "--typed --pack" "--typed --pack --bce --sa -do"; do
+  ${TIPC} -exe ${flags} ${SCRATCH_DIR}/packed.tip -o ${SCRATCH_DIR}/packed
+  ${SCRATCH_DIR}/packed > ${SCRATCH_DIR}/packed.output
+  echo "Program output: 100168140" | diff ${SCRATCH_DIR}/packed.output - > ${SCRATCH_DIR}/packed.diff
+  if [ -s ${SCRATCH_DIR}/packed.diff ]; then
+    echo "Test differences for boolean arrays with ${flags}"
+    cat ${SCRATCH_DIR}/packed.diff
+    ((numfailures++))
+  fi
+done
+
+# Test that collection keeps reachable objects alive.
+initialize_test
+cat > ${SCRATCH_DIR}/gc.tip <<'EOF'
+main() {
+  var head, i, j, s;
+  s = 0;
+  for (i : 0 .. 3000) {
+    head = null;
+    for (j : 0 .. 1000) {
+      head = alloc {val: j, next: head};
+    }
+    while (head != null) {
+      s = s + (*head).val;
+      head = (*head).next;
+    }
+  }
+  return s;
+}
+EOF
+${TIPC} -do -exe ${SCRATCH_DIR}/gc.tip -o ${SCRATCH_DIR}/gc
+TIP_GC=1 TIP_ALLOC_STATS=1 ${SCRATCH_DIR}/gc 2> ${SCRATCH_DIR}/gc.stats > ${SCRATCH_DIR}/gc.output
+echo "Program output: 1498500000" | diff ${SCRATCH_DIR}/gc.output - > ${SCRATCH_DIR}/gc.diff
+if [ -s ${SCRATCH_DIR}/gc.diff ] || ! grep -q "^Collected" ${SCRATCH_DIR}/gc.stats; then
+  echo "Test differences for collection"
+  cat ${SCRATCH_DIR}/gc.diff ${SCRATCH_DIR}/gc.stats
+  ((numfailures++))
+fi
+
+# Test default bytecode output file.
+initialize_test
+input=iotests/main.tip
+expected=iotests/main.tip.tbc
+${TIPC} --bytecode $input
+if [ ! -f $expected ]; then
+  echo -n "Did not find expected output, $expected, for input $input"
+  ((numfailures++))
+fi
+rm -f $expected
+
+# Test a malformed bytecode file.
+initialize_test
+echo "main() { return 0; }" > ${SCRATCH_DIR}/malformed.tbc
+${TIPC} --vm ${SCRATCH_DIR}/malformed.tbc &>/dev/null
+exit_code=${?}
+if [ ${exit_code} -eq 0 ]; then
+  echo "Test failure for a malformed bytecode file"
+  ((numfailures++))
+fi
+
+# Test program arguments without --run or --tiered.
+initialize_test
+${TIPC} iotests/fib.tip 7 &>/dev/null
+exit_code=${?}
+if [ ${exit_code} -eq 0 ]; then
+  echo "Test failure for program arguments without --run or --tiered"
+  ((numfailures++))
+  rm iotests/fib.tip.bc
+fi
+
 # Test bad input.
 initialize_test
 nonexistent=$(uuidgen).tip
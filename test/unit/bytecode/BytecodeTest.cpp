@@ -0,0 +1,241 @@
+#include "ASTHelper.h"
+#include "BytecodeError.h"
+#include "BytecodeGenerator.h"
+#include "RuntimeLibrary.h"
+#include "SemanticAnalysis.h"
+#include "VM.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+std::shared_ptr<BytecodeProgram> generate(std::stringstream &program) {
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  return BytecodeGenerator::generate(ast.get(), analysis.get());
+}
+
+int32_t op(Opcode opcode) { return static_cast<int32_t>(opcode); }
+
+// Returns the opcodes of the instructions of a function
+std::vector<Opcode> opcodes(const BytecodeFunction &function) {
+  std::vector<Opcode> result;
+  auto &code = function.code;
+  for (std::size_t pc = 0; pc < code.size();) {
+    auto opcode = static_cast<Opcode>(code[pc++]);
+    result.push_back(opcode);
+    for (auto kind = BytecodeProgram::operandKinds(opcode); *kind != '\0';
+         kind++) {
+      int32_t operand = code[pc++];
+      if (*kind == 'n') {
+        pc += operand;
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("Bytecode: hand-written code is dispatched", "[Bytecode]") {
+  // r0 = 0; r1 = 10; do { r0 = r0 + 1; } while (r0 < r1); return r0;
+  auto bytecode = std::make_shared<BytecodeProgram>();
+  bytecode->functions.push_back(
+      {"main",
+       0,
+       2,
+       {op(Opcode::Const), 0, 0, op(Opcode::Const), 1, 10, op(Opcode::AddImm),
+        0, 0, 1, op(Opcode::JumpIfLess), 0, 1, 6, op(Opcode::Return), 0}});
+  bytecode->mainFunction = 0;
+  bytecode->verify();
+
+  VM vm(bytecode);
+  REQUIRE(vm.call(0, {}) == 10);
+}
+
+TEST_CASE("Bytecode: temporaries are reused from one statement to the next",
+          "[Bytecode]") {
+  std::stringstream once;
+  once << "main() { var x; x = 1 + 2 * 3 + 4; return x; }";
+  std::stringstream thrice;
+  thrice << R"(
+      main() {
+        var x;
+        x = 1 + 2 * 3 + 4;
+        x = 1 + 2 * 3 + 4;
+        x = 1 + 2 * 3 + 4;
+        return x;
+      }
+    )";
+
+  auto one = generate(once)->functions[0];
+  auto three = generate(thrice)->functions[0];
+  REQUIRE(one.numParams == 0);
+  REQUIRE(one.numRegisters > 1);
+  REQUIRE(three.numRegisters == one.numRegisters);
+}
+
+TEST_CASE("Bytecode: loops over arrays index them without checks",
+          "[Bytecode]") {
+  std::stringstream program;
+  program << R"(
+      main() {
+        var a, s, i;
+        a = [1, 2, 3];
+        s = 0;
+        for (i : a) {
+          s = s + i;
+        }
+        return s * 10 + a[1];
+      }
+    )";
+
+  auto bytecode = generate(program);
+  auto code = opcodes(bytecode->functions[0]);
+  REQUIRE(std::count(code.begin(), code.end(),
+                     Opcode::GetElementUnchecked) == 1);
+  REQUIRE(std::count(code.begin(), code.end(), Opcode::GetElement) == 1);
+
+  VM vm(bytecode);
+  REQUIRE(vm.call(bytecode->mainFunction, {}) == 62);
+}
+
+TEST_CASE("Bytecode: records not allocated are freed on return",
+          "[Bytecode]") {
+  std::stringstream program;
+  program << R"(
+      local() { var r; r = {f: 1}; return r.f; }
+      allocated() { var p; p = alloc {f: 2}; return (*p).f; }
+      main() { return local() + allocated(); }
+    )";
+
+  auto bytecode = generate(program);
+  auto size = bytecode->numFields * 8;
+  VM vm(bytecode);
+
+  // The pools reuse the last block freed first
+  auto *block = _tip_alloc(size);
+  _tip_free(block, size);
+  REQUIRE(vm.call(0, {}) == 1);
+  REQUIRE(_tip_alloc(size) == block);
+
+  _tip_free(block, size);
+  REQUIRE(vm.call(1, {}) == 2);
+  REQUIRE(_tip_alloc(size) != block);
+}
+
+TEST_CASE("Bytecode: running out of registers ends the program",
+          "[Bytecode]") {
+  std::stringstream program;
+  program << R"(
+      down(n) { return down(n + 1); }
+      main() { return down(0); }
+    )";
+
+  auto bytecode = generate(program);
+
+  // The VM exits, so it runs in a child process
+  fflush(nullptr);
+  pid_t child = fork();
+  if (child == 0) {
+    if (freopen("/dev/null", "w", stderr) == nullptr) {
+      _exit(EXIT_SUCCESS);
+    }
+    VM vm(bytecode, 1024);
+    vm.call(bytecode->mainFunction, {});
+    _exit(0);
+  }
+  int status;
+  REQUIRE(waitpid(child, &status, 0) == child);
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(WEXITSTATUS(status) == EXIT_FAILURE);
+}
+
+TEST_CASE("Bytecode: operands are evaluated before the calls that follow them",
+          "[Bytecode]") {
+  std::stringstream program;
+  program << R"(
+      set(p) { *p = 100; return 1; }
+      main() {
+        var x, y, i, t;
+        x = 1;
+        y = x + set(&x);
+        t = 0;
+        for (i : 0 .. 10 by 3) {
+          t = t + i;
+        }
+        while (x > 95) {
+          x--;
+        }
+        return y * 10000 + t * 100 + (x == 95 ? 7 : 8);
+      }
+    )";
+
+  auto bytecode = generate(program);
+  VM vm(bytecode);
+  REQUIRE(vm.call(bytecode->mainFunction, {}) == 21807);
+}
+
+TEST_CASE("Bytecode: programs are written and read back", "[Bytecode]") {
+  std::stringstream program;
+  program << R"(
+      inc(x) { return x + 1; }
+      main(n) { return inc(n) * 2; }
+    )";
+
+  auto bytecode = generate(program);
+  std::stringstream file;
+  bytecode->write(file);
+  auto read = BytecodeProgram::read(file);
+
+  REQUIRE(read->functions.size() == 2);
+  REQUIRE(read->functions[0].name == "inc");
+  REQUIRE(read->functions[1].code == bytecode->functions[1].code);
+  VM vm(read);
+  REQUIRE(vm.call(read->mainFunction, {20}) == 42);
+}
+
+TEST_CASE("Bytecode: malformed programs are rejected", "[Bytecode]") {
+  SECTION("not a bytecode file") {
+    std::stringstream file("main() { return 0; }");
+    REQUIRE_THROWS_AS(BytecodeProgram::read(file), BytecodeError);
+  }
+
+  SECTION("truncated file") {
+    std::stringstream program;
+    program << "main() { return 0; }";
+    std::stringstream file;
+    generate(program)->write(file);
+    std::stringstream truncated(file.str().substr(0, file.str().size() - 2));
+    REQUIRE_THROWS_AS(BytecodeProgram::read(truncated), BytecodeError);
+  }
+
+  SECTION("register outside of the frame") {
+    BytecodeProgram bytecode;
+    bytecode.functions.push_back(
+        {"main", 0, 1, {static_cast<int32_t>(Opcode::Return), 1}});
+    REQUIRE_THROWS_AS(bytecode.verify(), BytecodeError);
+  }
+
+  SECTION("jump into an instruction") {
+    BytecodeProgram bytecode;
+    bytecode.functions.push_back({"main",
+                                  0,
+                                  1,
+                                  {static_cast<int32_t>(Opcode::Jump), 1,
+                                   static_cast<int32_t>(Opcode::Return), 0}});
+    REQUIRE_THROWS_AS(bytecode.verify(), BytecodeError);
+  }
+
+  SECTION("code running off its end") {
+    BytecodeProgram bytecode;
+    bytecode.functions.push_back(
+        {"main", 0, 1, {static_cast<int32_t>(Opcode::Const), 0, 1}});
+    REQUIRE_THROWS_AS(bytecode.verify(), BytecodeError);
+  }
+}
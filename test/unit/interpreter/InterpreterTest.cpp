@@ -0,0 +1,151 @@
+#include "ASTHelper.h"
+#include "CodeGenerator.h"
+#include "Interpreter.h"
+#include "SemanticAnalysis.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Interpreter: arithmetic, calls and function values",
+          "[Interpreter]") {
+  std::stringstream program;
+  program << R"(
+      fib(n) {
+        var r;
+        if (n < 2) {
+          r = n;
+        } else {
+          r = fib(n - 1) + fib(n - 2);
+        }
+        return r;
+      }
+      apply(f, x) { return f(x); }
+      main(n) {
+        var x, y;
+        x = apply(fib, n);
+        y = -7 / 2 + 7 % 3 * 10;
+        return x * 100 + y;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  Interpreter interpreter(ast.get(), analysis.get());
+
+  REQUIRE(interpreter.call(ast->findFunctionByName("main"), {10}) == 5507);
+}
+
+TEST_CASE("Interpreter: arrays, records and pointers", "[Interpreter]") {
+  std::stringstream program;
+  program << R"(
+      main() {
+        var a, b, i, s, r, p, q;
+        a = [1, 2, 3];
+        b = [4 of 5];
+        s = 0;
+        for (i : 0 .. #a) {
+          s = s + a[i];
+        }
+        for (i : b) {
+          s = s + i;
+        }
+        b[3] = 10;
+        r = {f: 1, g: 2};
+        r.g = r.g + b[3];
+        p = alloc {f: 3, g: 4};
+        (*p).f = (*p).f * 2;
+        q = &s;
+        *q = *q + r.g + (*p).f;
+        s++;
+        return s;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  Interpreter interpreter(ast.get(), analysis.get());
+
+  REQUIRE(interpreter.call(ast->findFunctionByName("main"), {}) == 45);
+}
+
+TEST_CASE("Interpreter: array elements start at a cache line after the "
+          "length",
+          "[Interpreter]") {
+  std::stringstream program;
+  program << R"(
+      literal() { return [1, 2, 3]; }
+      filled(n) { return [n of 7]; }
+      main() { return 0; }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  Interpreter interpreter(ast.get(), analysis.get());
+
+  auto literal = interpreter.call(ast->findFunctionByName("literal"), {});
+  REQUIRE(literal % 64 == 0);
+  REQUIRE(reinterpret_cast<int64_t *>(literal)[-1] == 3);
+  REQUIRE(reinterpret_cast<int64_t *>(literal)[2] == 3);
+
+  auto filled = interpreter.call(ast->findFunctionByName("filled"), {5});
+  REQUIRE(filled % 64 == 0);
+  REQUIRE(reinterpret_cast<int64_t *>(filled)[-1] == 5);
+  REQUIRE(reinterpret_cast<int64_t *>(filled)[4] == 7);
+}
+
+TEST_CASE("Interpreter: hot functions are promoted to native code",
+          "[Interpreter]") {
+  std::stringstream program;
+  program << R"(
+      square(x) { return x * x; }
+      sum(n) {
+        var s, i;
+        s = 0;
+        for (i : 0 .. n) {
+          s = s + square(i);
+        }
+        return s;
+      }
+      main() { return sum(10); }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto compiler = [&]() {
+    return CodeGenerator::generate(ast.get(), analysis.get(), "hot");
+  };
+  Interpreter interpreter(ast.get(), analysis.get(), compiler, 5);
+
+  auto sum = ast->findFunctionByName("sum");
+  REQUIRE(interpreter.call(sum, {10}) == 285);
+  interpreter.waitForCompilation();
+  REQUIRE(interpreter.isPromoted(ast->findFunctionByName("square")));
+  REQUIRE(interpreter.isPromoted(sum));
+  REQUIRE_FALSE(interpreter.isPromoted(ast->findFunctionByName("main")));
+  REQUIRE(interpreter.call(sum, {10}) == 285);
+}
+
+TEST_CASE("Interpreter: functions stay interpreted without a compiler",
+          "[Interpreter]") {
+  std::stringstream program;
+  program << R"(
+      main() {
+        var i, s;
+        s = 0;
+        i = 0;
+        while (i < 100) {
+          s = s + i;
+          i = i + 1;
+        }
+        return s;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  Interpreter interpreter(ast.get(), analysis.get(), nullptr, 1);
+
+  auto main = ast->findFunctionByName("main");
+  REQUIRE(interpreter.call(main, {}) == 4950);
+  interpreter.waitForCompilation();
+  REQUIRE_FALSE(interpreter.isPromoted(main));
+}
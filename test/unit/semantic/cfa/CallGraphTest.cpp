@@ -5,6 +5,7 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <map>
 #include <set>
 
 TEST_CASE("CallGraph: getter for num of vertices and edges"
@@ -383,3 +384,87 @@ TEST_CASE("CallGraph: test print method"
   found = output.find("a1 -> a0;");
   REQUIRE(found != std::string::npos);
 }
+
+TEST_CASE("CallGraph: function values flowing around a cycle"
+          "[CallGraph]") {
+  std::stringstream program;
+  program << R"(
+      f() {
+        return 1;
+      }
+      g() {
+        return 2;
+      }
+      main() {
+        var x, y, z;
+        x = f;
+        y = g;
+        z = x;
+        x = y;
+        y = z;
+        return x() + z();
+      }
+    )";
+
+  /* x, y and z form a cycle of subset constraints, so each of them may
+   * hold either function.  Call graph should be:
+   *   main->f	indirect call
+   *   main->g	indirect call
+   */
+
+  auto ast = ASTHelper::build_ast(program);
+  auto symTable = SymbolTable::build(ast.get());
+  auto callGraph = CallGraph::build(ast.get(), symTable.get());
+
+  REQUIRE(callGraph.get()->getTotalVertices() == 3);
+  REQUIRE(callGraph.get()->getTotalEdges() == 2);
+
+  REQUIRE(callGraph.get()->existEdge("main", "f"));
+  REQUIRE(callGraph.get()->existEdge("main", "g"));
+}
+
+TEST_CASE("CallGraph: test getSCCs"
+          "[CallGraph]") {
+  std::stringstream program;
+  program << R"(
+      even(n) {
+        var r;
+        if (n == 0) { r = 1; } else { r = odd(n - 1); }
+        return r;
+      }
+      odd(n) {
+        var r;
+        if (n == 0) { r = 0; } else { r = even(n - 1); }
+        return r;
+      }
+      id(x) {
+        return x;
+      }
+      main() {
+        return even(id(4));
+      }
+    )";
+
+  /* Components should be {even, odd}, {id} and {main}, with main
+   * listed after the components that it calls into.
+   */
+
+  auto ast = ASTHelper::build_ast(program);
+  auto symTable = SymbolTable::build(ast.get());
+  auto callGraph = CallGraph::build(ast.get(), symTable.get());
+
+  auto sccs = callGraph->getSCCs();
+  REQUIRE(sccs.size() == 3);
+
+  std::map<std::string, int> component;
+  for (int i = 0; i < sccs.size(); i++) {
+    for (auto f : sccs[i]) {
+      component[f->getName()] = i;
+    }
+  }
+
+  REQUIRE(component["even"] == component["odd"]);
+  REQUIRE(component["even"] != component["id"]);
+  REQUIRE(component["main"] > component["even"]);
+  REQUIRE(component["main"] > component["id"]);
+}
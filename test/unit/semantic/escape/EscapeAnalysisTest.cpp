@@ -0,0 +1,264 @@
+#include "EscapeAnalysis.h"
+#include "ASTHelper.h"
+#include "SemanticAnalysis.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+// Collects the allocation sites of a program in the order they are visited
+class SiteCollector : public ASTVisitor {
+public:
+  std::vector<ASTExpr *> sites;
+
+  void endVisit(ASTAllocExpr *element) override { sites.push_back(element); }
+  void endVisit(ASTArrayExpr *element) override { sites.push_back(element); }
+  void endVisit(ASTArrayOfExpr *element) override {
+    sites.push_back(element);
+  }
+};
+
+} // namespace
+
+TEST_CASE("EscapeAnalysis: a record read and dropped does not escape",
+          "[EscapeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      foo(x, y, z) {
+        var rec;
+        rec = alloc {l: x, m: y, n: z};
+        return (*rec).m;
+      }
+      main() { return foo(3, 2, 4); }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto escape = EscapeAnalysis::analyze(ast.get(), analysis->getCallGraph());
+
+  // The alloc and the record it holds
+  REQUIRE(escape->getTotal() == 2);
+  REQUIRE(escape->getStackAllocatable() == 2);
+}
+
+TEST_CASE("EscapeAnalysis: returned and stored values escape",
+          "[EscapeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      ret() { var p; p = alloc 1; return p; }
+      store(q) { var a; a = [1, 2]; *q = a; return 0; }
+      main() {
+        var c, x, y;
+        c = alloc 0;
+        x = ret();
+        y = store(c);
+        return *c;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto escape = EscapeAnalysis::analyze(ast.get(), analysis->getCallGraph());
+
+  SiteCollector sites;
+  ast->accept(&sites);
+  REQUIRE(sites.sites.size() == 3);
+  REQUIRE_FALSE(escape->isStackAllocatable(sites.sites[0]));
+  REQUIRE_FALSE(escape->isStackAllocatable(sites.sites[1]));
+  REQUIRE(escape->isStackAllocatable(sites.sites[2]));
+}
+
+TEST_CASE("EscapeAnalysis: parameters escape through their callees",
+          "[EscapeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      sum(a) { return a[0] + a[1]; }
+      id(a) { return a; }
+      keep(a) { var b; b = id(a); return b[0]; }
+      main() {
+        var a, b;
+        a = [1, 2];
+        b = [3, 4];
+        return sum(a) + keep(b);
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto escape = EscapeAnalysis::analyze(ast.get(), analysis->getCallGraph());
+
+  auto functions = ast->getFunctions();
+  REQUIRE_FALSE(escape->parameterEscapes(functions[0], 0));
+  REQUIRE(escape->parameterEscapes(functions[1], 0));
+  REQUIRE(escape->parameterEscapes(functions[2], 0));
+
+  SiteCollector sites;
+  ast->accept(&sites);
+  REQUIRE(escape->isStackAllocatable(sites.sites[0]));
+  REQUIRE_FALSE(escape->isStackAllocatable(sites.sites[1]));
+}
+
+TEST_CASE("EscapeAnalysis: sites in loops stay in the heap",
+          "[EscapeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      main(n) {
+        var i, p, q, s;
+        s = 0;
+        q = alloc 0;
+        for (i : 0 .. n) {
+          p = alloc i;
+          s = s + *p + *q;
+        }
+        return s;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto escape = EscapeAnalysis::analyze(ast.get(), analysis->getCallGraph());
+
+  SiteCollector sites;
+  ast->accept(&sites);
+  REQUIRE(escape->isStackAllocatable(sites.sites[0]));
+  REQUIRE_FALSE(escape->isStackAllocatable(sites.sites[1]));
+}
+
+TEST_CASE("EscapeAnalysis: what an alloc'd cell holds escapes with it",
+          "[EscapeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      main() {
+        var p, q;
+        p = alloc [1, 2];
+        q = alloc alloc 3;
+        return **q + (*p)[0];
+      }
+      leak() { var p, q; p = alloc [1]; q = &p; return *p; }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto escape = EscapeAnalysis::analyze(ast.get(), analysis->getCallGraph());
+
+  SiteCollector sites;
+  ast->accept(&sites);
+  REQUIRE(sites.sites.size() == 6);
+  for (int i = 0; i < 4; i++) {
+    REQUIRE(escape->isStackAllocatable(sites.sites[i]));
+  }
+  REQUIRE_FALSE(escape->isStackAllocatable(sites.sites[4]));
+  REQUIRE_FALSE(escape->isStackAllocatable(sites.sites[5]));
+}
+
+TEST_CASE("EscapeAnalysis: arrays never written are read-only",
+          "[EscapeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      sum(a) { return a[0] + a[1]; }
+      main() {
+        var a, b, c, d, e, p;
+        a = [1, 2];
+        b = [3];
+        c = [4];
+        d = [5];
+        e = [6, 7];
+        b[0] = 1;
+        c[0]++;
+        p = &d[0];
+        return a[1] + sum(e);
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto escape = EscapeAnalysis::analyze(ast.get(), analysis->getCallGraph());
+
+  SiteCollector sites;
+  ast->accept(&sites);
+  REQUIRE(sites.sites.size() == 5);
+  REQUIRE(escape->isReadOnly(sites.sites[0]));
+  for (int i = 1; i < 5; i++) {
+    REQUIRE(escape->isStackAllocatable(sites.sites[i]));
+    REQUIRE_FALSE(escape->isReadOnly(sites.sites[i]));
+  }
+}
+
+TEST_CASE("EscapeAnalysis: arrays written by the item of a loop are not "
+          "read-only",
+          "[EscapeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      main() {
+        var a, b, s, i;
+        a = [1, 2, 3];
+        b = [4, 5, 6];
+        s = 0;
+        for (a[0] : 0 .. 5) { s = s + a[0]; }
+        for (i : b) { s = s + i; }
+        return s;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto escape = EscapeAnalysis::analyze(ast.get(), analysis->getCallGraph());
+
+  SiteCollector sites;
+  ast->accept(&sites);
+  REQUIRE(sites.sites.size() == 2);
+  REQUIRE_FALSE(escape->isReadOnly(sites.sites[0]));
+  REQUIRE(escape->isReadOnly(sites.sites[1]));
+}
+
+TEST_CASE("EscapeAnalysis: addresses of elements and fields escape their base",
+          "[EscapeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      f() { var a, p; a = [1, 2, 3]; p = &a[0]; return p; }
+      g() { var p, q; p = alloc {v: 1}; q = &(*p).v; return q; }
+      main() { return *f() + *g(); }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto escape = EscapeAnalysis::analyze(ast.get(), analysis->getCallGraph());
+
+  // The array, the alloc and the record it holds, of which only the alloc'd
+  // cell is not reached through the addresses returned
+  REQUIRE(escape->getTotal() == 3);
+  REQUIRE(escape->getStackAllocatable() == 1);
+
+  SiteCollector sites;
+  ast->accept(&sites);
+  REQUIRE_FALSE(escape->isStackAllocatable(sites.sites[0]));
+  REQUIRE(escape->isStackAllocatable(sites.sites[1]));
+}
+
+TEST_CASE("EscapeAnalysis: arguments of calls through values escape",
+          "[EscapeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      first(x) { return x[0]; }
+      keep(x) { var c; c = alloc x; return 0; }
+      main() {
+        var f, r, a, b;
+        r = alloc keep;
+        f = first;
+        if (input > 0) { f = *r; }
+        a = [1, 2, 3];
+        b = [4, 5, 6];
+        return f(a) + first(b);
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto analysis = SemanticAnalysis::analyze(ast.get(), false);
+  auto escape = EscapeAnalysis::analyze(ast.get(), analysis->getCallGraph());
+
+  SiteCollector sites;
+  ast->accept(&sites);
+  REQUIRE(sites.sites.size() == 4);
+  REQUIRE_FALSE(escape->isStackAllocatable(sites.sites[2]));
+  REQUIRE(escape->isStackAllocatable(sites.sites[3]));
+}
@@ -0,0 +1,124 @@
+#include "RangeAnalysis.h"
+#include "ASTHelper.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("RangeAnalysis: index below the length of the array",
+          "[RangeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      main() {
+        var a, i, s;
+        a = [10 of 1];
+        s = 0;
+        for (i : 0 .. #a) {
+          s = s + a[i];
+        }
+        return s;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto ranges = RangeAnalysis::analyze(ast.get());
+
+  REQUIRE(ranges->getTotal() == 1);
+  REQUIRE(ranges->getEliminated() == 1);
+  REQUIRE(ranges->getHoisted() == 0);
+}
+
+TEST_CASE("RangeAnalysis: offsets are checked against the length",
+          "[RangeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      main() {
+        var a, i, s;
+        a = [10 of 1];
+        s = 0;
+        for (i : 1 .. #a - 1) {
+          s = s + a[i - 1] + a[i + 1];
+        }
+        for (i : 0 .. #a) {
+          s = s + a[i + 1];
+        }
+        return s;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto ranges = RangeAnalysis::analyze(ast.get());
+
+  REQUIRE(ranges->getTotal() == 3);
+  REQUIRE(ranges->getEliminated() == 2);
+  REQUIRE(ranges->getHoisted() == 1);
+}
+
+TEST_CASE("RangeAnalysis: loops over unknown bounds are versioned",
+          "[RangeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      main(n) {
+        var x, y, i;
+        x = [n of 0];
+        y = [n of 1];
+        for (i : 0 .. n) {
+          x[i] = y[i] + y[i + 1];
+        }
+        return 0;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto ranges = RangeAnalysis::analyze(ast.get());
+
+  REQUIRE(ranges->getTotal() == 3);
+  REQUIRE(ranges->getEliminated() == 0);
+  REQUIRE(ranges->getHoisted() == 3);
+
+  auto loop = dynamic_cast<ASTForStmt *>(
+      ast->findFunctionByName("main")->getStmts()[2]);
+  REQUIRE(loop != nullptr);
+  auto guards = ranges->getGuards(loop);
+  REQUIRE(guards.size() == 2);
+  REQUIRE(guards[0].array == "x");
+  REQUIRE(guards[0].minOffset == 0);
+  REQUIRE(guards[0].maxOffset == 0);
+  REQUIRE(guards[1].array == "y");
+  REQUIRE(guards[1].minOffset == 0);
+  REQUIRE(guards[1].maxOffset == 1);
+  REQUIRE(ranges->getGuardedAccesses(loop).size() == 3);
+}
+
+TEST_CASE("RangeAnalysis: assignments invalidate the loop facts",
+          "[RangeAnalysis]") {
+  std::stringstream program;
+  program << R"(
+      main() {
+        var a, i, p, s;
+        a = [10 of 1];
+        s = 0;
+        for (i : 0 .. #a) {
+          s = s + a[i];
+          i = i + 1;
+        }
+        for (i : 0 .. #a) {
+          a = [5 of 2];
+          s = s + a[i];
+        }
+        p = &i;
+        for (i : 0 .. #a) {
+          s = s + a[i];
+        }
+        for (i : 0 .. #a by -1) {
+          s = s + a[i];
+        }
+        return s;
+      }
+    )";
+
+  auto ast = ASTHelper::build_ast(program);
+  auto ranges = RangeAnalysis::analyze(ast.get());
+
+  REQUIRE(ranges->getTotal() == 4);
+  REQUIRE(ranges->getEliminated() == 0);
+  REQUIRE(ranges->getHoisted() == 0);
+}
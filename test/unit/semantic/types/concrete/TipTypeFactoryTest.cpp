@@ -0,0 +1,82 @@
+#include "TipTypeFactory.h"
+#include "ASTNumberExpr.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <vector>
+
+TEST_CASE("TipTypeFactory: Test structurally equal types are shared",
+          "[TipTypeFactory]") {
+  ASTNumberExpr n(42);
+
+  SECTION("Base types") {
+    REQUIRE(TipTypeFactory::getInt() == TipTypeFactory::getInt());
+    REQUIRE(TipTypeFactory::getBool() == TipTypeFactory::getBool());
+    REQUIRE(TipTypeFactory::getAbsentField() ==
+            TipTypeFactory::getAbsentField());
+  }
+
+  SECTION("Variables") {
+    REQUIRE(TipTypeFactory::getVar(&n) == TipTypeFactory::getVar(&n));
+    REQUIRE(TipTypeFactory::getAlpha(&n, "f") ==
+            TipTypeFactory::getAlpha(&n, "f"));
+    REQUIRE_FALSE(TipTypeFactory::getAlpha(&n, "f") ==
+                  TipTypeFactory::getAlpha(&n, "g"));
+    REQUIRE_FALSE(std::static_pointer_cast<TipType>(TipTypeFactory::getVar(
+                      &n)) == TipTypeFactory::getAlpha(&n));
+  }
+
+  SECTION("Constructors") {
+    auto ref1 = TipTypeFactory::getRef(TipTypeFactory::getVar(&n));
+    auto ref2 = TipTypeFactory::getRef(TipTypeFactory::getVar(&n));
+    REQUIRE(ref1 == ref2);
+
+    std::vector<std::shared_ptr<TipType>> params{TipTypeFactory::getInt(),
+                                                 ref1};
+    auto fun1 = TipTypeFactory::getFunction(params, TipTypeFactory::getInt());
+    auto fun2 = TipTypeFactory::getFunction(params, TipTypeFactory::getInt());
+    REQUIRE(fun1 == fun2);
+    REQUIRE_FALSE(std::static_pointer_cast<TipType>(fun1) ==
+                  TipTypeFactory::getFunction(params, ref1));
+  }
+}
+
+TEST_CASE("TipTypeFactory: Test records with different names are distinct",
+          "[TipTypeFactory]") {
+  std::vector<std::shared_ptr<TipType>> inits{TipTypeFactory::getInt()};
+  auto r1 = TipTypeFactory::getRecord(inits, {"f"});
+  auto r2 = TipTypeFactory::getRecord(inits, {"g"});
+  REQUIRE(*r1 == *r2);
+  REQUIRE(r1 != r2);
+  REQUIRE(r1 == TipTypeFactory::getRecord(inits, {"f"}));
+}
+
+TEST_CASE("TipTypeFactory: Test rebuilding constructors",
+          "[TipTypeFactory]") {
+  ASTNumberExpr n(42);
+  auto var = TipTypeFactory::getVar(&n);
+
+  std::vector<std::shared_ptr<TipType>> params{var};
+  auto fun = TipTypeFactory::getFunction(params, var);
+
+  std::vector<std::shared_ptr<TipType>> args{TipTypeFactory::getInt(),
+                                             TipTypeFactory::getBool()};
+  auto rebuilt = TipTypeFactory::getCons(fun.get(), args);
+
+  std::vector<std::shared_ptr<TipType>> expectedParams{
+      TipTypeFactory::getInt()};
+  REQUIRE(rebuilt == TipTypeFactory::getFunction(expectedParams,
+                                                 TipTypeFactory::getBool()));
+}
+
+TEST_CASE("TipTypeFactory: Test unused types are released",
+          "[TipTypeFactory]") {
+  auto before = TipTypeFactory::size();
+  {
+    ASTNumberExpr n(7);
+    auto array = TipTypeFactory::getArray(TipTypeFactory::getVar(&n));
+    REQUIRE(TipTypeFactory::size() > before);
+  }
+  REQUIRE(TipTypeFactory::size() == before);
+}
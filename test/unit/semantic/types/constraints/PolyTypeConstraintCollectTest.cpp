@@ -3,6 +3,8 @@
 #include "PolyTypeConstraintCollectVisitor.h"
 #include "SymbolTable.h"
 #include "TypeConstraintCollectVisitor.h"
+#include "TypeInference.h"
+#include "UnificationError.h"
 
 #include <catch2/catch_test_macros.hpp>
 
@@ -105,3 +107,74 @@ main() {
 
   testidentmain(program, expected);
 }
+
+static std::string inferTypes(std::string const &source, int jobs) {
+  std::stringstream program(source);
+  auto ast = ASTHelper::build_ast(program);
+  auto symbols = SymbolTable::build(ast.get());
+  auto cg = CallGraph::build(ast.get(), symbols.get());
+  auto types =
+      TypeInference::run(ast.get(), true, cg.get(), symbols.get(), jobs);
+
+  std::stringstream stream;
+  types->print(stream);
+  return stream.str();
+}
+
+TEST_CASE("PolyTypeConstraintVisitor: parallel inference matches sequential",
+          "[TypeConstraintVisitor]") {
+  /* ident and pair are solved independently, swap shares a type variable
+   * with apply since it names apply without calling it, and main depends on
+   * the generic types of all of them.
+   */
+  std::string program = R"(ident(p) poly {
+ return p;
+}
+
+pair(a, b) poly {
+ return {fst: a, snd: b};
+}
+
+apply(f, v) poly {
+ return f(v);
+}
+
+inc(x) {
+ return x + 1;
+}
+
+swap(r) poly {
+ var g;
+ g = apply;
+ return g(inc, *r);
+}
+
+main() {
+  var x, y, z, w;
+  x = ident(42);
+  y = ident(&x);
+  z = pair(y, x);
+  w = swap(&x);
+  return apply(inc, x + w);
+})";
+
+  auto sequential = inferTypes(program, 1);
+  REQUIRE(inferTypes(program, 4) == sequential);
+}
+
+TEST_CASE("PolyTypeConstraintVisitor: parallel inference reports type errors",
+          "[TypeConstraintVisitor]") {
+  std::string program = R"(ident(p) poly {
+ return p;
+}
+
+bad(p) poly {
+ return *p + p;
+}
+
+main() {
+  return ident(42);
+})";
+
+  REQUIRE_THROWS_AS(inferTypes(program, 4), UnificationError);
+}
@@ -1,5 +1,6 @@
 #include "UnionFind.h"
 #include "ASTNumberExpr.h"
+#include "TipRef.h"
 #include "TipVar.h"
 
 #include <catch2/catch_test_macros.hpp>
@@ -111,3 +112,44 @@ TEST_CASE("UnionFind: multiple entries", "[UnionFind]") {
   REQUIRE(*unionFind.find(three) == *five);
   cleanup(tipVars);
 }
+
+TEST_CASE("UnionFind: structurally equal terms share a class",
+          "[UnionFind]") {
+  std::vector<int> ints{3, 4};
+  auto tipVars = std::move(intsToTipVars(ints));
+
+  auto three = tipVars.at(0);
+  auto four = tipVars.at(1);
+
+  // Distinct objects with the same structure
+  auto refThree = std::make_shared<TipRef>(three);
+  auto otherRefThree = std::make_shared<TipRef>(three);
+
+  UnionFind unionFind(tipVars);
+  unionFind.quick_union(refThree, four);
+
+  REQUIRE(unionFind.connected(otherRefThree, four));
+  REQUIRE(*unionFind.find(otherRefThree) == *four);
+  cleanup(tipVars);
+}
+
+TEST_CASE("UnionFind: representative follows the second argument",
+          "[UnionFind]") {
+  std::vector<int> ints{3, 4, 5, 6};
+  auto tipVars = std::move(intsToTipVars(ints));
+
+  auto three = tipVars.at(0);
+  auto four = tipVars.at(1);
+  auto five = tipVars.at(2);
+  auto six = tipVars.at(3);
+
+  UnionFind unionFind(tipVars);
+  // Build a taller tree first so that union by rank keeps its root
+  unionFind.quick_union(three, four);
+  unionFind.quick_union(five, four);
+  unionFind.quick_union(four, six);
+
+  REQUIRE(*unionFind.find(three) == *six);
+  REQUIRE(*unionFind.find(five) == *six);
+  cleanup(tipVars);
+}